@@ -0,0 +1,89 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "object.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace my_ns;
+
+//what the integer kernels did before they checked for overflow, kept as the baseline
+static std::shared_ptr<object> unchecked(operator_type op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
+{
+  if(left->get_type() != object_type::integer || right->get_type() != object_type::integer)
+    return add_error("type mismatch");
+  auto l = static_cast<integer*>(left.get())->get_value();
+  auto r = static_cast<integer*>(right.get())->get_value();
+  switch(op)
+  {
+    case operator_type::plus: return std::make_shared<integer>(l + r);
+    case operator_type::minus: return std::make_shared<integer>(l - r);
+    default: return std::make_shared<integer>(l * r);
+  }
+}
+
+static void run_small(const char* op, size_t count)
+{
+  auto op_type = to_operator(op);
+  auto a = std::make_shared<integer>(12345);
+  auto b = std::make_shared<integer>(67);
+  volatile size_t sink = 0;
+
+  auto plain = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>(unchecked(op_type, a, b)->get_type());
+  });
+  auto checked = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>(eval_infix_expression(op_type, a, b)->get_type());
+  });
+  std::printf("int %s: unchecked %5.1f ns, checked %5.1f ns, %.2fx\n", op, plain / count * 1e9, checked / count * 1e9, checked / plain);
+}
+
+//a number with the given count of limbs, every limb set
+static bignum make_number(size_t limbs)
+{
+  bignum::limbs mag(limbs);
+  for(size_t i = 0; i < limbs; ++i)
+    mag[i] = static_cast<bignum::limb>(0x9e3779b9u * (i + 1));
+  mag.back() |= 1;
+  return bignum(false, std::move(mag));
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  std::printf("%zu evaluations per operator\n", count);
+  for(auto op : { "+", "-", "*" })
+    run_small(op, count);
+
+  //schoolbook would take 4x per doubling, karatsuba about 3x once it kicks in
+  double last = 0;
+  for(size_t limbs : { 16, 32, 64, 128, 256, 512, 1024, 2048 })
+  {
+    auto a = make_number(limbs);
+    auto b = make_number(limbs) + 1;
+    size_t reps = limbs <= 64 ? 2000 : 200000 / limbs;
+    volatile size_t sink = 0;
+    auto seconds = lea_bench::best_of(3, [&] {
+      for(size_t i = 0; i < reps; ++i)
+        sink = sink + (a * b).get_limbs().size();
+    });
+    auto per = seconds / reps * 1e6;
+    if(last > 0)
+      std::printf("%5zu limbs: %9.2f us per product, %.2fx the last size\n", limbs, per, per / last);
+    else
+      std::printf("%5zu limbs: %9.2f us per product\n", limbs, per);
+    last = per;
+  }
+
+  //overflowing products in the script, 2^62 squared and on
+  auto big = std::make_shared<integer>(int64_t(1) << 62);
+  std::shared_ptr<object> acc = big;
+  auto seconds = lea_bench::best_of(3, [&] {
+    acc = big;
+    for(int i = 0; i < 200; ++i)
+      acc = eval_infix_expression(operator_type::astrisk, acc, big);
+  });
+  std::printf("200 overflowing products: %.2f us, %zu digits\n", seconds * 1e6, acc->inspect().size());
+}
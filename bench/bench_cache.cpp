@@ -0,0 +1,55 @@
+#include "bench_common.hpp"
+#include "flat_parser.hpp"
+#include "leac.hpp"
+#include "lexer.hpp"
+#include "mapped_file.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+
+using namespace my_ns;
+
+//time from a mapped source to the first statement the evaluator can run
+int main(int argc, char** argv)
+{
+  size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+  auto path = std::filesystem::temp_directory_path() / "lea_bench_cache.lea";
+  std::ofstream(path, std::ios::binary) << lea_bench::generate_script(mb << 20);
+  auto cache = leac::cache_path(path);
+  auto file = mapped_file::open(path);
+  auto source = file->view();
+
+  auto touch = lea_bench::best_of(5, [&] { volatile auto h = leac::hash_source(source); (void)h; });
+
+  auto parse = lea_bench::best_of(5, [&] {
+    lexer l(source);
+    parser p(&l);
+    p.parse_program();
+  });
+
+  //the runner builds each top level statement right before running it, the first one is
+  //when execution starts
+  auto miss = lea_bench::best_of(5, [&] {
+    lexer l(source);
+    flat_parser p(&l, source);
+    auto flat = std::make_shared<const flat::ast>(p.parse_program());
+    leac::save(cache, *flat, source);
+    flat::to_tree(flat, flat::top_level(*flat)[0]);
+  });
+
+  auto hit = lea_bench::best_of(5, [&] {
+    auto flat = std::make_shared<const flat::ast>(std::move(*leac::load(cache, source)));
+    flat::to_tree(flat, flat::top_level(*flat)[0]);
+  });
+
+  std::printf("script %.1f MB, cache %.1f MB\n", source.size() / 1048576.0, std::filesystem::file_size(cache) / 1048576.0);
+  std::printf("  hash source only: %7.1f ms\n", touch * 1000);
+  std::printf("  tree parse:       %7.1f ms\n", parse * 1000);
+  std::printf("  cache miss:       %7.1f ms (flat parse, write cache)\n", miss * 1000);
+  std::printf("  cache hit:        %7.1f ms (map, check hashes and ids)\n", hit * 1000);
+
+  std::filesystem::remove(path);
+  std::filesystem::remove(cache);
+}
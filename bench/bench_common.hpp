@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdio>
+#include <string>
+
+namespace lea_bench
+{
+  //best of n runs in seconds
+  template <typename F>
+  double best_of(int runs, F&& fn)
+  {
+    double best = 1e30;
+    for(int i = 0; i < runs; ++i)
+    {
+      auto start = std::chrono::steady_clock::now();
+      fn();
+      std::chrono::duration<double> took = std::chrono::steady_clock::now() - start;
+      best = took.count() < best ? took.count() : best;
+    }
+    return best;
+  }
+
+  //machine generated data dump, long strings, long names and deep indentation
+  inline std::string generate_data_script(size_t target_bytes)
+  {
+    std::string out;
+    out.reserve(target_bytes + 512);
+    std::string payload(120, 'x');
+    for(size_t i = 0; out.size() < target_bytes; ++i)
+    {
+      auto n = std::to_string(i);
+      out += "var generated_table_entry_with_a_long_name_" + n + " = [\n";
+      out += "                                \"" + payload + n + "\",\n";
+      out += "                                123456789012345678" + n + "\n";
+      out += "                            ];\n";
+    }
+    return out;
+  }
+
+  //a generated script that looks like the code we actually run
+  inline std::string generate_script(size_t target_bytes)
+  {
+    std::string out;
+    out.reserve(target_bytes + 256);
+    for(size_t i = 0; out.size() < target_bytes; ++i)
+    {
+      auto n = std::to_string(i);
+      out += "var record_" + n + " = {\"name\": \"item number " + n + "\", \"count\": " + n + ", \"active\": true};\n";
+      out += "var helper_" + n + " = fun(value, other) {\n";
+      out += "    if (value < other) { ret value * 2 + other; } else { ret other - value / 3; }\n";
+      out += "};\n";
+      out += "puts(to_string(helper_" + n + "(record_" + n + "[\"count\"], " + n + ")));\n\n";
+    }
+    return out;
+  }
+
+  //a helper library of small functions followed by a single call into it
+  inline std::string generate_library_script(size_t lines)
+  {
+    std::string out;
+    size_t i = 0;
+    for(size_t line = 0; line + 1 < lines; line += 6, ++i)
+    {
+      auto n = std::to_string(i);
+      out += "var lib_" + n + " = fun(value, scale) {\n";
+      out += "    var doubled = value * 2 + scale;\n";
+      out += "    var table = {\"value\": doubled, \"name\": \"lib " + n + "\"};\n";
+      out += "    if (doubled > 100) { ret table[\"value\"] / 2; }\n";
+      out += "    ret [doubled, table[\"name\"], scale - value][0];\n";
+      out += "};\n";
+    }
+    out += "lib_" + std::to_string(i / 2) + "(4, 5);\n";
+    return out;
+  }
+}
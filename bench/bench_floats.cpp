@@ -0,0 +1,60 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace my_ns;
+
+static void run(const char* name, const std::string& source, const std::shared_ptr<array>& big)
+{
+  std::string result;
+  auto seconds = lea_bench::best_of(3, [&] {
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    env->set(intern("big"), big);
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+  std::printf("%-10s: %7.2f ms, %6.2f ns per element (total %s)\n", name, seconds * 1000, seconds / big->get_elements().size() * 1e9, result.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  std::printf("elements: %zu\n", count);
+
+  std::vector<double> values(count);
+  std::vector<std::shared_ptr<object>> elements;
+  elements.reserve(count);
+  for(size_t i = 0; i < count; ++i)
+  {
+    values[i] = static_cast<double>(i % 1000) * 0.25;
+    elements.push_back(std::make_shared<floating>(values[i]));
+  }
+  auto big = std::make_shared<array>(elements);
+
+  //what the same sum costs over a plain array of doubles
+  volatile double sink = 0;
+  auto native = lea_bench::best_of(3, [&] {
+    double total = 0;
+    for(auto v : values)
+      total += v;
+    sink = total;
+  });
+  std::printf("%-10s: %7.2f ms, %6.2f ns per element (total %g)\n", "native", native * 1000, native / count * 1e9, static_cast<double>(sink));
+
+  run("sum", "var total = sum(big)", big);
+  run("mean", "var total = mean(big)", big);
+  run("for", "var total = 0.0; for (x in big) { var total = total + x }", big);
+  //the temporaries of the chain are reused, only the value kept in total is made new
+  run("chain", "var total = 0.0; for (x in big) { var total = total + (x * 1.5 + 0.25) * 2.0 - 1.0 }", big);
+}
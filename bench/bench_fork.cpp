@@ -0,0 +1,57 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "fork_join.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+using namespace my_ns;
+
+//fib on integers goes through the specialized code, on floats through the generic evaluator
+static const char* functions =
+  "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };"
+  "var ffib = fun(n) { if (n < 2) { n * 1.0 } else { ffib(n - 1) + ffib(n - 2) } };"
+  "var tree = fun(d) { if (d == 0) { [d] } else { [tree(d - 1), tree(d - 1)] } };"
+  "var leaves = fun(t) { if (len(t) == 1) { 1 } else { leaves(t[0]) + leaves(t[1]) } };";
+
+static double run(const std::string& call, size_t threads, std::string& result)
+{
+  get_fork_join_pool().resize(threads);
+  return lea_bench::best_of(3, [&] {
+    auto source = std::string(functions) + "var total = " + call + ";";
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+}
+
+int main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 27;
+  size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  std::printf("%zu cores\n", cores);
+  for(const auto& call : { "fib(" + std::to_string(n) + ")", "ffib(" + std::to_string(n - 4) + ")", "leaves(tree(" + std::to_string(n - 9) + "))" })
+  {
+    std::string sequential_result;
+    auto sequential = run(call, 1, sequential_result);
+    std::printf("%-20s: 1 thread %9.2f ms (%s)\n", call.c_str(), sequential * 1000, sequential_result.c_str());
+    for(size_t threads = 2; threads <= std::max<size_t>(cores, 16); threads *= 2)
+    {
+      std::string result;
+      auto seconds = run(call, threads, result);
+      std::printf("%-20s: %zu threads %8.2f ms, %5.2fx (%s)\n", call.c_str(), threads, seconds * 1000, sequential / seconds,
+                  result == sequential_result ? "same" : result.c_str());
+    }
+  }
+}
@@ -0,0 +1,70 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace my_ns;
+
+//a global read from inside nested calls, walking the scopes against the node's cached cell
+static void lookups(size_t count, size_t depth)
+{
+  auto global = std::make_shared<environment>();
+  for(size_t i = 0; i < 200; ++i)
+    global->set(intern("global_" + std::to_string(i)), std::make_shared<integer>(i));
+  std::vector<std::shared_ptr<environment>> scopes = { global };
+  for(size_t i = 0; i < depth; ++i)
+  {
+    scopes.push_back(std::make_shared<environment>(scopes.back()));
+    scopes.back()->set(intern("param_" + std::to_string(i)), std::make_shared<integer>(i));
+  }
+  auto& env = scopes.back();
+
+  std::string name = "global_42";
+  auto ident = std::make_shared<identifire>(token{}, name);
+  volatile size_t sink = 0;
+
+  auto walked = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>((*env->get(ident->sym))->get_type());
+  });
+  auto cached = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>(eval_identifire(ident, env)->get_type());
+  });
+  std::printf("depth %2zu: walk %5.1f ns, cached %5.1f ns, %.2fx\n", depth, walked / count * 1e9, cached / count * 1e9, walked / cached);
+}
+
+//a top level recursive function, every self call resolves its own name
+static void recursion(size_t calls)
+{
+  std::string source =
+    "var count = fun(n, acc) { if (n == 0) { acc } else { count(n - 1, acc + 1) } };\n"
+    "var total = 0;\n";
+  for(size_t i = 0; i < calls / 1000; ++i)
+    source += "var total = total + count(1000, 0);\n";
+
+  std::string result;
+  auto seconds = lea_bench::best_of(5, [&] {
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+  std::printf("recursion: %.1f ms for %zu calls (total %s)\n", seconds * 1000, calls, result.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 5000000;
+  std::printf("%zu lookups per depth\n", count);
+  for(size_t depth : { 1, 2, 4, 8 })
+    lookups(count, depth);
+  recursion(count / 25);
+}
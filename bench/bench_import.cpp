@@ -0,0 +1,47 @@
+#include "bench_common.hpp"
+#include "module.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <thread>
+
+using namespace my_ns;
+
+//a main script importing modules that each import a shared helper, parsed on n threads
+static void run(const std::filesystem::path& main, size_t threads, size_t modules)
+{
+  size_t parsed = 0;
+  get_fork_join_pool().resize(threads);
+  auto seconds = lea_bench::best_of(3, [&] {
+    module_cache cache;
+    cache.prefetch({ main });
+    parsed = cache.size();
+  });
+  std::printf("import graph, %2zu threads: %.1f ms (%zu of %zu files)\n", threads, seconds * 1000, parsed, modules + 2);
+}
+
+int main(int argc, char** argv)
+{
+  size_t modules = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 100;
+  auto dir = std::filesystem::temp_directory_path() / "lea_bench_import";
+  std::filesystem::create_directories(dir);
+
+  std::ofstream(dir / "helper.lea") << lea_bench::generate_library_script(600);
+  std::string main;
+  for(size_t i = 0; i < modules; ++i)
+  {
+    auto n = std::to_string(i);
+    std::ofstream(dir / ("module_" + n + ".lea")) << "var helper = import \"helper.lea\";\n" << lea_bench::generate_library_script(3000);
+    main += "var module_" + n + " = import \"module_" + n + ".lea\";\n";
+  }
+  std::ofstream(dir / "main.lea") << main;
+
+  size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  std::printf("%zu modules of 3000 lines, %zu cores\n", modules, cores);
+  for(size_t threads = 1; threads < cores; threads *= 2)
+    run(dir / "main.lea", threads, modules);
+  run(dir / "main.lea", cores, modules);
+
+  std::filesystem::remove_all(dir);
+}
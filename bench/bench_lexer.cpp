@@ -0,0 +1,32 @@
+#include "bench_common.hpp"
+#include "lexer.hpp"
+
+#include <cstdlib>
+
+using namespace my_ns;
+
+static void run(const char* profile, const std::string& source)
+{
+  size_t tokens = 0;
+  auto seconds = lea_bench::best_of(5, [&] {
+    tokens = 0;
+    lexer lx(source);
+    while(lx.next_token().type != token_type::eof)
+      ++tokens;
+  });
+
+#if defined(LEA_NO_SIMD)
+  const char* mode = "scalar";
+#else
+  const char* mode = "simd";
+#endif
+  auto mb = source.size() / 1048576.0;
+  std::printf("lexer %-6s (%s): %.1f MB in %.3f s, %zu tokens, %.0f MB/s\n", mode, profile, mb, seconds, tokens, mb / seconds);
+}
+
+int main(int argc, char** argv)
+{
+  size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 64;
+  run("code", lea_bench::generate_script(mb << 20));
+  run("data", lea_bench::generate_data_script(mb << 20));
+}
@@ -0,0 +1,52 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace my_ns;
+
+static void run(const char* name, const std::string& source, const std::shared_ptr<array>& big)
+{
+  std::string result;
+  auto seconds = lea_bench::best_of(3, [&] {
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    env->set(intern("big"), big);
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+  std::printf("%-9s: %7.1f ms, %5.1f ns per element (total %s)\n", name, seconds * 1000, seconds / big->get_elements().size() * 1e9, result.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+  count = count / 1000 * 1000;
+  std::printf("elements: %zu\n", count);
+
+  std::vector<std::shared_ptr<object>> elements;
+  elements.reserve(count);
+  for(size_t i = 0; i < count; ++i)
+    elements.push_back(std::make_shared<integer>(static_cast<int64_t>(i % 1000)));
+  auto big = std::make_shared<array>(elements);
+
+  //without loops a sum is a recursive call per element, capped in depth so it's run in chunks
+  std::string recursion =
+    "var walk = fun(i, end, acc) { if (i == end) { acc } else { walk(i + 1, end, acc + big[i]) } };\n"
+    "var total = 0;\n";
+  for(size_t i = 0; i < count; i += 1000)
+    recursion += "var total = total + walk(" + std::to_string(i) + ", " + std::to_string(i + 1000) + ", 0);\n";
+  run("recursion", recursion, big);
+
+  run("while", "var total = 0; var i = 0; while (i < " + std::to_string(count) + ") { var total = total + big[i]; var i = i + 1 }", big);
+  run("for", "var total = 0; for (x in big) { var total = total + x }", big);
+}
@@ -0,0 +1,64 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "memo.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <string>
+
+using namespace my_ns;
+
+static const char* functions =
+  "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };"
+  "var paths = fun(r, c) { if (r == 0) { 1 } else { if (c == 0) { 1 } else { paths(r - 1, c) + paths(r, c - 1) } } };"
+  "var mfib = memo(fun(n) { if (n < 2) { n } else { mfib(n - 1) + mfib(n - 2) } });";
+
+//a fresh program each time so no cache outlives its run
+static double run(const std::string& call, bool auto_memo, std::string& result)
+{
+  get_optimizer().set_auto_memo(auto_memo);
+  return lea_bench::best_of(3, [&] {
+    auto source = std::string(functions) + "var total = " + call + ";";
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+}
+
+int main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 25;
+  auto fib = "fib(" + std::to_string(n) + ")";
+  auto paths = "paths(" + std::to_string(n / 2) + ", " + std::to_string(n / 2) + ")";
+  for(const auto& call : { fib, paths })
+  {
+    std::string plain_result;
+    std::string memo_result;
+    auto plain = run(call, false, plain_result);
+    auto memoized = run(call, true, memo_result);
+    std::printf("%-16s: plain %9.2f ms, auto memo %7.3f ms, %8.1fx (%s, %s)\n", call.c_str(), plain * 1000, memoized * 1000,
+                plain / memoized, plain_result.c_str(), plain_result == memo_result ? "same" : memo_result.c_str());
+  }
+
+  std::string result;
+  auto seconds = run("mfib(" + std::to_string(n) + ")", false, result);
+  std::printf("%-16s: memo(f)   %7.3f ms (%s)\n", ("mfib(" + std::to_string(n) + ")").c_str(), seconds * 1000, result.c_str());
+
+  //a cache too small for the working set keeps evicting, the results stay right
+  for(size_t capacity : { size_t(4), size_t(64), default_memo_capacity })
+  {
+    get_optimizer().set_memo_capacity(capacity);
+    seconds = run(paths, true, result);
+    const auto& memoized = get_optimizer().get_memoized();
+    const auto& stats = memoized.back().table->cache.get_stats();
+    std::printf("capacity %6zu: %8.3f ms, %zu hits, %zu misses, %zu evictions (%s)\n", capacity, seconds * 1000, stats.hits, stats.misses, stats.evictions, result.c_str());
+  }
+}
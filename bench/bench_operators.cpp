@@ -0,0 +1,90 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "object.hpp"
+
+#include <cstdlib>
+#include <vector>
+
+using namespace my_ns;
+
+//how infix operators were evaluated before they were resolved at parse time, kept as the baseline
+static std::shared_ptr<object> string_dispatch(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
+{
+  if(left->get_type() == object_type::integer && right->get_type() == object_type::integer)
+  {
+    auto left_val = std::static_pointer_cast<integer>(left)->get_value();
+    auto right_val = std::static_pointer_cast<integer>(right)->get_value();
+    if(op == "+")
+      return std::make_shared<integer>(left_val + right_val);
+    if(op == "-")
+      return std::make_shared<integer>(left_val - right_val);
+    if(op == "*")
+      return std::make_shared<integer>(left_val * right_val);
+    if(op == "/")
+      return std::make_shared<integer>(left_val / right_val);
+    if(op == "<")
+      return to_boolean(left_val < right_val);
+    if(op == ">")
+      return to_boolean(left_val > right_val);
+    if(op == "==")
+      return to_boolean(left_val == right_val);
+    if(op == "!=")
+      return to_boolean(left_val != right_val);
+    return add_error("unknown operator: " + op);
+  }
+  else if(left->get_type() == object_type::boolean && right->get_type() == object_type::boolean)
+  {
+    auto left_val = std::static_pointer_cast<boolean>(left)->get_value();
+    auto right_val = std::static_pointer_cast<boolean>(right)->get_value();
+    if(op == "==")
+      return to_boolean(left_val == right_val);
+    if(op == "!=")
+      return to_boolean(left_val != right_val);
+    return get_null();
+  }
+  else if(left->get_type() == object_type::string && right->get_type() == object_type::string)
+  {
+    if(op != "+")
+      return add_error("unknown operator: " + op);
+    return string::concat(std::static_pointer_cast<string>(left), std::static_pointer_cast<string>(right));
+  }
+  return add_error("type mismatch: " + op);
+}
+
+static void run(const char* op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right, size_t count)
+{
+  std::string op_str = op;
+  auto op_type = to_operator(op_str);
+  volatile size_t sink = 0;
+
+  auto by_string = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>(string_dispatch(op_str, left, right)->get_type());
+  });
+  auto by_table = lea_bench::best_of(3, [&] {
+    for(size_t i = 0; i < count; ++i)
+      sink = sink + static_cast<size_t>(eval_infix_expression(op_type, left, right)->get_type());
+  });
+  auto type = left->get_type() == object_type::integer ? "int" : left->get_type() == object_type::boolean ? "bool" : "string";
+  std::printf("%-6s %-2s: strings %6.1f ns, table %6.1f ns, %.2fx\n", type, op, by_string / count * 1e9, by_table / count * 1e9, by_string / by_table);
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+  std::printf("%zu evaluations per operator\n", count);
+
+  auto a = std::make_shared<integer>(12345);
+  auto b = std::make_shared<integer>(67);
+  for(auto op : { "+", "-", "*", "/", "<", ">", "==", "!=" })
+    run(op, a, b, count);
+
+  auto t = to_boolean(true);
+  auto f = to_boolean(false);
+  for(auto op : { "==", "!=" })
+    run(op, t, f, count);
+
+  auto s = std::make_shared<string>("left");
+  auto u = std::make_shared<string>("right");
+  run("+", s, u, count);
+}
@@ -0,0 +1,97 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+
+using namespace my_ns;
+
+//a recursive function whose body is full of literals, constant arithmetic and a constant if
+static std::string generate_script(size_t calls)
+{
+  std::string source =
+    "var day = fun(n, acc) {\n"
+    "  var secs = 60 * 60 * 24 + (1000 - 999) * 0;\n"
+    "  var tag = \"day\" + \"-\" + \"seconds\";\n"
+    "  var extra = if (1 < 2) { 1 } else { 2 };\n"
+    "  if (n == 0) { acc } else { day(n - 1, acc + secs + extra) }\n"
+    "};\n"
+    "var total = 0;\n";
+  //recursion is capped, many short chains instead of one long one
+  for(size_t i = 0; i < calls / 1000; ++i)
+    source += "var total = total + day(1000, 0);\n";
+  return source;
+}
+
+//the same recursion spending its time in small helpers
+static std::string generate_helper_script(size_t calls)
+{
+  std::string source =
+    "var sq = fun(x) { x * x };\n"
+    "var clamp = fun(x, lo, hi) { if (x < lo) { lo } else { if (x > hi) { hi } else { x } } };\n"
+    "var mix = fun(a, b) { var s = a + b; s * 3 - a };\n"
+    "var step = fun(n, acc) {\n"
+    "  if (n == 0) { acc } else { step(n - 1, acc + clamp(sq(n), 10, 500) + mix(n, sq(2))) }\n"
+    "};\n"
+    "var total = 0;\n";
+  for(size_t i = 0; i < calls / 1000; ++i)
+    source += "var total = total + step(1000, 0);\n";
+  return source;
+}
+
+//the same recursion calling builtins on every step
+static std::string generate_builtin_script(size_t calls)
+{
+  std::string source =
+    "var walk = fun(n, acc) {\n"
+    "  if (n == 0) { acc } else { walk(n - 1, acc + len(push([n, n], n)) + str_len(trim(\" ab \"))) }\n"
+    "};\n"
+    "var total = 0;\n";
+  for(size_t i = 0; i < calls / 1000; ++i)
+    source += "var total = total + walk(1000, 0);\n";
+  return source;
+}
+
+static void run(const char* name, const std::string& source, bool optimize, size_t inline_budget, bool intrinsics = true)
+{
+  std::string result;
+  get_optimizer().set_enabled(optimize);
+  get_optimizer().set_inline_budget(inline_budget);
+  get_optimizer().set_intrinsics(intrinsics);
+  auto before = get_optimizer().get_stats();
+  auto seconds = lea_bench::best_of(5, [&] {
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+  const auto& after = get_optimizer().get_stats();
+  std::printf("%-10s: %.1f ms (total %s), per run %zu folded, %zu pruned, %zu inlined, %zu intrinsics, %zu nodes removed\n",
+              name, seconds * 1000, result.c_str(), (after.folded - before.folded) / 5, (after.pruned - before.pruned) / 5,
+              (after.inlined - before.inlined) / 5, (after.intrinsics - before.intrinsics) / 5, (after.removed - before.removed) / 5);
+}
+
+int main(int argc, char** argv)
+{
+  size_t calls = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 200000;
+  std::printf("calls: %zu\n", calls);
+
+  auto constants = generate_script(calls);
+  run("no opt", constants, false, 0);
+  run("optimized", constants, true, 32);
+
+  auto helpers = generate_helper_script(calls);
+  run("no inline", helpers, true, 0);
+  run("inlined", helpers, true, 32);
+
+  auto builtins = generate_builtin_script(calls);
+  run("lookup", builtins, true, 32, false);
+  run("intrinsic", builtins, true, 32, true);
+}
@@ -0,0 +1,65 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "fork_join.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace my_ns;
+
+//pure functions, so every builtin but reduce spreads its calls over the pool
+static const char* functions =
+  "var sq = fun(x) { x * x + 1 };"
+  "var odd = fun(x) { x - (x / 2) * 2 == 1 };"
+  "var add = fun(a, b) { a + b };";
+
+static double run(const std::string& call, const std::shared_ptr<array>& big, size_t threads, std::string& result)
+{
+  get_fork_join_pool().resize(threads);
+  return lea_bench::best_of(3, [&] {
+    auto source = std::string(functions) + "var total = " + call + ";";
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    env->set(intern("big"), big);
+    eval(prog, env);
+    auto total = env->get("total");
+    result = !total ? "missing" : (*total)->get_type() == object_type::array ? std::to_string(std::static_pointer_cast<array>(*total)->get_elements().size()) + " elements" : (*total)->inspect();
+  });
+}
+
+int main(int argc, char** argv)
+{
+  size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 10000000;
+  size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  std::printf("elements: %zu, %zu cores\n", count, cores);
+
+  std::vector<std::shared_ptr<object>> elements;
+  elements.reserve(count);
+  for(size_t i = 0; i < count; ++i)
+    elements.push_back(std::make_shared<integer>(static_cast<int64_t>(i % 1000)));
+  auto big = std::make_shared<array>(std::move(elements));
+
+  for(const char* call : { "map(big, sq)", "filter(big, odd)", "for_each(big, sq)", "reduce(big, add, 0)" })
+  {
+    std::string sequential_result;
+    auto sequential = run(call, big, 1, sequential_result);
+    std::printf("%-20s: 1 thread %9.2f ms, %6.2f ns per element (%s)\n", call, sequential * 1000, sequential / count * 1e9, sequential_result.c_str());
+    for(size_t threads = 2; threads <= std::max<size_t>(cores, 16); threads *= 2)
+    {
+      std::string result;
+      auto seconds = run(call, big, threads, result);
+      std::printf("%-20s: %zu threads %8.2f ms, %5.2fx (%s)\n", call, threads, seconds * 1000, sequential / seconds,
+                  result == sequential_result ? "same" : result.c_str());
+    }
+  }
+}
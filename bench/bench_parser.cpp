@@ -0,0 +1,69 @@
+#include "bench_common.hpp"
+#include "flat_parser.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+using namespace my_ns;
+
+//every allocation carries its size so live heap bytes can be measured around a parse
+static std::atomic<size_t> s_live_bytes = 0;
+
+void* operator new(size_t size)
+{
+  auto* block = static_cast<size_t*>(std::malloc(size + sizeof(std::max_align_t)));
+  if(!block)
+    throw std::bad_alloc();
+  *block = size;
+  s_live_bytes += size;
+  return reinterpret_cast<char*>(block) + sizeof(std::max_align_t);
+}
+
+void operator delete(void* ptr) noexcept
+{
+  if(!ptr)
+    return;
+  auto* block = reinterpret_cast<size_t*>(static_cast<char*>(ptr) - sizeof(std::max_align_t));
+  s_live_bytes -= *block;
+  std::free(block);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+  operator delete(ptr);
+}
+
+template <typename Parse>
+static void run(const char* name, const std::string& source, Parse&& parse)
+{
+  auto seconds = lea_bench::best_of(5, [&] { parse(); });
+
+  size_t before = s_live_bytes;
+  auto ast = parse();
+  size_t held = s_live_bytes - before;
+
+  auto mb = source.size() / 1048576.0;
+  std::printf("parse %-5s: %.1f MB in %.3f s, %.0f MB/s, AST holds %.1f MB (%.1f bytes per source byte)\n",
+    name, mb, seconds, mb / seconds, held / 1048576.0, double(held) / source.size());
+}
+
+int main(int argc, char** argv)
+{
+  size_t mb = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 16;
+  auto source = lea_bench::generate_script(mb << 20);
+
+  run("tree", source, [&] {
+    lexer l(source);
+    parser p(&l);
+    return p.parse_program();
+  });
+
+  run("flat", source, [&] {
+    lexer l(source);
+    flat_parser p(&l, source);
+    return p.parse_program();
+  });
+}
@@ -0,0 +1,58 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "snapshot.hpp"
+
+#include <cstdlib>
+#include <filesystem>
+
+using namespace my_ns;
+
+//helper functions plus lookup tables, the kind of prelude that runs before any real work
+static std::string generate_prelude(size_t lines)
+{
+  auto out = lea_bench::generate_library_script(lines / 2);
+  for(size_t i = 0; i * 2 < lines; ++i)
+  {
+    auto n = std::to_string(i);
+    out += "var row_" + n + " = {\"id\": " + n + ", \"name\": \"row " + n + "\", \"tags\": [" + n + ", \"t" + n + "\"], \"get\": lib_" + std::to_string(i % 100) + "};\n";
+  }
+  return out;
+}
+
+int main(int argc, char** argv)
+{
+  size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+  auto source = generate_prelude(lines);
+  auto path = std::filesystem::temp_directory_path() / "lea_bench_prelude.leas";
+  std::printf("prelude: %zu lines, %.1f MB\n", lines, source.size() / 1048576.0);
+
+  std::shared_ptr<environment> env;
+  auto run = lea_bench::best_of(3, [&] {
+    lexer l(source);
+    parser p(&l);
+    env = std::make_shared<environment>();
+    eval(p.parse_program(), env);
+  });
+  auto saved = snapshot::save(path, env);
+  if(!saved)
+  {
+    std::printf("save failed: %s\n", saved.error().c_str());
+    return 1;
+  }
+  std::printf("snapshot: %.1f MB\n", std::filesystem::file_size(path) / 1048576.0);
+
+  std::shared_ptr<environment> restored;
+  auto load = lea_bench::best_of(3, [&] {
+    auto snap = snapshot::load(path);
+    restored = snap->restore();
+  });
+  auto snap = snapshot::load(path);
+  auto reset = lea_bench::best_of(5, [&] { restored = snap->restore(); });
+
+  std::printf("run prelude       : %.1f ms\n", run * 1000);
+  std::printf("load and restore  : %.1f ms\n", load * 1000);
+  std::printf("restore (reset)   : %.1f ms\n", reset * 1000);
+  std::filesystem::remove(path);
+}
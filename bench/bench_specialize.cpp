@@ -0,0 +1,50 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+#include <string>
+
+using namespace my_ns;
+
+static const char* functions =
+  "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };"
+  "var sum_to = fun(n) { var i = 0; var s = 0; while (i < n) { var i = i + 1; var s = s + i * 3; }; s };"
+  "var gcd = fun(a, b) { if (b == 0) { a } else { gcd(b, a - a / b * b) } };"
+  "var gcds = fun(n) { var i = 1; var s = 0; while (i < n) { var s = s + gcd(n, i); var i = i + 1; }; s };";
+
+//a fresh program each time so every literal is specialized, or not, on its first call
+static double run(const std::string& call, bool specialize, std::string& result)
+{
+  get_optimizer().set_specialize(specialize);
+  return lea_bench::best_of(3, [&] {
+    auto source = std::string(functions) + "var total = " + call + ";";
+    lexer l(source);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    auto total = env->get("total");
+    result = total ? (*total)->inspect() : "missing";
+  });
+}
+
+int main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 25;
+  auto fib = "fib(" + std::to_string(n) + ")";
+  for(const auto& call : { fib, std::string("sum_to(1000000)"), std::string("gcds(200000)") })
+  {
+    std::string generic_result;
+    std::string specialized_result;
+    auto generic = run(call, false, generic_result);
+    auto specialized = run(call, true, specialized_result);
+    std::printf("%-16s: generic %8.2f ms, specialized %8.2f ms, %5.1fx (%s, %s)\n", call.c_str(), generic * 1000, specialized * 1000,
+                generic / specialized, generic_result.c_str(), generic_result == specialized_result ? "same" : specialized_result.c_str());
+  }
+  std::printf("specialized: %zu functions\n", get_optimizer().get_stats().specialized);
+}
@@ -0,0 +1,33 @@
+#include "bench_common.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+
+#include <cstdlib>
+
+using namespace my_ns;
+
+static void run(const char* name, const std::string& source, bool lazy)
+{
+  std::string result;
+  auto seconds = lea_bench::best_of(5, [&] {
+    lexer l(source);
+    parser p(&l, lazy);
+    auto prog = p.parse_program();
+    auto env = std::make_shared<environment>();
+    eval(prog, env);
+    result = env->get("lib_0") ? "ok" : "missing";
+  });
+  std::printf("startup %-5s: %.1f ms (%s)\n", name, seconds * 1000, result.c_str());
+}
+
+int main(int argc, char** argv)
+{
+  size_t lines = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 50000;
+  auto source = lea_bench::generate_library_script(lines);
+  std::printf("library: %zu lines, %.1f MB\n", lines, source.size() / 1048576.0);
+
+  run("eager", source, false);
+  run("lazy", source, true);
+}
@@ -0,0 +1,63 @@
+#include "bench_common.hpp"
+#include "runner.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+using namespace my_ns;
+
+//a whole script through the runner, what `lea --threads n` does, pure recursion and map
+static const char* script =
+  "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };\n"
+  "var ffib = fun(n) { if (n < 2) { n * 1.0 } else { ffib(n - 1) + ffib(n - 2) } };\n"
+  "var sq = fun(x) { var y = x * 1.5; y * y + 1.0 };\n"
+  "var a = fib(N);\n"
+  "var b = ffib(N - 4);\n"
+  "var c = map(XS, sq);\n";
+
+static double run(const std::filesystem::path& file, size_t threads)
+{
+  runner_options options;
+  options.threads = threads;
+  options.use_cache = false;
+  return lea_bench::best_of(3, [&] {
+    start_runner(file, options);
+  });
+}
+
+int main(int argc, char** argv)
+{
+  size_t n = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 27;
+  size_t cores = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+  size_t most = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : cores;
+
+  auto file = std::filesystem::temp_directory_path() / "lea_bench_threads.lea";
+  std::string source = script;
+  source.replace(source.find("fib(N)"), 6, "fib(" + std::to_string(n) + ")");
+  source.replace(source.find("ffib(N - 4)"), 11, "ffib(" + std::to_string(n - 4) + ")");
+  std::string xs = "[0";
+  for(size_t i = 1; i < 100000; ++i)
+    xs += ", " + std::to_string(i);
+  source.replace(source.find("XS"), 2, xs + "]");
+  std::ofstream(file) << source;
+
+  std::printf("fib(%zu), ffib(%zu) and a map over 100000 floats, %zu cores\n", n, n - 4, cores);
+  auto sequential = run(file, 1);
+  std::printf("--threads 1 : %9.2f ms\n", sequential * 1000);
+  for(size_t threads = 2; threads < most; threads *= 2)
+  {
+    auto seconds = run(file, threads);
+    std::printf("--threads %-2zu: %9.2f ms, %5.2fx\n", threads, seconds * 1000, sequential / seconds);
+  }
+  if(most > 1)
+  {
+    auto seconds = run(file, most);
+    std::printf("--threads %-2zu: %9.2f ms, %5.2fx\n", most, seconds * 1000, sequential / seconds);
+  }
+
+  std::filesystem::remove(file);
+}
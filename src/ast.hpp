@@ -1,39 +1,60 @@
 #pragma once
 
+#include "fork_join.hpp"
+#include "intern.hpp"
 #include "token.hpp"
 
+#include <functional>
 #include <memory>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace my_ns
 {
-  enum class node_type 
+  class shape;
+  class object;
+  class int_function;
+  struct memo_table;
+  struct fork_plan;
+
+  enum class node_type : uint8_t
   { 
     node, statement, expression, program, identifire,
     var, ret, expression_statement, block,
     integer, boolean, string, array, index, map,
-    prefix, infix, _if, fun, call
+    prefix, infix, _if, fun, call, _import, constant, inlined, intrinsic, _while, _for, floating
   };
 
-  //TODO
-  /*
-  enum class operator_type
+  //prefix and infix operators, resolved when the node is made so eval never compares strings
+  enum class operator_type : uint8_t
   {
-    bang,
-    assign,
-    equals,
-    less, 
-    greater,
-    astrisk,
-    slash,
-    plus,
-    minus,
-    call,
+    plus, minus, astrisk, slash, less, greater, equal, not_equal, bang, unknown
   };
-  */
+
+  constexpr size_t operator_type_count = static_cast<size_t>(operator_type::unknown) + 1;
+
+  inline operator_type to_operator(std::string_view op)
+  {
+    static constexpr std::pair<std::string_view, operator_type> ops[] = {
+      { "+", operator_type::plus }, { "-", operator_type::minus }, { "*", operator_type::astrisk },
+      { "/", operator_type::slash }, { "<", operator_type::less }, { ">", operator_type::greater },
+      { "==", operator_type::equal }, { "!=", operator_type::not_equal }, { "!", operator_type::bang },
+    };
+    for(const auto& [text, type] : ops)
+      if(text == op)
+        return type;
+    return operator_type::unknown;
+  }
+
+  inline std::string_view to_string(operator_type op)
+  {
+    static constexpr std::string_view names[] = { "+", "-", "*", "/", "<", ">", "==", "!=", "!", "?" };
+    return names[static_cast<size_t>(op)];
+  }
 
   class node
   {
@@ -114,14 +135,14 @@ namespace my_ns
   {
   public:
     identifire() = default;
-    identifire(token t, const std::string& val)
-      : expression(node_type::identifire), _token(t), value(val)
+    identifire(token t, std::string_view val)
+      : expression(node_type::identifire), _token(t), value(val), sym(intern(val))
     {
     }
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -129,9 +150,19 @@ namespace my_ns
       return value;
     }
 
+  public:
+    //the global this name resolved to last, it's good while the scope and the version still match
+    struct global_cache
+    {
+      const void* scope = nullptr;
+      const std::shared_ptr<object>* cell = nullptr;
+      uint64_t version = 0;
+    };
   public:
     token _token;
     std::string value;
+    symbol sym;
+    global_cache cache;
   };
 
   class var : public statement
@@ -144,7 +175,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -172,7 +203,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -199,7 +230,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -223,7 +254,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -250,38 +281,77 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
   public:
     token _token;
     int64_t value;
+    std::shared_ptr<object> pooled; //made once by the optimizer, returned by every evaluation
+  };
+
+  class float_literal : public expression
+  {
+  public:
+    float_literal(token tok)
+      : expression(node_type::floating), _token(tok)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return std::string(_token.literal);
+    }
+
+    std::string to_string() override
+    {
+      return std::string(_token.literal);
+    }
+  public:
+    token _token;
+    double value = 0;
+    std::shared_ptr<object> pooled; //made once by the optimizer, returned by every evaluation
   };
 
   class string_literal : public expression
   {
   public:
-    string_literal(token tok, const std::string& val)
-      : expression(node_type::string), _token(tok), value(val)
+    string_literal(token tok, std::string_view val)
+      : expression(node_type::string), _token(tok), buffer(std::make_shared<const std::string>(val))
+    {
+    }
+
+    //interned the first time the literal is used as a record key, the intern table
+    //is never freed and most literals are only data
+    inline symbol get_symbol()
     {
+      if(!m_symbol.empty())
+        return m_symbol;
+      auto sym = intern(*buffer);
+      if(!in_parallel())
+        m_symbol = sym;
+      return sym;
     }
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
   public:
     token _token;
-    std::string value;
+    std::shared_ptr<const std::string> buffer; //shared with every runtime string made from it
+    std::shared_ptr<object> pooled; //made once by the optimizer, returned by every evaluation
+  private:
+    symbol m_symbol;
   };
 
 
@@ -295,12 +365,12 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
   public:
     token _token;
@@ -317,7 +387,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -333,6 +403,8 @@ namespace my_ns
   public:
     token _token;
     std::vector<std::shared_ptr<expression>> elements;
+    //set by the optimizer when two or more elements are calls that may run as forks
+    bool fork = false;
   };
 
   class map_literal : public expression
@@ -345,7 +417,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -361,6 +433,11 @@ namespace my_ns
   public:
     token _token;
     std::unordered_map<std::shared_ptr<expression>, std::shared_ptr<expression>> pairs;
+
+    //filled on first eval when every key is a string literal, values are in slot order
+    bool record_checked = false;
+    const shape* record_shape = nullptr;
+    std::vector<std::shared_ptr<expression>> record_values;
   };
 
   class index : public expression 
@@ -373,7 +450,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -387,19 +464,23 @@ namespace my_ns
     token _token;
     std::shared_ptr<expression> left;
     std::shared_ptr<expression> right;
+
+    //monomorphic inline cache for constant string keys
+    const shape* cached_shape = nullptr;
+    uint32_t cached_slot = 0;
   };
 
   class prefix : public expression
   {
   public:
-    prefix(token tok, const std::string& op)
-      : expression(node_type::prefix), _token(tok), _operator(op)
+    prefix(token tok, std::string_view op)
+      : expression(node_type::prefix), _token(tok), _operator(op), op(to_operator(op))
     {
     }
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -411,20 +492,21 @@ namespace my_ns
   public:
     token _token;
     std::string _operator;
+    operator_type op;
     std::shared_ptr<expression> right;
   };
 
   class infix : public expression
   {
   public:
-    infix(token tok, const std::string& op, const std::shared_ptr<expression> expr)
-      : expression(node_type::infix), _token(tok), _operator(op), left(expr)
+    infix(token tok, std::string_view op, const std::shared_ptr<expression> expr)
+      : expression(node_type::infix), _token(tok), _operator(op), op(to_operator(op)), left(expr)
     {
     }
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -436,8 +518,11 @@ namespace my_ns
   public:
     token _token;
     std::string _operator;
+    operator_type op;
     std::shared_ptr<expression> left;
     std::shared_ptr<expression> right;
+    //set by the optimizer when both sides are calls that may run as forks
+    bool fork = false;
   };
 
   class _if : public expression
@@ -450,7 +535,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -469,6 +554,57 @@ namespace my_ns
     std::shared_ptr<block> alternative;
   };
 
+  class _while : public expression
+  {
+  public:
+    _while(token tok)
+      : expression(node_type::_while), _token(tok)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return std::string(_token.literal);
+    }
+
+    std::string to_string() override
+    {
+      std::stringstream ss;
+      ss << "while " << condition->to_string() << " " << body->to_string();
+      return ss.str();
+    }
+  public:
+    token _token;
+    std::shared_ptr<expression> condition;
+    std::shared_ptr<block> body;
+  };
+
+  class _for : public expression
+  {
+  public:
+    _for(token tok)
+      : expression(node_type::_for), _token(tok)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return std::string(_token.literal);
+    }
+
+    std::string to_string() override
+    {
+      std::stringstream ss;
+      ss << "for " << variable.to_string() << " in " << iterable->to_string() << " " << body->to_string();
+      return ss.str();
+    }
+  public:
+    token _token;
+    identifire variable;
+    std::shared_ptr<expression> iterable;
+    std::shared_ptr<block> body;
+  };
+
   class fun_literal : public expression
   {
   public:
@@ -479,7 +615,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -489,7 +625,13 @@ namespace my_ns
       ss << token_literal() << "(";
       for(const auto& param : parameters)
         ss << param->to_string() << ", ";
-      ss << ") " << body->to_string();
+      ss << ") ";
+      if(!body && load_body)
+        body = load_body();
+      if(body)
+        ss << body->to_string();
+      else
+        ss << body_source;
 
       return ss.str();
     }
@@ -497,6 +639,24 @@ namespace my_ns
     token _token;
     std::vector<std::shared_ptr<identifire>> parameters;
     std::shared_ptr<block> body;
+    //set instead of body when the parser skipped it, the braces and everything between
+    std::string_view body_source;
+    //set instead of body when the body is already parsed but not built yet
+    std::function<std::shared_ptr<block>()> load_body;
+    //the whole literal from fun to the closing brace, enough to parse it again
+    std::string_view source;
+    //the body compiled for integer arguments, looked for on the first call. not used again
+    //once a call had to give up on it
+    std::shared_ptr<int_function> specialized;
+    bool specialize_checked = false;
+    //the cache automatic memoization put in front of the body, when the body is pure
+    std::shared_ptr<memo_table> memo;
+    bool memo_checked = false;
+    //what calls to it running as forks rely on, when the body is pure
+    std::shared_ptr<fork_plan> fork;
+    bool fork_checked = false;
+    //counted in the optimizer's pure functions, whichever check found it first
+    bool pure_counted = false;
   };
 
   class call : public expression
@@ -509,7 +669,7 @@ namespace my_ns
 
     std::string token_literal() override
     {
-      return _token.literal;
+      return std::string(_token.literal);
     }
 
     std::string to_string() override
@@ -527,4 +687,105 @@ namespace my_ns
     std::shared_ptr<expression> function;
     std::vector<std::shared_ptr<expression>> arguments;
   };
+
+  class import_expression : public expression
+  {
+  public:
+    import_expression(token tok, std::string_view path)
+      : expression(node_type::_import), _token(tok), path(path)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return std::string(_token.literal);
+    }
+
+    std::string to_string() override
+    {
+      return "import \"" + path + "\"";
+    }
+  public:
+    token _token;
+    std::string path; //as written in the script
+    std::string resolved; //filled in by the module cache once the importing file is known
+  };
+
+  //what the optimizer folds an expression into, the value is made once
+  class constant : public expression
+  {
+  public:
+    constant(token tok, const std::shared_ptr<object>& value, std::string text)
+      : expression(node_type::constant), _token(tok), value(value), text(std::move(text))
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return std::string(_token.literal);
+    }
+
+    std::string to_string() override
+    {
+      return text;
+    }
+  public:
+    token _token;
+    std::shared_ptr<object> value;
+    std::string text; //the value's inspect, ast.hpp can't see objects
+  };
+
+  //a call the optimizer replaced with a copy of the callee's body. the copy's params and
+  //locals are renamed so it runs in the caller's environment, the call itself is kept for
+  //when the name no longer holds the function the copy was made from
+  class inlined_call : public expression
+  {
+  public:
+    inlined_call(const std::shared_ptr<call>& original, const std::shared_ptr<fun_literal>& target)
+      : expression(node_type::inlined), original(original), target(target)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return original->token_literal();
+    }
+
+    std::string to_string() override
+    {
+      return original->to_string();
+    }
+  public:
+    std::shared_ptr<call> original;
+    std::shared_ptr<fun_literal> target;
+    //the argument each renamed param is bound to, constant arguments are in the body instead
+    std::vector<std::pair<size_t, symbol>> parameters;
+    std::shared_ptr<block> body;
+    std::vector<symbol> builtins; //free names in the body, they must still find the builtin
+  };
+
+  //a call to a builtin bound when the tree was optimized, it skips the environment and
+  //calls the function straight away until some environment binds the builtin's name
+  class intrinsic_call : public expression
+  {
+  public:
+    intrinsic_call(const std::shared_ptr<call>& original, const symbol& name, const std::shared_ptr<object>& target)
+      : expression(node_type::intrinsic), original(original), name(name), target(target)
+    {
+    }
+
+    std::string token_literal() override
+    {
+      return original->token_literal();
+    }
+
+    std::string to_string() override
+    {
+      return original->to_string();
+    }
+  public:
+    std::shared_ptr<call> original;
+    symbol name;
+    std::shared_ptr<object> target; //the builtin
+  };
 }
@@ -0,0 +1,348 @@
+#include "bignum.hpp"
+
+#include <algorithm>
+#include <bit>
+
+namespace my_ns
+{
+  namespace
+  {
+    using limb = bignum::limb;
+    using limbs = bignum::limbs;
+
+    //below this many limbs in the smaller operand the schoolbook product is faster than splitting
+    constexpr size_t karatsuba_threshold = 48;
+
+    void trim(limbs& mag)
+    {
+      while(!mag.empty() && mag.back() == 0)
+        mag.pop_back();
+    }
+
+    int compare_magnitude(const limbs& a, const limbs& b)
+    {
+      if(a.size() != b.size())
+        return a.size() < b.size() ? -1 : 1;
+      for(size_t i = a.size(); i-- > 0;)
+        if(a[i] != b[i])
+          return a[i] < b[i] ? -1 : 1;
+      return 0;
+    }
+
+    limbs add_magnitude(const limbs& a, const limbs& b)
+    {
+      const auto& longer = a.size() >= b.size() ? a : b;
+      const auto& shorter = a.size() >= b.size() ? b : a;
+      limbs out(longer.size() + 1);
+      uint64_t carry = 0;
+      for(size_t i = 0; i < longer.size(); ++i)
+      {
+        uint64_t sum = uint64_t(longer[i]) + (i < shorter.size() ? shorter[i] : 0) + carry;
+        out[i] = static_cast<limb>(sum);
+        carry = sum >> 32;
+      }
+      out[longer.size()] = static_cast<limb>(carry);
+      trim(out);
+      return out;
+    }
+
+    //a - b, a is at least as big as b
+    limbs sub_magnitude(const limbs& a, const limbs& b)
+    {
+      limbs out(a.size());
+      int64_t borrow = 0;
+      for(size_t i = 0; i < a.size(); ++i)
+      {
+        int64_t diff = int64_t(a[i]) - (i < b.size() ? b[i] : 0) - borrow;
+        borrow = diff < 0;
+        out[i] = static_cast<limb>(diff);
+      }
+      trim(out);
+      return out;
+    }
+
+    //out has na + nb zeroed limbs
+    void schoolbook(const limb* a, size_t na, const limb* b, size_t nb, limb* out)
+    {
+      for(size_t i = 0; i < na; ++i)
+      {
+        uint64_t carry = 0;
+        for(size_t j = 0; j < nb; ++j)
+        {
+          uint64_t cur = uint64_t(a[i]) * b[j] + out[i + j] + carry;
+          out[i + j] = static_cast<limb>(cur);
+          carry = cur >> 32;
+        }
+        out[i + nb] = static_cast<limb>(carry);
+      }
+    }
+
+    //out += x shifted up by shift limbs, out is long enough for the sum
+    void add_shifted(limbs& out, const limbs& x, size_t shift)
+    {
+      uint64_t carry = 0;
+      size_t i = 0;
+      for(; i < x.size(); ++i)
+      {
+        uint64_t sum = uint64_t(out[i + shift]) + x[i] + carry;
+        out[i + shift] = static_cast<limb>(sum);
+        carry = sum >> 32;
+      }
+      for(; carry; ++i)
+      {
+        uint64_t sum = uint64_t(out[i + shift]) + carry;
+        out[i + shift] = static_cast<limb>(sum);
+        carry = sum >> 32;
+      }
+    }
+
+    limbs multiply_magnitude(const limbs& a, const limbs& b);
+
+    //a * b = z2 * B^2m + z1 * B^m + z0 with three half size products instead of four
+    limbs karatsuba(const limbs& a, const limbs& b)
+    {
+      size_t m = std::max(a.size(), b.size()) / 2;
+      const auto split = [m](const limbs& x, limbs& lo, limbs& hi)
+      {
+        lo.assign(x.begin(), x.begin() + std::min(m, x.size()));
+        trim(lo);
+        if(x.size() > m)
+          hi.assign(x.begin() + m, x.end());
+      };
+      limbs a0, a1, b0, b1;
+      split(a, a0, a1);
+      split(b, b0, b1);
+
+      auto z0 = multiply_magnitude(a0, b0);
+      auto z2 = multiply_magnitude(a1, b1);
+      auto z1 = multiply_magnitude(add_magnitude(a0, a1), add_magnitude(b0, b1));
+      z1 = sub_magnitude(sub_magnitude(z1, z0), z2);
+
+      limbs out(a.size() + b.size() + 1, 0);
+      add_shifted(out, z0, 0);
+      add_shifted(out, z1, m);
+      add_shifted(out, z2, 2 * m);
+      trim(out);
+      return out;
+    }
+
+    limbs multiply_magnitude(const limbs& a, const limbs& b)
+    {
+      if(a.empty() || b.empty())
+        return {};
+      if(std::min(a.size(), b.size()) < karatsuba_threshold)
+      {
+        limbs out(a.size() + b.size(), 0);
+        schoolbook(a.data(), a.size(), b.data(), b.size(), out.data());
+        trim(out);
+        return out;
+      }
+      return karatsuba(a, b);
+    }
+
+    limbs divide_small(const limbs& a, limb d, limb& remainder)
+    {
+      limbs q(a.size());
+      uint64_t rem = 0;
+      for(size_t i = a.size(); i-- > 0;)
+      {
+        uint64_t cur = (rem << 32) | a[i];
+        q[i] = static_cast<limb>(cur / d);
+        rem = cur % d;
+      }
+      trim(q);
+      remainder = static_cast<limb>(rem);
+      return q;
+    }
+
+    //knuth's algorithm D. both are normalized so the divisor's top bit is set, then each quotient
+    //limb is estimated from the top two limbs and corrected at most twice
+    limbs divide_magnitude(const limbs& a, const limbs& b)
+    {
+      if(compare_magnitude(a, b) < 0)
+        return {};
+      if(b.size() == 1)
+      {
+        limb rem;
+        return divide_small(a, b[0], rem);
+      }
+
+      int s = std::countl_zero(b.back());
+      size_t n = b.size();
+      size_t m = a.size() - n;
+      limbs vn(n);
+      limbs un(a.size() + 1);
+      for(size_t i = n - 1; i > 0; --i)
+        vn[i] = (b[i] << s) | static_cast<limb>(uint64_t(b[i - 1]) >> (32 - s));
+      vn[0] = b[0] << s;
+      un[a.size()] = static_cast<limb>(uint64_t(a.back()) >> (32 - s));
+      for(size_t i = a.size() - 1; i > 0; --i)
+        un[i] = (a[i] << s) | static_cast<limb>(uint64_t(a[i - 1]) >> (32 - s));
+      un[0] = a[0] << s;
+
+      constexpr uint64_t base = uint64_t(1) << 32;
+      limbs q(m + 1);
+      for(size_t j = m + 1; j-- > 0;)
+      {
+        uint64_t num = (uint64_t(un[j + n]) << 32) | un[j + n - 1];
+        uint64_t qhat = num / vn[n - 1];
+        uint64_t rhat = num % vn[n - 1];
+        while(qhat >= base || qhat * vn[n - 2] > ((rhat << 32) | un[j + n - 2]))
+        {
+          --qhat;
+          rhat += vn[n - 1];
+          if(rhat >= base)
+            break;
+        }
+
+        int64_t k = 0;
+        int64_t t = 0;
+        for(size_t i = 0; i < n; ++i)
+        {
+          uint64_t p = qhat * vn[i];
+          t = int64_t(un[i + j]) - k - int64_t(p & 0xffffffff);
+          un[i + j] = static_cast<limb>(t);
+          k = int64_t(p >> 32) - (t >> 32);
+        }
+        t = int64_t(un[j + n]) - k;
+        un[j + n] = static_cast<limb>(t);
+
+        q[j] = static_cast<limb>(qhat);
+        if(t < 0)
+        {
+          //the estimate was one too big, add the divisor back
+          --q[j];
+          uint64_t carry = 0;
+          for(size_t i = 0; i < n; ++i)
+          {
+            uint64_t sum = uint64_t(un[i + j]) + vn[i] + carry;
+            un[i + j] = static_cast<limb>(sum);
+            carry = sum >> 32;
+          }
+          un[j + n] = static_cast<limb>(uint64_t(un[j + n]) + carry);
+        }
+      }
+      trim(q);
+      return q;
+    }
+  }
+
+  bignum::bignum(int64_t value)
+    : m_negative(value < 0)
+  {
+    uint64_t mag = m_negative ? ~uint64_t(value) + 1 : uint64_t(value);
+    while(mag)
+    {
+      m_limbs.push_back(static_cast<limb>(mag));
+      mag >>= 32;
+    }
+  }
+
+  bignum::bignum(bool negative, limbs magnitude)
+    : m_negative(negative), m_limbs(std::move(magnitude))
+  {
+    trim(m_limbs);
+    if(m_limbs.empty())
+      m_negative = false;
+  }
+
+  bignum operator + (const bignum& a, const bignum& b)
+  {
+    if(a.m_negative == b.m_negative)
+      return bignum(a.m_negative, add_magnitude(a.m_limbs, b.m_limbs));
+
+    //the signs differ, the bigger magnitude keeps its sign
+    auto cmp = compare_magnitude(a.m_limbs, b.m_limbs);
+    if(cmp == 0)
+      return {};
+    if(cmp > 0)
+      return bignum(a.m_negative, sub_magnitude(a.m_limbs, b.m_limbs));
+    return bignum(b.m_negative, sub_magnitude(b.m_limbs, a.m_limbs));
+  }
+
+  bignum operator - (const bignum& a, const bignum& b)
+  {
+    return a + -b;
+  }
+
+  bignum operator * (const bignum& a, const bignum& b)
+  {
+    return bignum(a.m_negative != b.m_negative, multiply_magnitude(a.m_limbs, b.m_limbs));
+  }
+
+  bignum operator / (const bignum& a, const bignum& b)
+  {
+    return bignum(a.m_negative != b.m_negative, divide_magnitude(a.m_limbs, b.m_limbs));
+  }
+
+  bignum bignum::operator - () const
+  {
+    bignum out = *this;
+    if(!out.is_zero())
+      out.m_negative = !out.m_negative;
+    return out;
+  }
+
+  std::strong_ordering bignum::operator <=> (const bignum& other) const
+  {
+    if(m_negative != other.m_negative)
+      return m_negative ? std::strong_ordering::less : std::strong_ordering::greater;
+    auto cmp = compare_magnitude(m_limbs, other.m_limbs);
+    if(m_negative)
+      cmp = -cmp;
+    return cmp <=> 0;
+  }
+
+  bool bignum::fits_int64() const
+  {
+    if(m_limbs.size() > 2)
+      return false;
+    uint64_t mag = 0;
+    for(size_t i = m_limbs.size(); i-- > 0;)
+      mag = (mag << 32) | m_limbs[i];
+    constexpr uint64_t limit = uint64_t(1) << 63;
+    return m_negative ? mag <= limit : mag < limit;
+  }
+
+  int64_t bignum::to_int64() const
+  {
+    uint64_t mag = 0;
+    for(size_t i = m_limbs.size(); i-- > 0;)
+      mag = (mag << 32) | m_limbs[i];
+    return static_cast<int64_t>(m_negative ? ~mag + 1 : mag);
+  }
+
+  double bignum::to_double() const
+  {
+    double out = 0;
+    for(size_t i = m_limbs.size(); i-- > 0;)
+      out = out * 4294967296.0 + m_limbs[i];
+    return m_negative ? -out : out;
+  }
+
+  std::string bignum::to_string() const
+  {
+    if(is_zero())
+      return "0";
+
+    //nine decimal digits at a time, least significant chunk first
+    std::vector<limb> chunks;
+    auto mag = m_limbs;
+    while(!mag.empty())
+    {
+      limb rem;
+      mag = divide_small(mag, 1000000000, rem);
+      chunks.push_back(rem);
+    }
+
+    std::string out = m_negative ? "-" : "";
+    out += std::to_string(chunks.back());
+    for(size_t i = chunks.size() - 1; i-- > 0;)
+    {
+      auto digits = std::to_string(chunks[i]);
+      out.append(9 - digits.size(), '0');
+      out += digits;
+    }
+    return out;
+  }
+}
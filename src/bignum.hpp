@@ -0,0 +1,55 @@
+#pragma once
+
+#include <compare>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace my_ns
+{
+  //an integer of any size, a sign and a magnitude of 32 bit limbs, least significant first.
+  //the magnitude never has a zero limb on top and zero has no limbs, so equal values have
+  //equal limbs
+  class bignum
+  {
+  public:
+    using limb = uint32_t;
+    using limbs = std::vector<limb>;
+  public:
+    bignum() = default;
+    bignum(int64_t value);
+    bignum(bool negative, limbs magnitude);
+
+    friend bignum operator + (const bignum& a, const bignum& b);
+    friend bignum operator - (const bignum& a, const bignum& b);
+    friend bignum operator * (const bignum& a, const bignum& b);
+    //truncates toward zero like the int64 division it stands in for, b can't be zero
+    friend bignum operator / (const bignum& a, const bignum& b);
+    bignum operator - () const;
+
+    bool operator == (const bignum& other) const = default;
+    std::strong_ordering operator <=> (const bignum& other) const;
+
+    inline bool is_zero() const
+    {
+      return m_limbs.empty();
+    }
+    inline bool is_negative() const
+    {
+      return m_negative;
+    }
+    inline const limbs& get_limbs() const
+    {
+      return m_limbs;
+    }
+
+    bool fits_int64() const;
+    //only meaningful when fits_int64
+    int64_t to_int64() const;
+    double to_double() const;
+    std::string to_string() const;
+  private:
+    bool m_negative = false;
+    limbs m_limbs;
+  };
+}
@@ -0,0 +1,692 @@
+#include "builtins.hpp"
+#include "evaluator.hpp"
+#include "fork_join.hpp"
+#include "memo.hpp"
+#include "simd.hpp"
+
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <optional>
+
+namespace my_ns
+{
+  static std::shared_ptr<error> expect_type(const char* name, builtin::arguments args, size_t i, object_type type)
+  {
+    if(args[i]->get_type() == type)
+      return nullptr;
+    return add_error(std::string(name) + ": expects argument " + std::to_string(i) + " to be of type: '" + std::to_string((uint32_t)type) + "', got: " + std::to_string((uint32_t)args[i]->get_type()));
+  }
+
+  //negative indices clamp to 0, too big ones to max
+  static size_t clamp_index(int64_t idx, size_t max)
+  {
+    if(idx < 0)
+      return 0;
+    return std::min(static_cast<size_t>(idx), max);
+  }
+
+  static std::shared_ptr<error> not_hashable(const char* name, const std::shared_ptr<object>& obj)
+  {
+    return add_error(std::string(name) + ": type: " + std::to_string((uint32_t)obj->get_type()) + " is not hashable");
+  }
+
+  //set algebra builtins all take two sets
+  static std::shared_ptr<error> expect_two_sets(const char* name, builtin::arguments args)
+  {
+    if(args.size() != 2)
+      return add_error(std::string(name) + ": expected: 2 arguments, got: " + std::to_string(args.size()));
+    if(auto err = expect_type(name, args, 0, object_type::set))
+      return err;
+    return expect_type(name, args, 1, object_type::set);
+  }
+
+  //integers add up exactly on their own, floats in a double next to them. the int64 total
+  //spills into a bignum when it would overflow
+  struct number_sum
+  {
+    int64_t ints = 0;
+    bignum wide;
+    double floats = 0;
+    bool any_float = false;
+
+    inline double as_double() const
+    {
+      return floats + static_cast<double>(ints) + wide.to_double();
+    }
+  };
+
+  static std::expected<number_sum, std::shared_ptr<error>> sum_numbers(const char* name, builtin::arguments args)
+  {
+    if(auto err = expect_type(name, args, 0, object_type::array))
+      return std::unexpected(err);
+
+    number_sum sum;
+    const auto& elems = std::static_pointer_cast<array>(args[0])->get_elements();
+    for(size_t i = 0; i < elems.size(); ++i)
+    {
+      auto* elem = elems[i].get();
+      switch(elem->get_type())
+      {
+        case object_type::integer:
+        {
+          auto value = static_cast<integer*>(elem)->get_value();
+          int64_t next;
+          if(__builtin_add_overflow(sum.ints, value, &next)) [[unlikely]]
+          {
+            sum.wide = sum.wide + bignum(sum.ints);
+            next = value;
+          }
+          sum.ints = next;
+          break;
+        }
+        case object_type::big_integer:
+          sum.wide = sum.wide + static_cast<big_integer*>(elem)->get_value();
+          break;
+        case object_type::floating:
+          sum.floats += static_cast<floating*>(elem)->get_value();
+          sum.any_float = true;
+          break;
+        default:
+          return std::unexpected(add_error(std::string(name) + ": expects an array of numbers, element " + std::to_string(i) + " is of type: " + std::to_string((uint32_t)elem->get_type())));
+      }
+    }
+    return sum;
+  }
+
+  //hits, misses, evictions, calls skipped, entries and capacity of a cache, as a record
+  static std::shared_ptr<object> memo_record(const memo_cache& cache)
+  {
+    static const shape* s_shape = shape::get({ intern("hits"), intern("misses"), intern("evictions"), intern("skipped"), intern("size"), intern("capacity") });
+    const auto& stats = cache.get_stats();
+    std::vector<std::shared_ptr<object>> slots;
+    for(auto value : { stats.hits, stats.misses, stats.evictions, stats.skipped, cache.size(), cache.capacity() })
+      slots.push_back(std::make_shared<integer>(static_cast<int64_t>(value)));
+    return std::make_shared<map>(s_shape, std::move(slots));
+  }
+
+  //what map and the others call, anything that can be
+  static std::shared_ptr<error> expect_function(const char* name, builtin::arguments args, size_t i)
+  {
+    auto type = args[i]->get_type();
+    if(type == object_type::fun || type == object_type::builtin || type == object_type::memoized)
+      return nullptr;
+    return add_error(std::string(name) + ": expects argument " + std::to_string(i) + " to be a function, got: " + std::to_string((uint32_t)type));
+  }
+
+  //a fun whose calls can be forked or a builtin that only returns its result. what a memoized
+  //function wraps isn't looked into, it runs in order
+  static bool runs_in_parallel(const std::shared_ptr<object>& f)
+  {
+    if(f->get_type() == object_type::builtin)
+      return static_cast<builtin*>(f.get())->pure;
+    return ready_to_fork(f);
+  }
+
+  static bool failed(const std::shared_ptr<object>& res)
+  {
+    return res && res->get_type() == object_type::error;
+  }
+
+  //an empty body gives nothing back, what's kept from it is null
+  static std::shared_ptr<object> call(const std::shared_ptr<object>& f, const std::vector<std::shared_ptr<object>>& args)
+  {
+    auto res = invoke_function(f, args);
+    return res ? res : get_null();
+  }
+
+  //f on every element into results. a pure f runs on the pool, each call in a scope of its own,
+  //anything else in order up to the first error. either way the error that comes out is the
+  //first one in order
+  static std::shared_ptr<object> apply_each(const std::shared_ptr<object>& f, const std::vector<std::shared_ptr<object>>& elems, std::vector<std::shared_ptr<object>>& results)
+  {
+    results.resize(elems.size());
+    auto& pool = get_fork_join_pool();
+    if(elems.size() < 2 || !pool.worth_forking() || !runs_in_parallel(f))
+    {
+      std::vector<std::shared_ptr<object>> arg(1);
+      for(size_t i = 0; i < elems.size(); ++i)
+      {
+        arg[0] = elems[i];
+        results[i] = call(f, arg);
+        if(failed(results[i]))
+          return results[i];
+      }
+      return nullptr;
+    }
+
+    //a few pieces per thread so one that's done early has something to steal. past an error no
+    //piece goes on, the ones before it still run in case there's an earlier one
+    std::atomic<size_t> first_error = elems.size();
+    auto grain = std::max<size_t>(elems.size() / (pool.size() * 8), 1);
+    pool.for_range(0, elems.size(), grain, [&](size_t begin, size_t end) {
+      std::vector<std::shared_ptr<object>> arg(1);
+      for(auto i = begin; i < end && i < first_error.load(std::memory_order_relaxed); ++i)
+      {
+        arg[0] = elems[i];
+        results[i] = call(f, arg);
+        if(!failed(results[i]))
+          continue;
+        auto seen = first_error.load(std::memory_order_relaxed);
+        while(i < seen && !first_error.compare_exchange_weak(seen, i, std::memory_order_relaxed));
+        return;
+      }
+    });
+    auto at = first_error.load(std::memory_order_relaxed);
+    return at < elems.size() ? results[at] : nullptr;
+  }
+
+  //an array and the function called on its elements
+  static std::shared_ptr<error> expect_array_and_function(const char* name, builtin::arguments args)
+  {
+    if(args.size() != 2)
+      return add_error(std::string(name) + ": expected: 2 arguments, got: " + std::to_string(args.size()));
+    if(auto err = expect_type(name, args, 0, object_type::array))
+      return err;
+    return expect_function(name, args, 1);
+  }
+
+  const environment& get_builtins()
+  {
+    static environment s_builtins{
+      { "str_len", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 1)
+            return add_error("str_len: expected: 1 argument, got: " + std::to_string(args.size()));
+          else 
+          {
+            const auto& arg = args[0];
+            switch(arg->get_type())
+            {
+              case object_type::string:
+              {
+                auto str = std::static_pointer_cast<string>(arg);
+                return std::make_shared<integer>(str->size());
+              }
+              default:
+              {
+                return add_error("str_len: expects argument to be of type: 'string', got: " + std::to_string((uint32_t)arg->get_type()));
+              }
+            }
+          }
+        }, 1, 1)
+      },
+      { "len", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+      {
+        if(args.size() != 1)
+          return add_error("len: expected: 1 argument, got: " + std::to_string(args.size()));
+        else
+        {
+          const auto& arg = args[0];
+          switch(arg->get_type())
+          {
+            case object_type::array:
+            {
+              auto arr = std::static_pointer_cast<array>(arg);
+              return std::make_shared<integer>(arr->get_elements().size());
+            }
+            case object_type::set:
+            {
+              auto _set = std::static_pointer_cast<set>(arg);
+              return std::make_shared<integer>(_set->get_elements().size());
+            }
+            default:
+            {
+              return add_error("len: expects argument to be of type: 'array' or 'set', got: " + std::to_string((uint32_t)arg->get_type()));
+            }
+          }
+        }
+        }, 1, 1)
+      },
+      { "push", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          auto sz = args.size();
+          if(sz > 3 || sz < 2)
+            return add_error("push: expected at least: 2 arguments, got: " + std::to_string(args.size()));
+          else
+          {
+            if(args[0]->get_type() != object_type::array) 
+              return add_error("push: expects argument 0 to be of type: 'array', got: " + std::to_string((uint32_t)args[0]->get_type()));
+ 
+            const auto& arr = std::static_pointer_cast<array>(args[0]);
+
+            size_t pos = arr->get_elements().size();
+            if(sz == 3)
+            {
+              if(args[2]->get_type() != object_type::integer)  
+                return add_error("push: expects argument 2 to be of type: 'integer', got: " + std::to_string((uint32_t)args[3]->get_type()));
+              auto pos_obj = std::static_pointer_cast<integer>(args[2]);
+              pos = pos_obj->get_value();
+              if(pos > arr->get_elements().size() - 1 || pos < 0)
+                return get_null(); //maybe error
+            }
+
+
+            std::vector<std::shared_ptr<object>> vec;
+            vec.reserve(arr->get_elements().size() + 1);
+            for(const auto& elem : arr->get_elements())
+              vec.push_back(elem);
+            auto insert_pos = vec.begin() + pos;
+            vec.emplace(insert_pos, args[1]);
+            auto new_arr = std::make_shared<array>(std::move(vec));
+
+            return new_arr;
+          }
+        }, 2, 3)
+      },
+      { "puts", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 1)
+            return add_error("puts: expected: 1 argument, got: " + std::to_string(args.size()));
+          else 
+          {
+            if(args[0]->get_type() != object_type::string)
+              return add_error("puts: expects: argument of type 'string', got: " + std::to_string((uint32_t)args[0]->get_type()));
+
+            auto str = std::static_pointer_cast<string>(args[0])->get_value();
+            std::fwrite(str.data(), 1, str.size(), stdout);
+            std::fputc('\n', stdout);
+          
+            return get_null();
+          }
+        }, 1, 1) 
+      },
+    { "to_string", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 1)
+            return add_error("to_string: expected: 1 argument, got: " + std::to_string(args.size()));
+          else 
+            return std::make_shared<string>(args[0]->inspect());  
+        }, 1, 1) 
+      },
+      { "substr", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          auto sz = args.size();
+          if(sz < 2 || sz > 3)
+            return add_error("substr: expected: 2 or 3 arguments, got: " + std::to_string(sz));
+          if(auto err = expect_type("substr", args, 0, object_type::string))
+            return err;
+          if(auto err = expect_type("substr", args, 1, object_type::integer))
+            return err;
+          if(sz == 3)
+            if(auto err = expect_type("substr", args, 2, object_type::integer))
+              return err;
+
+          auto str = std::static_pointer_cast<string>(args[0]);
+          auto start = clamp_index(std::static_pointer_cast<integer>(args[1])->get_value(), str->size());
+          auto count = str->size() - start;
+          if(sz == 3)
+            count = clamp_index(std::static_pointer_cast<integer>(args[2])->get_value(), count);
+
+          return str->slice(start, count);
+        }, 2, 3)
+      },
+      { "find", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          auto sz = args.size();
+          if(sz < 2 || sz > 3)
+            return add_error("find: expected: 2 or 3 arguments, got: " + std::to_string(sz));
+          if(auto err = expect_type("find", args, 0, object_type::string))
+            return err;
+          if(auto err = expect_type("find", args, 1, object_type::string))
+            return err;
+          if(sz == 3)
+            if(auto err = expect_type("find", args, 2, object_type::integer))
+              return err;
+
+          auto hay = std::static_pointer_cast<string>(args[0])->get_value();
+          auto needle = std::static_pointer_cast<string>(args[1])->get_value();
+          size_t from = sz == 3 ? clamp_index(std::static_pointer_cast<integer>(args[2])->get_value(), hay.size()) : 0;
+
+          auto pos = simd::find(hay, needle, from);
+          return std::make_shared<integer>(pos == simd::npos ? -1 : static_cast<int64_t>(pos));
+        }, 2, 3)
+      },
+      { "split", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 2)
+            return add_error("split: expected: 2 arguments, got: " + std::to_string(args.size()));
+          if(auto err = expect_type("split", args, 0, object_type::string))
+            return err;
+          if(auto err = expect_type("split", args, 1, object_type::string))
+            return err;
+
+          auto str = std::static_pointer_cast<string>(args[0]);
+          auto sep = std::static_pointer_cast<string>(args[1])->get_value();
+          if(sep.empty())
+            return add_error("split: separator can't be empty");
+
+          //the parts are slices of str, only the array itself gets allocated
+          auto text = str->get_value();
+          std::vector<std::shared_ptr<object>> parts;
+          size_t start = 0;
+          while(true)
+          {
+            auto pos = simd::find(text, sep, start);
+            if(pos == simd::npos)
+              break;
+            parts.push_back(str->slice(start, pos - start));
+            start = pos + sep.size();
+          }
+          parts.push_back(str->slice(start, text.size() - start));
+
+          return std::make_shared<array>(std::move(parts));
+        }, 2, 2)
+      },
+      { "starts_with", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 2)
+            return add_error("starts_with: expected: 2 arguments, got: " + std::to_string(args.size()));
+          if(auto err = expect_type("starts_with", args, 0, object_type::string))
+            return err;
+          if(auto err = expect_type("starts_with", args, 1, object_type::string))
+            return err;
+
+          auto str = std::static_pointer_cast<string>(args[0])->get_value();
+          auto prefix = std::static_pointer_cast<string>(args[1])->get_value();
+          return to_boolean(str.starts_with(prefix));
+        }, 2, 2)
+      },
+      { "trim", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 1)
+            return add_error("trim: expected: 1 argument, got: " + std::to_string(args.size()));
+          if(auto err = expect_type("trim", args, 0, object_type::string))
+            return err;
+
+          auto str = std::static_pointer_cast<string>(args[0]);
+          auto text = str->get_value();
+          size_t begin = 0, end = text.size();
+          while(begin < end && std::isspace(static_cast<unsigned char>(text[begin])))
+            ++begin;
+          while(end > begin && std::isspace(static_cast<unsigned char>(text[end - 1])))
+            --end;
+
+          return str->slice(begin, end - begin);
+        }, 1, 1)
+      },
+      { "set", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() > 1)
+            return add_error("set: expected: 0 or 1 arguments, got: " + std::to_string(args.size()));
+
+          set::elements elems;
+          if(args.empty())
+            return std::make_shared<set>(std::move(elems));
+
+          switch(args[0]->get_type())
+          {
+            case object_type::array:
+            {
+              const auto& arr = std::static_pointer_cast<array>(args[0])->get_elements();
+              for(const auto& elem : arr)
+              {
+                auto key = hash_key(elem);
+                if(!key)
+                  return not_hashable("set", elem);
+                elems.try_emplace(*key, elem);
+              }
+              return std::make_shared<set>(std::move(elems));
+            }
+            case object_type::set:
+            {
+              elems = std::static_pointer_cast<set>(args[0])->get_elements();
+              return std::make_shared<set>(std::move(elems));
+            }
+            default:
+            {
+              return add_error("set: expects argument to be of type: 'array' or 'set', got: " + std::to_string((uint32_t)args[0]->get_type()));
+            }
+          }
+        }, 0, 1)
+      },
+      { "has", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 2)
+            return add_error("has: expected: 2 arguments, got: " + std::to_string(args.size()));
+
+          auto key = hash_key(args[1]);
+          if(!key)
+            return not_hashable("has", args[1]);
+
+          switch(args[0]->get_type())
+          {
+            case object_type::set:
+            {
+              const auto& elems = std::static_pointer_cast<set>(args[0])->get_elements();
+              return to_boolean(elems.contains(*key));
+            }
+            case object_type::map:
+            {
+              const auto& _map = std::static_pointer_cast<map>(args[0])->get_map();
+              return to_boolean(_map.contains(*key));
+            }
+            default:
+            {
+              return add_error("has: expects argument 0 to be of type: 'set' or 'map', got: " + std::to_string((uint32_t)args[0]->get_type()));
+            }
+          }
+        }, 2, 2)
+      },
+      { "add", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 2)
+            return add_error("add: expected: 2 arguments, got: " + std::to_string(args.size()));
+          if(auto err = expect_type("add", args, 0, object_type::set))
+            return err;
+
+          auto key = hash_key(args[1]);
+          if(!key)
+            return not_hashable("add", args[1]);
+
+          //the copy shares its nodes, the insert copies the few on the key's path
+          auto elems = std::static_pointer_cast<set>(args[0])->get_elements();
+          if(!elems.try_emplace(*key, args[1]))
+            return args[0];
+          return std::make_shared<set>(std::move(elems));
+        }, 2, 2)
+      },
+      { "union", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_two_sets("union", args))
+            return err;
+
+          const auto* a = &std::static_pointer_cast<set>(args[0])->get_elements();
+          const auto* b = &std::static_pointer_cast<set>(args[1])->get_elements();
+          if(a->size() < b->size())
+            std::swap(a, b);
+
+          //copy the bigger one, insert the smaller one
+          auto elems = *a;
+          for(const auto& elem : *b)
+            elems.insert(elem);
+          return std::make_shared<set>(std::move(elems));
+        }, 2, 2)
+      },
+      { "intersect", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_two_sets("intersect", args))
+            return err;
+
+          const auto* a = &std::static_pointer_cast<set>(args[0])->get_elements();
+          const auto* b = &std::static_pointer_cast<set>(args[1])->get_elements();
+          if(a->size() > b->size())
+            std::swap(a, b);
+
+          //walk the smaller one, probe the bigger one
+          set::elements elems;
+          for(const auto& elem : *a)
+            if(b->contains(elem.first))
+              elems.insert(elem);
+          return std::make_shared<set>(std::move(elems));
+        }, 2, 2)
+      },
+      { "difference", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_two_sets("difference", args))
+            return err;
+
+          const auto& a = std::static_pointer_cast<set>(args[0])->get_elements();
+          const auto& b = std::static_pointer_cast<set>(args[1])->get_elements();
+
+          set::elements elems;
+          for(const auto& elem : a)
+            if(!b.contains(elem.first))
+              elems.insert(elem);
+          return std::make_shared<set>(std::move(elems));
+        }, 2, 2)
+      },
+      { "sum", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          auto sum = sum_numbers("sum", args);
+          if(!sum)
+            return sum.error();
+          if(sum->any_float)
+            return std::make_shared<floating>(sum->as_double());
+          if(sum->wide.is_zero())
+            return std::make_shared<integer>(sum->ints);
+          auto total = sum->wide + bignum(sum->ints);
+          if(total.fits_int64())
+            return std::make_shared<integer>(total.to_int64());
+          return std::make_shared<big_integer>(std::move(total));
+        }, 1, 1)
+      },
+      { "mean", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          auto sum = sum_numbers("mean", args);
+          if(!sum)
+            return sum.error();
+          auto count = std::static_pointer_cast<array>(args[0])->get_elements().size();
+          if(count == 0)
+            return add_error("mean: expects a non empty array");
+          return std::make_shared<floating>(sum->as_double() / static_cast<double>(count));
+        }, 1, 1)
+      },
+      { "memo", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.empty() || args.size() > 2)
+            return add_error("memo: expected: 1 or 2 arguments, got: " + std::to_string(args.size()));
+          auto type = args[0]->get_type();
+          if(type != object_type::fun && type != object_type::builtin && type != object_type::memoized)
+            return add_error("memo: expects argument 0 to be a function, got: " + std::to_string((uint32_t)type));
+
+          size_t capacity = default_memo_capacity;
+          if(args.size() == 2)
+          {
+            if(auto err = expect_type("memo", args, 1, object_type::integer))
+              return err;
+            auto value = std::static_pointer_cast<integer>(args[1])->get_value();
+            if(value < 1)
+              return add_error("memo: expects a capacity of at least 1, got: " + std::to_string(value));
+            capacity = static_cast<size_t>(value);
+          }
+          return std::make_shared<memoized>(args[0], std::make_shared<memo_cache>(capacity));
+        }, 1, 2)
+      },
+      { "memo_stats", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() != 1)
+            return add_error("memo_stats: expected: 1 argument, got: " + std::to_string(args.size()));
+          //what memo returned, or a function automatic memoization gave a cache
+          if(args[0]->get_type() == object_type::memoized)
+            return memo_record(*std::static_pointer_cast<memoized>(args[0])->cache);
+          if(args[0]->get_type() == object_type::fun)
+          {
+            if(const auto& table = std::static_pointer_cast<fun>(args[0])->literal->memo)
+              return memo_record(table->cache);
+          }
+          return add_error("memo_stats: expects a memoized function, got: " + std::to_string((uint32_t)args[0]->get_type()));
+        }, 1, 1)
+      },
+      { "map", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_array_and_function("map", args))
+            return err;
+
+          std::vector<std::shared_ptr<object>> results;
+          if(auto err = apply_each(args[1], std::static_pointer_cast<array>(args[0])->get_elements(), results))
+            return err;
+          return std::make_shared<array>(std::move(results));
+        }, 2, 2)
+      },
+      { "filter", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_array_and_function("filter", args))
+            return err;
+
+          const auto& elems = std::static_pointer_cast<array>(args[0])->get_elements();
+          std::vector<std::shared_ptr<object>> keep;
+          if(auto err = apply_each(args[1], elems, keep))
+            return err;
+          std::vector<std::shared_ptr<object>> kept;
+          for(size_t i = 0; i < elems.size(); ++i)
+            if(to_boolean(keep[i])->get_value())
+              kept.push_back(elems[i]);
+          return std::make_shared<array>(std::move(kept));
+        }, 2, 2)
+      },
+      { "reduce", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(args.size() < 2 || args.size() > 3)
+            return add_error("reduce: expected: 2 or 3 arguments, got: " + std::to_string(args.size()));
+          if(auto err = expect_type("reduce", args, 0, object_type::array))
+            return err;
+          if(auto err = expect_function("reduce", args, 1))
+            return err;
+
+          //nothing says f is associative, the elements are folded in order. without a start
+          //value the first element is one
+          const auto& elems = std::static_pointer_cast<array>(args[0])->get_elements();
+          if(args.size() == 2 && elems.empty())
+            return add_error("reduce: expects a non empty array or a start value");
+          size_t i = args.size() == 3 ? 0 : 1;
+          auto total = args.size() == 3 ? args[2] : elems[0];
+          std::vector<std::shared_ptr<object>> pair(2);
+          for(; i < elems.size(); ++i)
+          {
+            pair[0] = std::move(total);
+            pair[1] = elems[i];
+            total = call(args[1], pair);
+            if(failed(total))
+              return total;
+          }
+          return total;
+        }, 2, 3)
+      },
+      { "for_each", std::make_shared<builtin>([](builtin::arguments args) -> std::shared_ptr<object>
+        {
+          if(auto err = expect_array_and_function("for_each", args))
+            return err;
+
+          std::vector<std::shared_ptr<object>> results;
+          if(auto err = apply_each(args[1], std::static_pointer_cast<array>(args[0])->get_elements(), results))
+            return err;
+          return get_null();
+        }, 2, 2)
+      },
+    };
+    return s_builtins;
+  }
+
+  bool is_impure_builtin(const symbol& sym)
+  {
+    return sym.str() == "puts" || sym.str() == "memo_stats";
+  }
+
+  bool calls_argument(const symbol& sym)
+  {
+    const auto& name = sym.str();
+    return name == "map" || name == "filter" || name == "reduce" || name == "for_each";
+  }
+
+  //marked before main so no environment can bind one of the names first without noticing
+  static const bool s_builtins_marked = []
+  {
+    for(const auto& [name, value] : get_builtins().get_bindings())
+    {
+      name.mark_builtin();
+      static_cast<builtin*>(value.get())->pure = !is_impure_builtin(name);
+    }
+    return true;
+  }();
+}
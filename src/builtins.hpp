@@ -0,0 +1,17 @@
+#pragma once
+
+#include "object.hpp"
+
+namespace my_ns
+{
+  //native functions, looked up after the environment chain misses. their names are marked
+  //builtin so calls to them can be bound at parse time until something shadows one
+  const environment& get_builtins();
+
+  //builtins whose result isn't decided by their arguments alone, or that do more than return it
+  bool is_impure_builtin(const symbol&);
+
+  //builtins that call the function given as their second argument, map, filter, reduce and
+  //for_each. a call to one is only as pure as that function
+  bool calls_argument(const symbol&);
+}
@@ -0,0 +1,43 @@
+#include "chunked_source.hpp"
+
+#include <algorithm>
+
+namespace my_ns
+{
+  std::expected<chunked_source, chunked_source::error> chunked_source::open(const std::filesystem::path& path, size_t chunk_size)
+  {
+    chunked_source src;
+    src.m_stream.open(path, std::ios::binary);
+    if(!src.m_stream)
+      return std::unexpected(error::cant_open);
+    src.m_chunk_size = std::max<size_t>(chunk_size, 1);
+    src.read_more();
+    return src;
+  }
+
+  void chunked_source::consume(size_t n)
+  {
+    m_start = std::min(m_start + n, m_buffer.size());
+  }
+
+  bool chunked_source::read_more()
+  {
+    if(m_eof)
+      return false;
+
+    //slide what's left to the front before growing
+    m_buffer.erase(0, m_start);
+    m_start = 0;
+
+    auto old_size = m_buffer.size();
+    m_buffer.resize(old_size + m_chunk_size);
+    m_stream.read(m_buffer.data() + old_size, static_cast<std::streamsize>(m_chunk_size));
+    auto got = static_cast<size_t>(m_stream.gcount());
+    m_buffer.resize(old_size + got);
+
+    if(got < m_chunk_size)
+      m_eof = true;
+    m_peak = std::max(m_peak, m_buffer.size());
+    return got > 0;
+  }
+}
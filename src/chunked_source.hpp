@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+
+namespace my_ns
+{
+  //a sliding window over a file read a chunk at a time, only the bytes that haven't
+  //been consumed are kept. views into the window die on read_more
+  class chunked_source
+  {
+  public:
+    enum class error
+    {
+      cant_open
+    };
+    static constexpr size_t default_chunk = 1 << 20;
+  public:
+    static std::expected<chunked_source, error> open(const std::filesystem::path& path, size_t chunk_size = default_chunk);
+
+    inline std::string_view window() const
+    {
+      return std::string_view(m_buffer).substr(m_start);
+    }
+
+    //the whole file has been read into the window at some point
+    inline bool at_end() const
+    {
+      return m_eof;
+    }
+
+    //largest the window got, tracks the peak memory the stream needs
+    inline size_t peak_window() const
+    {
+      return m_peak;
+    }
+
+    //drop the first n bytes of the window
+    void consume(size_t n);
+    //append the next chunk, false once the file is used up
+    bool read_more();
+  private:
+    std::ifstream m_stream;
+    std::string m_buffer;
+    size_t m_start = 0;
+    size_t m_chunk_size = default_chunk;
+    size_t m_peak = 0;
+    bool m_eof = false;
+  };
+}
@@ -1,6 +1,15 @@
 #include "evaluator.hpp"
 #include "ast.hpp"
+#include "builtins.hpp"
+#include "fork_join.hpp"
+#include "memo.hpp"
+#include "module.hpp"
 #include "object.hpp"
+#include "optimizer.hpp"
+#include "parser.hpp"
+#include "specializer.hpp"
+#include <algorithm>
+#include <array>
 #include <cstdio>
 #include <iostream>
 #include <memory>
@@ -9,120 +18,22 @@ namespace my_ns
 {
   static std::shared_ptr<boolean> get_true();
   static std::shared_ptr<boolean> get_false();
-  static std::shared_ptr<null> get_null();
-  static std::shared_ptr<boolean> to_boolean(bool b);
-  static std::shared_ptr<boolean> to_boolean(const std::shared_ptr<object>& obj);
 
   static bool is_error(const std::shared_ptr<object>& obj);
- 
-  //TODO: libraries
-  static environment builtin_env{
-    { "str_len", std::make_shared<builtin>([](const std::vector<std::shared_ptr<object>>& args) -> std::shared_ptr<object>
-      {
-        if(args.size() != 1)
-          return add_error("str_len: expected: 1 argument, got: " + std::to_string(args.size()));
-        else 
-        {
-          const auto& arg = args[0];
-          switch(arg->get_type())
-          {
-            case object_type::string:
-            {
-              auto str = std::static_pointer_cast<string>(arg);
-              return std::make_shared<integer>(str->get_value().size());
-            }
-            default:
-            {
-              return add_error("str_len: expects argument to be of type: 'string', got: " + std::to_string((uint32_t)arg->get_type()));
-            }
-          }
-        }
-      })
-    },
-    { "len", std::make_shared<builtin>([](const std::vector<std::shared_ptr<object>>& args) -> std::shared_ptr<object>
-    {
-      if(args.size() != 1)
-        return add_error("len: expected: 1 argument, got: " + std::to_string(args.size()));
-      else
-      {
-        const auto& arg = args[0];
-        switch(arg->get_type())
-        {
-          case object_type::array:
-          {
-            auto arr = std::static_pointer_cast<array>(arg);
-            return std::make_shared<integer>(arr->get_elements().size());
-          }
-          default:
-          {
-            return add_error("len: expects argument to be of type: 'array', got: " + std::to_string((uint32_t)arg->get_type()));
-          }
-        }
-      }
-      })
-    },
-    { "push", std::make_shared<builtin>([](const std::vector<std::shared_ptr<object>>& args) -> std::shared_ptr<object>
-      {
-        auto sz = args.size();
-        if(sz > 3 || sz < 2)
-          return add_error("push: expected at least: 2 arguments, got: " + std::to_string(args.size()));
-        else
-        {
-          if(args[0]->get_type() != object_type::array) 
-            return add_error("push: expects argument 0 to be of type: 'array', got: " + std::to_string((uint32_t)args[0]->get_type()));
- 
-          const auto& arr = std::static_pointer_cast<array>(args[0]);
-
-          size_t pos = arr->get_elements().size();
-          if(sz == 3)
-          {
-            if(args[2]->get_type() != object_type::integer)  
-              return add_error("push: expects argument 2 to be of type: 'integer', got: " + std::to_string((uint32_t)args[3]->get_type()));
-            auto pos_obj = std::static_pointer_cast<integer>(args[2]);
-            pos = pos_obj->get_value();
-            if(pos > arr->get_elements().size() - 1 || pos < 0)
-              return get_null(); //maybe error
-          }
-
-
-          std::vector<std::shared_ptr<object>> vec;
-          vec.reserve(arr->get_elements().size() + 1);
-          for(const auto& elem : arr->get_elements())
-            vec.push_back(elem);
-          auto insert_pos = vec.begin() + pos;
-          vec.emplace(insert_pos, args[1]);
-          auto new_arr = std::make_shared<array>(std::move(vec));
-
-          return new_arr;
-        }
-      })
-    },
-    { "puts", std::make_shared<builtin>([](const std::vector<std::shared_ptr<object>>& args) -> std::shared_ptr<object>
-      {
-        if(args.size() != 1)
-          return add_error("puts: expected: 1 argument, got: " + std::to_string(args.size()));
-        else 
-        {
-          if(args[0]->get_type() != object_type::string)
-            return add_error("puts: expects: argument of type 'string', got: " + std::to_string((uint32_t)args[0]->get_type()));
-
-          auto str = std::static_pointer_cast<string>(args[0]);
-          std::puts(str->get_value().c_str());
-          
-          return get_null();
-        }
-      }) 
-    },
-  { "to_string", std::make_shared<builtin>([](const std::vector<std::shared_ptr<object>>& args) -> std::shared_ptr<object>
-      {
-        if(args.size() != 1)
-          return add_error("to_string: expected: 1 argument, got: " + std::to_string(args.size()));
-        else 
-          return std::make_shared<string>(args[0]->inspect());  
-      }) 
-    },
-  };
-
+  [[gnu::noinline]] static std::shared_ptr<object> eval_forked_infix(const std::shared_ptr<infix>& infix_node, const std::shared_ptr<environment>& env);
+  [[gnu::noinline]] static std::shared_ptr<object> eval_forked_array(const std::shared_ptr<array_literal>& arr_node, const std::shared_ptr<environment>& env);
+  [[gnu::noinline]] static std::shared_ptr<object> node_type_error(node_type type);
+  static std::shared_ptr<object> eval_literal(const std::shared_ptr<node>& n, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_array_literal(const std::shared_ptr<array_literal>& arr_node, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_prefix(const std::shared_ptr<prefix>& prefix_node, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_infix(const std::shared_ptr<infix>& infix_node, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_index(const std::shared_ptr<index>& index_node, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_var_statement(const std::shared_ptr<var>& var_node, const std::shared_ptr<environment>& env);
+  static std::shared_ptr<object> eval_call(const std::shared_ptr<call>& call_node, const std::shared_ptr<environment>& env);
+  [[gnu::noinline]] static std::shared_ptr<object> eval_import(const std::shared_ptr<import_expression>& import_node);
+
+  //every node on a recursive path has a frame of this, the cases only hand off to a helper so
+  //nothing they build sits in it. the rare paths that build strings or bignums are out of line
   trampoline_result eval_trampoline(const std::shared_ptr<node>& n, const std::shared_ptr<environment>& env, size_t depth) 
   {
     if(depth > 7000) return add_error("recursion depth exceeded");
@@ -139,75 +50,36 @@ namespace my_ns
         return eval(exp_stmt_node->_expression, env);
       }
       case node_type::integer:
-      {
-        auto int_node = std::static_pointer_cast<integer_literal>(n);
-        return std::make_shared<integer>(int_node->value);
-      }
+      case node_type::floating:
       case node_type::string:
-      {
-        auto string_node = std::static_pointer_cast<string_literal>(n);
-        return std::make_shared<string>(string_node->value);
-      }
+      case node_type::constant:
+      case node_type::boolean:
+      case node_type::fun:
+        return eval_literal(n, env);
       case node_type::array:
       {
         auto arr_node = std::static_pointer_cast<array_literal>(n);
-        auto elements = eval_expressions(arr_node->elements, env);
-
-        if(elements.size() == 1 && is_error(elements[0]))
-          return elements[0];
-
-        return std::make_shared<array>(elements);
+        return eval_array_literal(arr_node, env);
       }
       case node_type::map:
       {
         auto map_node = std::static_pointer_cast<map_literal>(n);
         return eval_map(map_node, env);
       }
-      case node_type::boolean:
-      {
-        auto bool_node = std::static_pointer_cast<boolean_literal>(n);
-        return to_boolean(bool_node->value);
-      }
       case node_type::prefix:
       {
         auto prefix_node = std::static_pointer_cast<prefix>(n);
-        auto right_eval = eval(prefix_node->right, env);
-        
-        if(is_error(right_eval))
-          return right_eval;
-
-        return eval_prefix_expression(prefix_node->_operator, right_eval);
+        return eval_prefix(prefix_node, env);
       }
       case node_type::infix:
       {
         auto infix_node = std::static_pointer_cast<infix>(n);
-        auto left_eval = eval(infix_node->left, env);
-        
-        if(is_error(left_eval))
-          return left_eval;
-
-        auto right_eval = eval(infix_node->right, env);
-        
-        if(is_error(right_eval))
-          return right_eval;
-
-        return eval_infix_expression(infix_node->_operator, left_eval, right_eval);
+        return eval_infix(infix_node, env);
       }
       case node_type::index:
       {
         auto index_node = std::static_pointer_cast<index>(n);
-        
-        auto left = eval(index_node->left, env);
-    
-        if(is_error(left))
-          return left;
-        
-        auto right = eval(index_node->right, env);
-
-        if(is_error(right))
-          return right;
-
-        return eval_index_expression(left, right);
+        return eval_index(index_node, env);
       }
       case node_type::block:
       {
@@ -219,6 +91,16 @@ namespace my_ns
         auto if_node = std::static_pointer_cast<_if>(n);
         return eval_if_expression(if_node, env);
       }
+      case node_type::_while:
+      {
+        auto while_node = std::static_pointer_cast<_while>(n);
+        return eval_while_expression(while_node, env);
+      }
+      case node_type::_for:
+      {
+        auto for_node = std::static_pointer_cast<_for>(n);
+        return eval_for_expression(for_node, env);
+      }
       case node_type::ret:
       {
         auto ret_node = std::static_pointer_cast<ret>(n);
@@ -232,12 +114,8 @@ namespace my_ns
       case node_type::var:
       {
         auto var_node = std::static_pointer_cast<var>(n);
-        auto val = eval(var_node->value, env);
-        
-        if(is_error(val))
-          return val;
-
-        env->set(var_node->name.value, val);
+        if(auto err = eval_var_statement(var_node, env))
+          return err;
         break;
       }
       case node_type::identifire:
@@ -245,25 +123,31 @@ namespace my_ns
         auto ident_node = std::static_pointer_cast<identifire>(n);
         return eval_identifire(ident_node, env);
       }
-      case node_type::fun:
-      {
-        auto fun_node = std::static_pointer_cast<fun_literal>(n);
-        return std::make_shared<fun>(fun_node->parameters, fun_node->body, env);
-      }
       case node_type::call:
       {
         auto call_node = std::static_pointer_cast<call>(n);
-        auto function = eval(call_node->function, env);
-
-        if(is_error(function))
-          return function;
-        
-        auto args = eval_expressions(call_node->arguments, env);
-        if(args.size() == 1 && is_error(args[0]))
-          return args[0];
-
-        return invoke_function(function, args);
+        return eval_call(call_node, env);
+      }
+      case node_type::intrinsic:
+      {
+        auto intrinsic_node = std::static_pointer_cast<intrinsic_call>(n);
+        return eval_intrinsic_call(intrinsic_node, env);
+      }
+      case node_type::inlined:
+      {
+        auto inline_node = std::static_pointer_cast<inlined_call>(n);
+        return eval_inlined_call(inline_node, env);
       }
+      case node_type::_import:
+      {
+        auto import_node = std::static_pointer_cast<import_expression>(n);
+        return eval_import(import_node);
+      }
+      //the base kinds are never made on their own
+      case node_type::node:
+      case node_type::statement:
+      case node_type::expression:
+        return node_type_error(n->get_type());
     }
     return std::make_shared<void_object>();
 
@@ -281,6 +165,143 @@ namespace my_ns
         return eval(n, env);
     }
 
+  //the literals evaluate nothing under them, they get their own switch
+  static std::shared_ptr<object> eval_literal(const std::shared_ptr<node>& n, const std::shared_ptr<environment>& env)
+  {
+    switch(n->get_type())
+    {
+      case node_type::integer:
+      {
+        auto int_node = std::static_pointer_cast<integer_literal>(n);
+        if(int_node->pooled)
+          return int_node->pooled;
+        return std::make_shared<integer>(int_node->value);
+      }
+      case node_type::floating:
+      {
+        auto float_node = std::static_pointer_cast<float_literal>(n);
+        if(float_node->pooled)
+          return float_node->pooled;
+        return std::make_shared<floating>(float_node->value);
+      }
+      case node_type::string:
+      {
+        auto string_node = std::static_pointer_cast<string_literal>(n);
+        if(string_node->pooled)
+          return string_node->pooled;
+        return std::make_shared<string>(string_node->buffer, 0, string_node->buffer->size());
+      }
+      case node_type::constant:
+      {
+        return std::static_pointer_cast<constant>(n)->value;
+      }
+      case node_type::boolean:
+      {
+        auto bool_node = std::static_pointer_cast<boolean_literal>(n);
+        return to_boolean(bool_node->value);
+      }
+      case node_type::fun:
+      {
+        auto fun_node = std::static_pointer_cast<fun_literal>(n);
+        return std::make_shared<fun>(fun_node, env);
+      }
+      default:
+        return node_type_error(n->get_type());
+    }
+  }
+
+  static std::shared_ptr<object> eval_array_literal(const std::shared_ptr<array_literal>& arr_node, const std::shared_ptr<environment>& env)
+  {
+    if(arr_node->fork && get_fork_join_pool().worth_forking())
+      if(auto forked = eval_forked_array(arr_node, env))
+        return forked;
+    auto elements = eval_expressions(arr_node->elements, env);
+
+    if(elements.size() == 1 && is_error(elements[0]))
+      return elements[0];
+
+    return std::make_shared<array>(elements);
+  }
+
+  static std::shared_ptr<object> eval_prefix(const std::shared_ptr<prefix>& prefix_node, const std::shared_ptr<environment>& env)
+  {
+    auto right_eval = eval(prefix_node->right, env);
+    
+    if(is_error(right_eval))
+      return right_eval;
+
+    return eval_prefix_expression(prefix_node->op, right_eval);
+  }
+
+  static std::shared_ptr<object> eval_infix(const std::shared_ptr<infix>& infix_node, const std::shared_ptr<environment>& env)
+  {
+    if(infix_node->fork && get_fork_join_pool().worth_forking())
+      if(auto forked = eval_forked_infix(infix_node, env))
+        return forked;
+    auto left_eval = eval(infix_node->left, env);
+    
+    if(is_error(left_eval))
+      return left_eval;
+
+    auto right_eval = eval(infix_node->right, env);
+    
+    if(is_error(right_eval))
+      return right_eval;
+
+    return eval_infix_expression(infix_node->op, left_eval, right_eval);
+  }
+
+  static std::shared_ptr<object> eval_index(const std::shared_ptr<index>& index_node, const std::shared_ptr<environment>& env)
+  {
+    auto left = eval(index_node->left, env);
+
+    if(is_error(left))
+      return left;
+
+    if(left->get_type() == object_type::map && index_node->right->get_type() == node_type::string)
+      return eval_record_index_expression(index_node, left);
+    
+    auto right = eval(index_node->right, env);
+
+    if(is_error(right))
+      return right;
+
+    return eval_index_expression(left, right);
+  }
+
+  //nullptr once the name is set, the statement itself has no value
+  static std::shared_ptr<object> eval_var_statement(const std::shared_ptr<var>& var_node, const std::shared_ptr<environment>& env)
+  {
+    auto val = eval(var_node->value, env);
+    
+    if(is_error(val))
+      return val;
+
+    env->set(var_node->name.sym, val);
+    return nullptr;
+  }
+
+  static std::shared_ptr<object> eval_call(const std::shared_ptr<call>& call_node, const std::shared_ptr<environment>& env)
+  {
+    auto function = eval(call_node->function, env);
+
+    if(is_error(function))
+      return function;
+    
+    auto args = eval_expressions(call_node->arguments, env);
+    if(args.size() == 1 && is_error(args[0]))
+      return args[0];
+
+    return invoke_function(function, args);
+  }
+
+  //the resolved path is built here, not in the trampoline's frame
+  [[gnu::noinline]] static std::shared_ptr<object> eval_import(const std::shared_ptr<import_expression>& import_node)
+  {
+    auto& modules = get_modules();
+    return modules.import(modules.resolve(*import_node));
+  }
+
   std::shared_ptr<object> eval(const std::shared_ptr<node>& n, const std::shared_ptr<environment>& env, size_t depth)
   {
     auto result = eval_trampoline(n, env, depth++);
@@ -368,14 +389,79 @@ namespace my_ns
     return get_null();
   }
 
+  static bool stops_loop(const std::shared_ptr<object>& res)
+  {
+    return res && (res->get_type() == object_type::ret_value || res->get_type() == object_type::error);
+  }
+
+  std::shared_ptr<object> eval_while_expression(const std::shared_ptr<_while>& loop, const std::shared_ptr<environment>& env)
+  {
+    //there's no loop variable to hold, the body shares the enclosing scope. a var in it updates
+    //the name there, which the next check sees, and stays bound after the loop like for's body vars
+    while(true)
+    {
+      auto cond_eval = eval(loop->condition, env);
+      if(is_error(cond_eval))
+        return cond_eval;
+      if(!to_boolean(cond_eval)->get_value())
+        return get_null();
+
+      auto res = eval_block_statement(loop->body, env);
+      if(stops_loop(res))
+        return res;
+    }
+  }
+
+  std::shared_ptr<object> eval_for_expression(const std::shared_ptr<_for>& loop, const std::shared_ptr<environment>& env)
+  {
+    auto iterable = eval(loop->iterable, env);
+    if(is_error(iterable))
+      return iterable;
+    if(iterable->get_type() != object_type::array)
+      return add_error("for expects an array, got: " + std::to_string((uint32_t)iterable->get_type()));
+
+    //one frame for the whole loop, each iteration rebinds the variable in it
+    auto arr = std::static_pointer_cast<array>(iterable);
+    auto frame = std::make_shared<environment>(env, loop->variable.sym);
+    for(const auto& element : arr->get_elements())
+    {
+      frame->set(loop->variable.sym, element);
+      auto res = eval_block_statement(loop->body, frame);
+      if(stops_loop(res))
+        return res;
+    }
+    return get_null();
+  }
+
 
   std::shared_ptr<object> eval_identifire(const std::shared_ptr<identifire>& ident, const std::shared_ptr<environment>& env)
   {
-    auto ret = env->get(ident->value);
+    //a name no function or nested scope ever bound can only be a global, skip the walk and use its cell
+    if(!ident->sym.is_local())
+    {
+      auto& cache = ident->cache;
+      auto version = environment::version();
+      auto global = env->get_global();
+      if(cache.scope == global && cache.version == version)
+      {
+        if(cache.cell)
+          return *cache.cell;
+      }
+      else
+      {
+        auto cell = env->find_cell(ident->sym);
+        if(!in_parallel())
+          cache = { global, cell, version };
+        if(cell)
+          return *cell;
+      }
+    }
+
+    auto ret = env->get(ident->sym);
     
     if(!ret.has_value())
     {
-      auto builtin_ret = builtin_env.get(ident->value);
+      auto builtin_ret = get_builtins().get(ident->sym);
       if(!builtin_ret.has_value())
         return add_error("identifire not found: " + ident->value); 
       
@@ -384,149 +470,571 @@ namespace my_ns
     return ret.value();
   }
 
-  //TODO: operator overloading
-  std::shared_ptr<object> eval_prefix_expression(const std::string& op, const std::shared_ptr<object>& right)
+  //the kernels the dispatch tables jump to, operand types are already checked by the index
+  namespace kernels
   {
-    //TODO: operator enum
-    if(op == "!")
-      return eval_bang_operator_expression(right);
-    else if(op == "-")
-      return eval_minus_prefix_operator_expression(right);
+    using operand = const std::shared_ptr<object>&;
 
-    return add_error("unknown operator: " + op + " " + std::to_string((uint32_t)right->get_type()));
-  }
+    static int64_t int_of(operand obj)
+    {
+      return static_cast<integer*>(obj.get())->get_value();
+    }
 
+    static bool bool_of(operand obj)
+    {
+      return static_cast<boolean*>(obj.get())->get_value();
+    }
 
-  //TODO: operator overloading
-  std::shared_ptr<object> eval_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
-  {
-    if(left->get_type() == object_type::integer && right->get_type() == object_type::integer)
-      return eval_integer_infix_expression(op, left, right);
-    else if(left->get_type() == object_type::boolean && right->get_type() == object_type::boolean)
-      return eval_boolean_infix_expression(op, left, right);
-    else if(left->get_type() == object_type::string && right->get_type() == object_type::string)
-      return eval_string_infix_expression(op, left, right);
-    if(left->get_type() != right->get_type())
-      return add_error("type mismatch: " + std::to_string((uint32_t)left->get_type()) + " " + op + " " + std::to_string((uint32_t)right->get_type()));
-    
-    return add_error("unknown operator: " + op + " " + std::to_string((uint32_t)left->get_type()) + " " + std::to_string((uint32_t)right->get_type()));
-  }
+    static double float_of(operand obj)
+    {
+      return static_cast<floating*>(obj.get())->get_value();
+    }
 
+    //an integer next to a float is promoted, the operand types are known per table slot
+    template <object_type T>
+    static double number_of(operand obj)
+    {
+      if constexpr(T == object_type::integer)
+        return static_cast<double>(int_of(obj));
+      else if constexpr(T == object_type::big_integer)
+        return static_cast<big_integer*>(obj.get())->get_value().to_double();
+      else
+        return float_of(obj);
+    }
 
-  std::shared_ptr<object> eval_bang_operator_expression(const std::shared_ptr<object>& obj)
-  {
-    switch(obj->get_type())
+    //an int64 next to a big_integer is widened, a big_integer operand isn't copied
+    template <object_type T>
+    static decltype(auto) big_of(operand obj)
     {
-      case object_type::boolean:
-      {
-        auto bool_obj = std::static_pointer_cast<boolean>(obj);
-        return to_boolean(!bool_obj->get_value());
-      }
-      case object_type::integer:
+      if constexpr(T == object_type::integer)
+        return bignum(int_of(obj));
+      else
+        return static_cast<big_integer*>(obj.get())->get_value();
+    }
+
+    //results are integers whenever they fit, only the slow path after an overflow comes here
+    static std::shared_ptr<object> make_integer(bignum value)
+    {
+      if(value.fits_int64())
+        return std::make_shared<integer>(value.to_int64());
+      return std::make_shared<big_integer>(std::move(value));
+    }
+
+    //a float operand only the evaluator's temporary holds is reused for the result
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_result(operand l, operand r, double value)
+    {
+      if constexpr(L == object_type::floating)
       {
-        auto integer_obj = std::static_pointer_cast<integer>(obj);
-        return to_boolean(integer_obj->get_value());
+        if(l.use_count() == 1)
+        {
+          static_cast<floating*>(l.get())->set_value(value);
+          return l;
+        }
       }
-      case object_type::null:
+      if constexpr(R == object_type::floating)
       {
-        return get_true();
+        if(r.use_count() == 1)
+        {
+          static_cast<floating*>(r.get())->set_value(value);
+          return r;
+        }
       }
-      default: return get_false();
+      return std::make_shared<floating>(value);
+    }
+
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_plus(operand l, operand r) { return float_result<L, R>(l, r, number_of<L>(l) + number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_minus(operand l, operand r) { return float_result<L, R>(l, r, number_of<L>(l) - number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_astrisk(operand l, operand r) { return float_result<L, R>(l, r, number_of<L>(l) * number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_slash(operand l, operand r) { return float_result<L, R>(l, r, number_of<L>(l) / number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_less(operand l, operand r) { return to_boolean(number_of<L>(l) < number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_greater(operand l, operand r) { return to_boolean(number_of<L>(l) > number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_equal(operand l, operand r) { return to_boolean(number_of<L>(l) == number_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> float_not_equal(operand l, operand r) { return to_boolean(number_of<L>(l) != number_of<R>(r)); }
+
+    //out of line, the int64 kernels below only reach them after an overflow and stay small
+    template <object_type L, object_type R>
+    [[gnu::noinline]] static std::shared_ptr<object> big_plus(operand l, operand r) { return make_integer(big_of<L>(l) + big_of<R>(r)); }
+    template <object_type L, object_type R>
+    [[gnu::noinline]] static std::shared_ptr<object> big_minus(operand l, operand r) { return make_integer(big_of<L>(l) - big_of<R>(r)); }
+    template <object_type L, object_type R>
+    [[gnu::noinline]] static std::shared_ptr<object> big_astrisk(operand l, operand r) { return make_integer(big_of<L>(l) * big_of<R>(r)); }
+    template <object_type L, object_type R>
+    [[gnu::noinline]] static std::shared_ptr<object> big_slash(operand l, operand r)
+    {
+      if constexpr(R == object_type::integer)
+        if(int_of(r) == 0)
+          return add_error("division by zero");
+      return make_integer(big_of<L>(l) / big_of<R>(r));
+    }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> big_less(operand l, operand r) { return to_boolean(big_of<L>(l) < big_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> big_greater(operand l, operand r) { return to_boolean(big_of<L>(l) > big_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> big_equal(operand l, operand r) { return to_boolean(big_of<L>(l) == big_of<R>(r)); }
+    template <object_type L, object_type R>
+    static std::shared_ptr<object> big_not_equal(operand l, operand r) { return to_boolean(big_of<L>(l) != big_of<R>(r)); }
+
+    //the int64 fast path is one checked instruction, an overflow redoes the operation in a bignum
+    static std::shared_ptr<object> int_plus(operand l, operand r)
+    {
+      int64_t out;
+      if(__builtin_add_overflow(int_of(l), int_of(r), &out)) [[unlikely]]
+        return big_plus<object_type::integer, object_type::integer>(l, r);
+      return std::make_shared<integer>(out);
+    }
+    static std::shared_ptr<object> int_minus(operand l, operand r)
+    {
+      int64_t out;
+      if(__builtin_sub_overflow(int_of(l), int_of(r), &out)) [[unlikely]]
+        return big_minus<object_type::integer, object_type::integer>(l, r);
+      return std::make_shared<integer>(out);
+    }
+    static std::shared_ptr<object> int_astrisk(operand l, operand r)
+    {
+      int64_t out;
+      if(__builtin_mul_overflow(int_of(l), int_of(r), &out)) [[unlikely]]
+        return big_astrisk<object_type::integer, object_type::integer>(l, r);
+      return std::make_shared<integer>(out);
+    }
+    static std::shared_ptr<object> int_slash(operand l, operand r)
+    {
+      auto divisor = int_of(r);
+      if(divisor == 0)
+        return add_error("division by zero");
+      //the one quotient that doesn't fit, min / -1
+      if(divisor == -1 && int_of(l) == std::numeric_limits<int64_t>::min()) [[unlikely]]
+        return big_slash<object_type::integer, object_type::integer>(l, r);
+      return std::make_shared<integer>(int_of(l) / divisor);
+    }
+    static std::shared_ptr<object> int_less(operand l, operand r) { return to_boolean(int_of(l) < int_of(r)); }
+    static std::shared_ptr<object> int_greater(operand l, operand r) { return to_boolean(int_of(l) > int_of(r)); }
+    static std::shared_ptr<object> int_equal(operand l, operand r) { return to_boolean(int_of(l) == int_of(r)); }
+    static std::shared_ptr<object> int_not_equal(operand l, operand r) { return to_boolean(int_of(l) != int_of(r)); }
+
+    static std::shared_ptr<object> bool_equal(operand l, operand r) { return to_boolean(bool_of(l) == bool_of(r)); }
+    static std::shared_ptr<object> bool_not_equal(operand l, operand r) { return to_boolean(bool_of(l) != bool_of(r)); }
+    static std::shared_ptr<object> bool_other(operand, operand) { return get_null(); }
+
+    static std::shared_ptr<object> string_plus(operand l, operand r)
+    {
+      return string::concat(std::static_pointer_cast<string>(l), std::static_pointer_cast<string>(r));
     }
+
+    static std::shared_ptr<object> int_minus_prefix(operand r)
+    {
+      if(int_of(r) == std::numeric_limits<int64_t>::min()) [[unlikely]]
+        return big_minus<object_type::integer, object_type::integer>(std::make_shared<integer>(0), r);
+      return std::make_shared<integer>(-int_of(r));
+    }
+    static std::shared_ptr<object> big_minus_prefix(operand r) { return make_integer(-big_of<object_type::big_integer>(r)); }
+    static std::shared_ptr<object> bool_bang(operand r) { return to_boolean(!bool_of(r)); }
+    static std::shared_ptr<object> int_bang(operand r) { return to_boolean(int_of(r) != 0); } // 0 == false : true
+    static std::shared_ptr<object> float_minus_prefix(operand r) { return float_result<object_type::floating, object_type::null>(r, r, -float_of(r)); }
+    static std::shared_ptr<object> float_bang(operand r) { return to_boolean(float_of(r) != 0); }
+    static std::shared_ptr<object> big_bang(operand) { return get_true(); } // a big_integer is never 0
+    static std::shared_ptr<object> null_bang(operand) { return get_true(); }
+    static std::shared_ptr<object> other_bang(operand) { return get_false(); }
   }
- 
-  std::shared_ptr<object> eval_minus_prefix_operator_expression(const std::shared_ptr<object>& obj)
+
+  using infix_kernel = std::shared_ptr<object>(*)(const std::shared_ptr<object>&, const std::shared_ptr<object>&);
+  using prefix_kernel = std::shared_ptr<object>(*)(const std::shared_ptr<object>&);
+
+  //indexed by operator, left type and right type. an empty slot is an error
+  using infix_table = std::array<std::array<std::array<infix_kernel, object_type_count>, object_type_count>, operator_type_count>;
+  using prefix_table = std::array<std::array<prefix_kernel, object_type_count>, operator_type_count>;
+
+  static constexpr infix_table make_infix_table()
   {
-    if(obj->get_type() != object_type::integer)
-      return add_error("unknown operator: " + std::string(" - ") + std::to_string((uint32_t)obj->get_type()));
+    using namespace kernels;
+    infix_table table{};
+    auto set = [&](operator_type op, object_type l, object_type r, infix_kernel kernel) {
+      table[static_cast<size_t>(op)][static_cast<size_t>(l)][static_cast<size_t>(r)] = kernel;
+    };
+
+    constexpr auto i = object_type::integer;
+    set(operator_type::plus, i, i, int_plus);
+    set(operator_type::minus, i, i, int_minus);
+    set(operator_type::astrisk, i, i, int_astrisk);
+    set(operator_type::slash, i, i, int_slash);
+    set(operator_type::less, i, i, int_less);
+    set(operator_type::greater, i, i, int_greater);
+    set(operator_type::equal, i, i, int_equal);
+    set(operator_type::not_equal, i, i, int_not_equal);
+
+    constexpr auto f = object_type::floating;
+    auto set_float = [&]<object_type L, object_type R>() {
+      set(operator_type::plus, L, R, float_plus<L, R>);
+      set(operator_type::minus, L, R, float_minus<L, R>);
+      set(operator_type::astrisk, L, R, float_astrisk<L, R>);
+      set(operator_type::slash, L, R, float_slash<L, R>);
+      set(operator_type::less, L, R, float_less<L, R>);
+      set(operator_type::greater, L, R, float_greater<L, R>);
+      set(operator_type::equal, L, R, float_equal<L, R>);
+      set(operator_type::not_equal, L, R, float_not_equal<L, R>);
+    };
+    set_float.template operator()<f, f>();
+    set_float.template operator()<i, f>();
+    set_float.template operator()<f, i>();
+
+    constexpr auto n = object_type::big_integer;
+    auto set_big = [&]<object_type L, object_type R>() {
+      set(operator_type::plus, L, R, big_plus<L, R>);
+      set(operator_type::minus, L, R, big_minus<L, R>);
+      set(operator_type::astrisk, L, R, big_astrisk<L, R>);
+      set(operator_type::slash, L, R, big_slash<L, R>);
+      set(operator_type::less, L, R, big_less<L, R>);
+      set(operator_type::greater, L, R, big_greater<L, R>);
+      set(operator_type::equal, L, R, big_equal<L, R>);
+      set(operator_type::not_equal, L, R, big_not_equal<L, R>);
+    };
+    set_big.template operator()<n, n>();
+    set_big.template operator()<i, n>();
+    set_big.template operator()<n, i>();
+    set_float.template operator()<n, f>();
+    set_float.template operator()<f, n>();
+
+    constexpr auto b = object_type::boolean;
+    for(size_t op = 0; op < operator_type_count; ++op)
+      set(static_cast<operator_type>(op), b, b, bool_other);
+    set(operator_type::equal, b, b, bool_equal);
+    set(operator_type::not_equal, b, b, bool_not_equal);
+
+    set(operator_type::plus, object_type::string, object_type::string, string_plus);
+    return table;
+  }
 
-    auto int_obj = std::static_pointer_cast<integer>(obj);
-    return std::make_shared<integer>(-int_obj->get_value());
+  static constexpr prefix_table make_prefix_table()
+  {
+    using namespace kernels;
+    prefix_table table{};
+    auto& bang = table[static_cast<size_t>(operator_type::bang)];
+    for(auto& kernel : bang)
+      kernel = other_bang;
+    bang[static_cast<size_t>(object_type::boolean)] = bool_bang;
+    bang[static_cast<size_t>(object_type::integer)] = int_bang;
+    bang[static_cast<size_t>(object_type::floating)] = float_bang;
+    bang[static_cast<size_t>(object_type::big_integer)] = big_bang;
+    bang[static_cast<size_t>(object_type::null)] = null_bang;
+
+    table[static_cast<size_t>(operator_type::minus)][static_cast<size_t>(object_type::integer)] = int_minus_prefix;
+    table[static_cast<size_t>(operator_type::minus)][static_cast<size_t>(object_type::floating)] = float_minus_prefix;
+    table[static_cast<size_t>(operator_type::minus)][static_cast<size_t>(object_type::big_integer)] = big_minus_prefix;
+    return table;
   }
- 
-  std::shared_ptr<object> eval_integer_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
+
+  static constexpr infix_table s_infix_table = make_infix_table();
+  static constexpr prefix_table s_prefix_table = make_prefix_table();
+
+  [[gnu::noinline]] static std::shared_ptr<object> node_type_error(node_type type)
   {
-    auto left_int_obj = std::static_pointer_cast<integer>(left);
-    auto right_int_obj = std::static_pointer_cast<integer>(right);
-    
-    auto left_val = left_int_obj->get_value();
-    auto right_val = right_int_obj->get_value();
-
-    //TODO: operator enum
-
-    if(op == "+")
-      return std::make_shared<integer>(left_val + right_val);
-    if(op == "-")
-      return std::make_shared<integer>(left_val - right_val);
-    if(op == "*")
-      return std::make_shared<integer>(left_val * right_val);
-    if(op == "/")
-      return std::make_shared<integer>(left_val / right_val);
-   
-    if(op == "<")
-      return to_boolean(left_val < right_val);
-    if(op == ">")
-      return to_boolean(left_val > right_val);
-    if(op == "==")
-      return to_boolean(left_val == right_val);
-    if(op == "!=")
-      return to_boolean(left_val != right_val);
-
-    return add_error("unknown operator: " + op + " " + std::to_string((uint32_t)left->get_type()) + " " + std::to_string((uint32_t)right->get_type()));
-  }
-
-  std::shared_ptr<object> eval_boolean_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
-  {
-    auto left_bool_obj = std::static_pointer_cast<boolean>(left);
-    auto right_bool_obj = std::static_pointer_cast<boolean>(right);
-    
-    auto left_val = left_bool_obj->get_value();
-    auto right_val = right_bool_obj->get_value();
+    return add_error("can't evaluate node of type: " + std::to_string((uint32_t)type));
+  }
 
-    //TODO: operator enum
+  [[gnu::noinline]] static std::shared_ptr<object> prefix_error(operator_type op, object_type right_type)
+  {
+    return add_error("unknown operator: " + std::string(to_string(op)) + " " + std::to_string((uint32_t)right_type));
+  }
+
+  [[gnu::noinline]] static std::shared_ptr<object> infix_error(operator_type op, object_type left_type, object_type right_type)
+  {
+    auto op_str = std::string(to_string(op));
+    if(left_type != right_type)
+      return add_error("type mismatch: " + std::to_string((uint32_t)left_type) + " " + op_str + " " + std::to_string((uint32_t)right_type));
     
-    if(op == "==")
-      return to_boolean(left_val == right_val);
-    if(op == "!=")
-      return to_boolean(left_val != right_val);
+    return add_error("unknown operator: " + op_str + " " + std::to_string((uint32_t)left_type) + " " + std::to_string((uint32_t)right_type));
+  }
 
-    return get_null();
+  //TODO: operator overloading
+  std::shared_ptr<object> eval_prefix_expression(operator_type op, const std::shared_ptr<object>& right)
+  {
+    if(auto kernel = s_prefix_table[static_cast<size_t>(op)][static_cast<size_t>(right->get_type())])
+      return kernel(right);
+
+    return prefix_error(op, right->get_type());
   }
 
-  std::shared_ptr<object> eval_string_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
+  //TODO: operator overloading
+  std::shared_ptr<object> eval_infix_expression(operator_type op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right)
   {
-    auto left_string_obj = std::static_pointer_cast<string>(left);
-    auto right_string_obj = std::static_pointer_cast<string>(right);
+    auto left_type = left->get_type();
+    auto right_type = right->get_type();
+    if(auto kernel = s_infix_table[static_cast<size_t>(op)][static_cast<size_t>(left_type)][static_cast<size_t>(right_type)])
+      return kernel(left, right);
 
-    if(op != "+")
-      return add_error("unknown operator: " + op + std::to_string((uint32_t)left_string_obj->get_type()) + std::to_string((uint32_t)right_string_obj->get_type()));
+    return infix_error(op, left_type, right_type);
+  }
 
-    return std::make_shared<string>(left_string_obj->get_value() + right_string_obj->get_value());
+  std::shared_ptr<object> eval_bang_operator_expression(const std::shared_ptr<object>& obj)
+  {
+    return eval_prefix_expression(operator_type::bang, obj);
+  }
+ 
+  std::shared_ptr<object> eval_minus_prefix_operator_expression(const std::shared_ptr<object>& obj)
+  {
+    return eval_prefix_expression(operator_type::minus, obj);
   }
 
 
   std::shared_ptr<environment> extend_function_environment(const std::shared_ptr<fun>&, const std::vector<std::shared_ptr<object>>&);
   std::shared_ptr<object> unwrap_return_value(const std::shared_ptr<object>&);
 
+  //the body was skipped by the parser or not built from the flat ast yet, do it now and keep
+  //it on the literal for every closure made from it
+  static std::shared_ptr<object> load_fun_body(const std::shared_ptr<fun>& _fun)
+  {
+    auto& literal = _fun->literal;
+    if(!literal->body)
+    {
+      if(literal->load_body)
+        literal->body = literal->load_body();
+      if(!literal->body)
+      {
+        parser::errors errs;
+        literal->body = parser::parse_fun_body(literal->body_source, errs);
+        if(!literal->body)
+        {
+          std::string msg = "parse error in function body:";
+          for(const auto& e : errs)
+            msg += " " + e;
+          return add_error(msg);
+        }
+      }
+      //the program's pass couldn't see a body that wasn't there yet
+      get_optimizer().optimize(literal->body);
+    }
+    _fun->body = literal->body;
+    return nullptr;
+  }
+
+  //what the first call sets up on the function and its literal, everything after only reads it
+  static std::shared_ptr<object> prepare_call(const std::shared_ptr<fun>& _fun)
+  {
+    if(!_fun->body)
+    {
+      if(auto err = load_fun_body(_fun))
+        return err;
+    }
+    auto& literal = _fun->literal;
+    if(!literal->memo_checked)
+      get_optimizer().memoize(literal);
+    if(!literal->specialize_checked)
+      get_optimizer().specialize(literal);
+    return nullptr;
+  }
+
+  static std::shared_ptr<object> run_function(const std::shared_ptr<fun>& _fun, const std::vector<std::shared_ptr<object>>& args)
+  {
+    auto& literal = _fun->literal;
+    if(literal->specialized)
+    {
+      if(auto res = run_specialized(*literal, _fun->env, args))
+        return res;
+    }
+    auto ext_env = extend_function_environment(_fun, args);
+    auto evaluated = eval(_fun->body, ext_env);
+
+    return unwrap_return_value(evaluated);
+  }
+
+  //the cache key is built in these frames, not in the one every plain call goes through
+  [[gnu::noinline]] static std::shared_ptr<object> run_memoized(const std::shared_ptr<fun>& _fun, const std::vector<std::shared_ptr<object>>& args)
+  {
+    return call_through(_fun->literal->memo->cache, args, [&] { return run_function(_fun, args); });
+  }
+
+  [[gnu::noinline]] static std::shared_ptr<object> invoke_memoized(const std::shared_ptr<memoized>& memo_fun, const std::vector<std::shared_ptr<object>>& args)
+  {
+    return call_through(*memo_fun->cache, args, [&] { return invoke_function(memo_fun->target, args); });
+  }
+
   std::shared_ptr<object> invoke_function(const std::shared_ptr<object>& fun_obj, const std::vector<std::shared_ptr<object>>& args)
   { 
     if(fun_obj->get_type() == object_type::fun)
     {
       auto _fun = std::static_pointer_cast<fun>(fun_obj);
-      auto ext_env = extend_function_environment(_fun, args);
-      auto evaluated = eval(_fun->body, ext_env);
-
-      return unwrap_return_value(evaluated);
+      if(auto err = prepare_call(_fun))
+        return err;
+      auto& literal = _fun->literal;
+      //a name the body calls through holding something else means the cache may be wrong
+      if(literal->memo && literal->memo->holds(_fun->env))
+        return run_memoized(_fun, args);
+      return run_function(_fun, args);
     }
     else if(fun_obj->get_type() == object_type::builtin)
     {
       auto builtin_fun = std::static_pointer_cast<builtin>(fun_obj);
       return builtin_fun->_fun(args);
     }
+    else if(fun_obj->get_type() == object_type::memoized)
+    {
+      auto memo_fun = std::static_pointer_cast<memoized>(fun_obj);
+      return invoke_memoized(memo_fun, args);
+    }
     else 
       return add_error("expression is not a function: " + std::to_string((uint32_t)fun_obj->get_type()));
   }
 
+  static bool prepared(const fun& _fun)
+  {
+    return _fun.body && _fun.literal->memo_checked && _fun.literal->specialize_checked;
+  }
+
+  //whether calls to the function can run as forks. its literal has to be pure and the names it
+  //calls through have to still hold. the first call to everything it reaches has to have
+  //happened, that's done here so no fork sets anything up, and inside a fork it's taken as a no.
+  //a function with a cache isn't forked, its calls are cheap and would all wait on the one cache
+  bool ready_to_fork(const std::shared_ptr<object>& callee)
+  {
+    if(callee->get_type() != object_type::fun)
+      return false;
+    auto _fun = std::static_pointer_cast<fun>(callee);
+    auto& literal = _fun->literal;
+    if(!prepared(*_fun) || !literal->fork_checked)
+    {
+      if(in_parallel() || prepare_call(_fun))
+        return false;
+      if(!literal->fork_checked)
+        get_optimizer().plan_fork(literal);
+    }
+    if(!literal->fork || literal->memo || !literal->fork->holds(_fun->env))
+      return false;
+
+    for(const auto& dep : literal->fork->dependencies)
+    {
+      if(dep.builtin)
+        continue;
+      auto reached = std::static_pointer_cast<fun>(eval_identifire(dep.name, _fun->env));
+      if(prepared(*reached) && reached->literal->fork_checked)
+        continue;
+      if(in_parallel() || prepare_call(reached))
+        return false;
+      if(!reached->literal->fork_checked)
+        get_optimizer().plan_fork(reached->literal);
+    }
+    return true;
+  }
+
+  static bool ready_to_fork(const std::shared_ptr<expression>& operand, const std::shared_ptr<environment>& env)
+  {
+    const auto& call_node = operand->get_type() == node_type::inlined ? std::static_pointer_cast<inlined_call>(operand)->original : std::static_pointer_cast<call>(operand);
+    return ready_to_fork(eval_identifire(std::static_pointer_cast<identifire>(call_node->function), env));
+  }
+
+  //both sides at once, nullptr when either of them can't be forked. the calls are pure so which
+  //one finishes first can't be seen, an error on the left still wins
+  [[gnu::noinline]] static std::shared_ptr<object> eval_forked_infix(const std::shared_ptr<infix>& infix_node, const std::shared_ptr<environment>& env)
+  {
+    if(!ready_to_fork(infix_node->left, env) || !ready_to_fork(infix_node->right, env))
+      return nullptr;
+
+    std::shared_ptr<object> left;
+    std::shared_ptr<object> right;
+    get_fork_join_pool().invoke([&] { left = eval(infix_node->left, env); }, [&] { right = eval(infix_node->right, env); });
+    if(is_error(left))
+      return left;
+    if(is_error(right))
+      return right;
+    return eval_infix_expression(infix_node->op, left, right);
+  }
+
+  //the calls run as forks and the plain elements here, nullptr when a call can't be forked.
+  //nothing in it has an effect, the first error in order is the one that comes out
+  [[gnu::noinline]] static std::shared_ptr<object> eval_forked_array(const std::shared_ptr<array_literal>& arr_node, const std::shared_ptr<environment>& env)
+  {
+    const auto& exprs = arr_node->elements;
+    std::vector<size_t> calls;
+    for(size_t i = 0; i < exprs.size(); ++i)
+    {
+      auto type = exprs[i]->get_type();
+      if(type != node_type::call && type != node_type::inlined)
+        continue;
+      if(!ready_to_fork(exprs[i], env))
+        return nullptr;
+      calls.push_back(i);
+    }
+
+    std::vector<std::shared_ptr<object>> elements(exprs.size());
+    for(size_t i = 0; i < exprs.size(); ++i)
+      if(exprs[i]->get_type() != node_type::call && exprs[i]->get_type() != node_type::inlined)
+        elements[i] = eval(exprs[i], env);
+    get_fork_join_pool().for_range(0, calls.size(), 1, [&](size_t begin, size_t end) {
+      for(auto i = begin; i < end; ++i)
+        elements[calls[i]] = eval(exprs[calls[i]], env);
+    });
+
+    for(const auto& element : elements)
+      if(is_error(element))
+        return element;
+    return std::make_shared<array>(elements);
+  }
+
+  //the copy only stands in for the call while the name still holds the function it was made
+  //from and the builtins it uses aren't shadowed, otherwise the call runs as written
+  std::shared_ptr<object> eval_inlined_call(const std::shared_ptr<inlined_call>& inline_node, const std::shared_ptr<environment>& env)
+  {
+    auto function = eval(inline_node->original->function, env);
+    if(is_error(function))
+      return function;
+
+    bool same = function->get_type() == object_type::fun && std::static_pointer_cast<fun>(function)->literal == inline_node->target;
+    for(size_t i = 0; same && i < inline_node->builtins.size(); ++i)
+      same = !inline_node->builtins[i].is_shadowed();
+    if(!same)
+    {
+      auto args = eval_expressions(inline_node->original->arguments, env);
+      if(args.size() == 1 && is_error(args[0]))
+        return args[0];
+      return invoke_function(function, args);
+    }
+
+    //the copy gets a frame like the call would have, its params and locals are gone after it
+    auto frame = std::make_shared<environment>(env);
+    for(const auto& [i, param] : inline_node->parameters)
+    {
+      auto arg = eval(inline_node->original->arguments[i], env);
+      if(is_error(arg))
+        return arg;
+      frame->set(param, arg);
+    }
+    return unwrap_return_value(eval_block_statement(inline_node->body, frame));
+  }
+
+  //the argument array stays in this frame, not in the trampoline's
+  [[gnu::noinline]] std::shared_ptr<object> eval_intrinsic_call(const std::shared_ptr<intrinsic_call>& intrinsic_node, const std::shared_ptr<environment>& env)
+  {
+    if(intrinsic_node->name.is_shadowed())
+      return eval(intrinsic_node->original, env);
+
+    //builtins take few arguments, they go on the stack
+    const auto& exprs = intrinsic_node->original->arguments;
+    std::array<std::shared_ptr<object>, 4> small;
+    std::vector<std::shared_ptr<object>> big;
+    auto args = std::span(small).first(std::min(exprs.size(), small.size()));
+    if(exprs.size() > small.size())
+    {
+      big.resize(exprs.size());
+      args = big;
+    }
+
+    for(size_t i = 0; i < exprs.size(); ++i)
+    {
+      args[i] = eval(exprs[i], env);
+      if(is_error(args[i]))
+        return args[i];
+    }
+    return static_cast<builtin*>(intrinsic_node->target.get())->_fun(args);
+  }
+
   std::shared_ptr<environment> extend_function_environment(const std::shared_ptr<fun>&_fun, const std::vector<std::shared_ptr<object>>& args)
   {
     auto ext_env = std::make_shared<environment>(_fun->env);
@@ -537,7 +1045,7 @@ namespace my_ns
         //return add_error("too few arguments");
         std::cout << "too few arguments\n";
       }
-      ext_env->set(param->value, args[i++]);
+      ext_env->set(param->sym, args[i++]);
     }
     return ext_env;
   }
@@ -582,6 +1090,14 @@ namespace my_ns
     if(!key)
       return add_error("type: " + std::to_string((uint32_t)index->get_type()) + " is not hashable");
 
+    if(auto sh = _map->get_shape(); sh && index->get_type() == object_type::string)
+    {
+      //a key that was never interned can't be a field of any record
+      auto sym = find_interned(std::static_pointer_cast<string>(index)->get_value());
+      auto slot = sym ? sh->find(*sym) : shape::no_slot;
+      return slot == shape::no_slot ? get_null() : _map->get_slots()[slot];
+    }
+
     const auto& hm = _map->get_map();
     auto elem_it = hm.find(key->hash());
     if(elem_it == hm.end())
@@ -590,8 +1106,96 @@ namespace my_ns
     return elem_it->second.value;
   }
 
+  std::shared_ptr<object> eval_record_index_expression(const std::shared_ptr<index>& index_node, const std::shared_ptr<object>& m)
+  {
+    auto _map = std::static_pointer_cast<map>(m);
+    auto sh = _map->get_shape();
+    if(sh && sh == index_node->cached_shape)
+      return _map->get_slots()[index_node->cached_slot];
+
+    auto key = std::static_pointer_cast<string_literal>(index_node->right);
+    if(!sh)
+      return eval_hash_index_expression(m, std::make_shared<string>(key->buffer, 0, key->buffer->size()));
+
+    auto slot = sh->find(key->get_symbol());
+    if(slot == shape::no_slot)
+      return get_null();
+
+    if(!in_parallel())
+    {
+      index_node->cached_shape = sh;
+      index_node->cached_slot = slot;
+    }
+    return _map->get_slots()[slot];
+  }
+
+  //the shape a record literal makes and its values in slot order, no shape when it's not a record
+  struct record_layout
+  {
+    const shape* record_shape = nullptr;
+    std::vector<std::shared_ptr<expression>> values;
+  };
+
+  //map literals with only string literal keys become records with a shared shape
+  static record_layout resolve_record_shape(const std::shared_ptr<map_literal>& hm)
+  {
+    record_layout layout;
+    std::vector<std::pair<symbol, std::shared_ptr<expression>>> fields;
+    for(const auto& [key, value] : hm->pairs)
+    {
+      if(!key || key->get_type() != node_type::string)
+        return layout;
+      auto sym = std::static_pointer_cast<string_literal>(key)->get_symbol();
+      fields.emplace_back(sym, value);
+    }
+
+    std::sort(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.first.str() < b.first.str(); });
+    //duplicate keys keep a single value, like the generic path
+    fields.erase(std::unique(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.first == b.first; }), fields.end());
+
+    std::vector<symbol> keys;
+    for(const auto& field : fields)
+    {
+      keys.push_back(field.first);
+      layout.values.push_back(field.second);
+    }
+    layout.record_shape = shape::get(keys);
+    return layout;
+  }
+
   std::shared_ptr<object> eval_map(const std::shared_ptr<map_literal>& hm, const std::shared_ptr<environment>& env)
   {
+    //kept on the literal after the first eval, while forks run it's worked out every time
+    record_layout layout;
+    auto record_shape = hm->record_shape;
+    const auto* record_values = &hm->record_values;
+    if(!hm->record_checked)
+    {
+      layout = resolve_record_shape(hm);
+      record_shape = layout.record_shape;
+      record_values = &layout.values;
+      if(!in_parallel())
+      {
+        hm->record_shape = layout.record_shape;
+        hm->record_values = layout.values;
+        hm->record_checked = true;
+      }
+    }
+
+    if(record_shape)
+    {
+      std::vector<std::shared_ptr<object>> slots;
+      slots.reserve(record_values->size());
+      for(const auto& value_expr : *record_values)
+      {
+        auto value = eval(value_expr, env);
+        if(is_error(value))
+          return value;
+        slots.push_back(value);
+      }
+      return std::make_shared<map>(record_shape, std::move(slots));
+    }
+
     std::unordered_map<hash_t, map::hash_pair> _map;
     for(const auto& elem : hm->pairs)
     {
@@ -652,6 +1256,14 @@ namespace my_ns
         auto int_obj = std::static_pointer_cast<integer>(obj);
         return to_boolean(int_obj->get_value()); // 0 == false : true
       }
+      case object_type::floating:
+      {
+        return to_boolean(std::static_pointer_cast<floating>(obj)->get_value() != 0);
+      }
+      case object_type::big_integer:
+      {
+        return get_true();
+      }
       case object_type::boolean:
       {
         return std::static_pointer_cast<boolean>(obj);
@@ -3,7 +3,9 @@
 #include "ast.hpp"
 #include "object.hpp"
 
+#include <functional>
 #include <memory>
+#include <variant>
 
 //TODO: don't print the errors return them like the parser
 
@@ -17,27 +19,35 @@ namespace my_ns
  
   std::vector<std::shared_ptr<object>> eval_expressions(const std::vector<std::shared_ptr<expression>>&, const std::shared_ptr<environment>&);
   std::shared_ptr<object> eval_if_expression(const std::shared_ptr<_if>&, const std::shared_ptr<environment>& env);
+  //loops run in place, every iteration shares one frame and none of them adds to the C++ stack
+  std::shared_ptr<object> eval_while_expression(const std::shared_ptr<_while>&, const std::shared_ptr<environment>& env);
+  std::shared_ptr<object> eval_for_expression(const std::shared_ptr<_for>&, const std::shared_ptr<environment>& env);
 
 
   std::shared_ptr<object> eval_identifire(const std::shared_ptr<identifire>&, const std::shared_ptr<environment>&);
 
-  std::shared_ptr<object> eval_prefix_expression(const std::string& op, const std::shared_ptr<object>& right);
-  std::shared_ptr<object> eval_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
+  //both jump through a table indexed by the operator and the operand types
+  std::shared_ptr<object> eval_prefix_expression(operator_type op, const std::shared_ptr<object>& right);
+  std::shared_ptr<object> eval_infix_expression(operator_type op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
   
   std::shared_ptr<object> eval_bang_operator_expression(const std::shared_ptr<object>&);
   std::shared_ptr<object> eval_minus_prefix_operator_expression(const std::shared_ptr<object>&);
 
 
-  std::shared_ptr<object> eval_integer_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
-  std::shared_ptr<object> eval_boolean_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
-  std::shared_ptr<object> eval_string_infix_expression(const std::string& op, const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
-
   std::shared_ptr<object> invoke_function(const std::shared_ptr<object>&, const std::vector<std::shared_ptr<object>>&);
+  //whether a fun can be called from several threads at once, its first call is set up here if it's still to come
+  bool ready_to_fork(const std::shared_ptr<object>& callee);
+  std::shared_ptr<object> eval_inlined_call(const std::shared_ptr<inlined_call>&, const std::shared_ptr<environment>&);
+  std::shared_ptr<object> eval_intrinsic_call(const std::shared_ptr<intrinsic_call>&, const std::shared_ptr<environment>&);
 
   std::shared_ptr<object> eval_index_expression(const std::shared_ptr<object>& left, const std::shared_ptr<object>& right);
   std::shared_ptr<object> eval_array_index_expression(const std::shared_ptr<object>& arr, const std::shared_ptr<object>& index);
   std::shared_ptr<object> eval_hash_index_expression(const std::shared_ptr<object>& arr, const std::shared_ptr<object>& index);
+  std::shared_ptr<object> eval_record_index_expression(const std::shared_ptr<index>&, const std::shared_ptr<object>& m);
   std::shared_ptr<object> eval_map(const std::shared_ptr<map_literal>&, const std::shared_ptr<environment>&);
 
   std::shared_ptr<error> add_error(const std::string& message);
+  std::shared_ptr<null> get_null();
+  std::shared_ptr<boolean> to_boolean(bool b);
+  std::shared_ptr<boolean> to_boolean(const std::shared_ptr<object>& obj);
 }
@@ -0,0 +1,453 @@
+#include "flat_ast.hpp"
+#include "ast.hpp"
+
+#include <cstring>
+#include <memory>
+
+namespace my_ns::flat
+{
+  node_id ast::add(node_type kind, const token& tok, node_id a, node_id b, node_id c)
+  {
+    auto id = static_cast<node_id>(m_kinds.size());
+    m_kinds.push_back(kind);
+    m_tok_types.push_back(tok.type);
+    m_a.push_back(a);
+    m_b.push_back(b);
+    m_c.push_back(c);
+    //literals view the source, the string literal view starts after its quote
+    auto text_offset = tok.literal.empty() ? tok.offset : static_cast<size_t>(tok.literal.data() - m_source.data());
+    m_text_offsets.push_back(static_cast<uint32_t>(text_offset));
+    m_text_lengths.push_back(static_cast<uint32_t>(tok.literal.size()));
+    return id;
+  }
+
+  uint32_t ast::add_list(std::span<const node_id> ids)
+  {
+    auto at = static_cast<uint32_t>(m_lists.size());
+    m_lists.push_back(static_cast<node_id>(ids.size()));
+    m_lists.insert(m_lists.end(), ids.begin(), ids.end());
+    return at;
+  }
+
+  uint32_t ast::add_integer(int64_t value)
+  {
+    m_integers.push_back(value);
+    return static_cast<uint32_t>(m_integers.size() - 1);
+  }
+
+  token ast::get_token(node_id id) const
+  {
+    size_t offset = m_text_offsets[id];
+    if(m_tok_types[id] == token_type::string && m_text_lengths[id] != 0)
+      --offset; //the token starts at the quote
+    return { m_tok_types[id], text(id), offset };
+  }
+
+  void ast::reserve(size_t nodes)
+  {
+    m_kinds.reserve(nodes);
+    m_tok_types.reserve(nodes);
+    m_a.reserve(nodes);
+    m_b.reserve(nodes);
+    m_c.reserve(nodes);
+    m_text_offsets.reserve(nodes);
+    m_text_lengths.reserve(nodes);
+  }
+
+  void ast::shrink_to_fit()
+  {
+    m_kinds.shrink_to_fit();
+    m_tok_types.shrink_to_fit();
+    m_a.shrink_to_fit();
+    m_b.shrink_to_fit();
+    m_c.shrink_to_fit();
+    m_text_offsets.shrink_to_fit();
+    m_text_lengths.shrink_to_fit();
+    m_lists.shrink_to_fit();
+    m_integers.shrink_to_fit();
+  }
+
+  size_t ast::memory_bytes() const
+  {
+    return m_kinds.capacity() * sizeof(node_type)
+      + m_tok_types.capacity() * sizeof(token_type)
+      + (m_a.capacity() + m_b.capacity() + m_c.capacity()) * sizeof(node_id)
+      + (m_text_offsets.capacity() + m_text_lengths.capacity()) * sizeof(uint32_t)
+      + m_lists.capacity() * sizeof(node_id)
+      + m_integers.capacity() * sizeof(int64_t);
+  }
+
+  namespace
+  {
+    template <typename T>
+    void append_pool(std::string& out, const std::vector<T>& pool)
+    {
+      out.append(reinterpret_cast<const char*>(pool.data()), pool.size() * sizeof(T));
+      out.resize((out.size() + 7) & ~size_t(7)); //keep every pool 8 byte aligned
+    }
+
+    template <typename T>
+    bool read_pool(std::string_view& bytes, std::vector<T>& pool, size_t count)
+    {
+      auto size = count * sizeof(T);
+      auto padded = (size + 7) & ~size_t(7);
+      if(bytes.size() < padded)
+        return false;
+      pool.resize(count);
+      std::memcpy(pool.data(), bytes.data(), size);
+      bytes.remove_prefix(padded);
+      return true;
+    }
+
+    struct pool_counts
+    {
+      uint32_t nodes;
+      uint32_t lists;
+      uint32_t integers;
+      uint32_t root;
+    };
+  }
+
+  void ast::serialize(std::string& out) const
+  {
+    pool_counts counts{ static_cast<uint32_t>(m_kinds.size()), static_cast<uint32_t>(m_lists.size()), static_cast<uint32_t>(m_integers.size()), m_root };
+    out.append(reinterpret_cast<const char*>(&counts), sizeof(counts));
+    append_pool(out, m_kinds);
+    append_pool(out, m_tok_types);
+    append_pool(out, m_a);
+    append_pool(out, m_b);
+    append_pool(out, m_c);
+    append_pool(out, m_text_offsets);
+    append_pool(out, m_text_lengths);
+    append_pool(out, m_lists);
+    append_pool(out, m_integers);
+  }
+
+  std::optional<ast> ast::deserialize(std::string_view bytes, std::string_view source)
+  {
+    pool_counts counts;
+    if(bytes.size() < sizeof(counts))
+      return std::nullopt;
+    std::memcpy(&counts, bytes.data(), sizeof(counts));
+    bytes.remove_prefix(sizeof(counts));
+
+    ast flat(source);
+    flat.m_root = counts.root;
+    bool ok = read_pool(bytes, flat.m_kinds, counts.nodes)
+      && read_pool(bytes, flat.m_tok_types, counts.nodes)
+      && read_pool(bytes, flat.m_a, counts.nodes)
+      && read_pool(bytes, flat.m_b, counts.nodes)
+      && read_pool(bytes, flat.m_c, counts.nodes)
+      && read_pool(bytes, flat.m_text_offsets, counts.nodes)
+      && read_pool(bytes, flat.m_text_lengths, counts.nodes)
+      && read_pool(bytes, flat.m_lists, counts.lists)
+      && read_pool(bytes, flat.m_integers, counts.integers);
+
+    if(!ok || !bytes.empty() || !flat.validate())
+      return std::nullopt;
+    return flat;
+  }
+
+  //children always come before their parent, the parser adds them first. checking that
+  //every reference points backwards rules out cycles as well as out of range ids
+  bool ast::validate() const
+  {
+    const auto is_statement = [](node_type k)
+    {
+      return k == node_type::var || k == node_type::ret || k == node_type::expression_statement || k == node_type::block;
+    };
+    const auto is_expression = [](node_type k)
+    {
+      switch(k)
+      {
+        case node_type::identifire: case node_type::integer: case node_type::floating: case node_type::boolean:
+        case node_type::string: case node_type::array: case node_type::index:
+        case node_type::map: case node_type::prefix: case node_type::infix:
+        case node_type::_if: case node_type::fun: case node_type::call:
+        case node_type::_import: case node_type::_while: case node_type::_for:
+          return true;
+        default:
+          return false;
+      }
+    };
+    const auto is_identifire = [](node_type k) { return k == node_type::identifire; };
+    const auto is_block = [](node_type k) { return k == node_type::block; };
+
+    for(node_id id = 0; id < m_kinds.size(); ++id)
+    {
+      if(static_cast<size_t>(m_tok_types[id]) >= token_type_count)
+        return false;
+      if(size_t(m_text_offsets[id]) + m_text_lengths[id] > m_source.size())
+        return false;
+
+      const auto child = [&](node_id c, auto&& pred) { return c < id && pred(m_kinds[c]); };
+      const auto list_of = [&](uint32_t at, auto&& pred)
+      {
+        if(at >= m_lists.size() || m_lists[at] > m_lists.size() - at - 1)
+          return false;
+        for(auto c : list(at))
+          if(!child(c, pred))
+            return false;
+        return true;
+      };
+
+      bool ok = false;
+      switch(m_kinds[id])
+      {
+        case node_type::program:
+          ok = id == m_root && list_of(m_a[id], is_statement);
+          break;
+        case node_type::block:
+          ok = list_of(m_a[id], is_statement);
+          break;
+        case node_type::array:
+          ok = list_of(m_a[id], is_expression);
+          break;
+        case node_type::map:
+          ok = list_of(m_a[id], is_expression) && m_lists[m_a[id]] % 2 == 0;
+          break;
+        case node_type::identifire:
+        case node_type::string:
+        case node_type::boolean:
+          ok = true;
+          break;
+        case node_type::integer:
+        case node_type::floating:
+          ok = m_a[id] < m_integers.size();
+          break;
+        case node_type::_import:
+          ok = m_tok_types[id] == token_type::string;
+          break;
+        case node_type::prefix:
+        case node_type::ret:
+        case node_type::expression_statement:
+          ok = child(m_a[id], is_expression);
+          break;
+        case node_type::infix:
+        case node_type::index:
+          ok = child(m_a[id], is_expression) && child(m_b[id], is_expression);
+          break;
+        case node_type::var:
+          ok = child(m_a[id], is_identifire) && child(m_b[id], is_expression);
+          break;
+        case node_type::_if:
+          ok = child(m_a[id], is_expression) && child(m_b[id], is_block) && (m_c[id] == no_node || child(m_c[id], is_block));
+          break;
+        case node_type::_while:
+          ok = child(m_a[id], is_expression) && child(m_b[id], is_block);
+          break;
+        case node_type::_for:
+          ok = child(m_a[id], is_identifire) && child(m_b[id], is_expression) && child(m_c[id], is_block);
+          break;
+        case node_type::fun:
+          ok = list_of(m_a[id], is_identifire) && child(m_b[id], is_block) && m_c[id] >= m_text_offsets[id] && m_c[id] <= m_source.size();
+          break;
+        case node_type::call:
+          ok = child(m_a[id], is_expression) && list_of(m_b[id], is_expression);
+          break;
+        default:
+          break;
+      }
+      if(!ok)
+        return false;
+    }
+    return m_root < m_kinds.size();
+  }
+
+  namespace
+  {
+    //owner is set when fun bodies should be built on their first call instead of up front
+    class tree_builder
+    {
+    public:
+      tree_builder(const ast& flat, std::shared_ptr<const ast> owner = nullptr)
+        : m_flat(flat), m_owner(std::move(owner))
+      {
+      }
+
+      std::shared_ptr<block> build_block(node_id id)
+      {
+        auto blk = std::make_shared<block>(m_flat.get_token(id));
+        for(auto stmt : m_flat.list(m_flat.a(id)))
+          blk->statements.push_back(build_statement(stmt));
+        return blk;
+      }
+
+      std::shared_ptr<identifire> build_identifire(node_id id)
+      {
+        return std::make_shared<identifire>(m_flat.get_token(id), m_flat.text(id));
+      }
+
+      std::shared_ptr<statement> build_statement(node_id id)
+      {
+        auto tok = m_flat.get_token(id);
+        switch(m_flat.kind(id))
+        {
+          case node_type::var:
+          {
+            auto stmt = std::make_shared<var>(tok);
+            auto name = m_flat.a(id);
+            stmt->name = { m_flat.get_token(name), m_flat.text(name) };
+            stmt->value = build_expression(m_flat.b(id));
+            return stmt;
+          }
+          case node_type::ret:
+          {
+            auto stmt = std::make_shared<ret>(tok);
+            stmt->return_value = build_expression(m_flat.a(id));
+            return stmt;
+          }
+          case node_type::block:
+            return build_block(id);
+          default:
+          {
+            auto stmt = std::make_shared<expression_statement>(tok);
+            stmt->_expression = build_expression(m_flat.a(id));
+            return stmt;
+          }
+        }
+      }
+
+      std::shared_ptr<expression> build_expression(node_id id)
+      {
+        if(id == no_node)
+          return nullptr;
+
+        auto tok = m_flat.get_token(id);
+        switch(m_flat.kind(id))
+        {
+          case node_type::identifire:
+            return build_identifire(id);
+          case node_type::integer:
+          {
+            auto lit = std::make_shared<integer_literal>(tok);
+            lit->value = m_flat.integer(id);
+            return lit;
+          }
+          case node_type::floating:
+          {
+            auto lit = std::make_shared<float_literal>(tok);
+            lit->value = m_flat.floating(id);
+            return lit;
+          }
+          case node_type::string:
+            return std::make_shared<string_literal>(tok, m_flat.text(id));
+          case node_type::boolean:
+            return std::make_shared<boolean_literal>(tok, tok.type == token_type::_true);
+          case node_type::prefix:
+          {
+            auto expr = std::make_shared<prefix>(tok, tok.literal);
+            expr->right = build_expression(m_flat.a(id));
+            return expr;
+          }
+          case node_type::infix:
+          {
+            auto expr = std::make_shared<infix>(tok, tok.literal, build_expression(m_flat.a(id)));
+            expr->right = build_expression(m_flat.b(id));
+            return expr;
+          }
+          case node_type::index:
+          {
+            auto expr = std::make_shared<index>(tok, build_expression(m_flat.a(id)));
+            expr->right = build_expression(m_flat.b(id));
+            return expr;
+          }
+          case node_type::array:
+          {
+            auto arr = std::make_shared<array_literal>(tok);
+            for(auto elem : m_flat.list(m_flat.a(id)))
+              arr->elements.push_back(build_expression(elem));
+            return arr;
+          }
+          case node_type::map:
+          {
+            auto map = std::make_shared<map_literal>(tok);
+            auto pairs = m_flat.list(m_flat.a(id));
+            for(size_t i = 0; i + 1 < pairs.size(); i += 2)
+              map->pairs[build_expression(pairs[i])] = build_expression(pairs[i + 1]);
+            return map;
+          }
+          case node_type::_if:
+          {
+            auto expr = std::make_shared<_if>(tok);
+            expr->condition = build_expression(m_flat.a(id));
+            expr->consequence = build_block(m_flat.b(id));
+            if(m_flat.c(id) != no_node)
+              expr->alternative = build_block(m_flat.c(id));
+            return expr;
+          }
+          case node_type::_while:
+          {
+            auto loop = std::make_shared<_while>(tok);
+            loop->condition = build_expression(m_flat.a(id));
+            loop->body = build_block(m_flat.b(id));
+            return loop;
+          }
+          case node_type::_for:
+          {
+            auto loop = std::make_shared<_for>(tok);
+            auto variable = m_flat.a(id);
+            loop->variable = { m_flat.get_token(variable), m_flat.text(variable) };
+            loop->iterable = build_expression(m_flat.b(id));
+            loop->body = build_block(m_flat.c(id));
+            return loop;
+          }
+          case node_type::fun:
+          {
+            auto fun = std::make_shared<fun_literal>(tok);
+            fun->source = m_flat.get_source().substr(tok.offset, m_flat.c(id) - tok.offset);
+            for(auto param : m_flat.list(m_flat.a(id)))
+              fun->parameters.push_back(build_identifire(param));
+            if(m_owner)
+            {
+              fun->load_body = [owner = m_owner, body = m_flat.b(id)]
+              {
+                return tree_builder(*owner, owner).build_block(body);
+              };
+            }
+            else
+              fun->body = build_block(m_flat.b(id));
+            return fun;
+          }
+          case node_type::call:
+          {
+            auto expr = std::make_shared<call>(tok, build_expression(m_flat.a(id)));
+            for(auto arg : m_flat.list(m_flat.b(id)))
+              expr->arguments.push_back(build_expression(arg));
+            return expr;
+          }
+          case node_type::_import:
+            return std::make_shared<import_expression>(tok, m_flat.text(id));
+          default:
+            return nullptr;
+        }
+      }
+
+      std::shared_ptr<program> build_program()
+      {
+        auto prog = std::make_shared<program>();
+        for(auto stmt : top_level(m_flat))
+          prog->m_statements.push_back(build_statement(stmt));
+        return prog;
+      }
+    private:
+      const ast& m_flat;
+      std::shared_ptr<const ast> m_owner;
+    };
+  }
+
+  std::shared_ptr<program> to_tree(const ast& flat)
+  {
+    return tree_builder(flat).build_program();
+  }
+
+  std::shared_ptr<program> to_tree(const std::shared_ptr<const ast>& flat)
+  {
+    return tree_builder(*flat, flat).build_program();
+  }
+
+  std::shared_ptr<statement> to_tree(const std::shared_ptr<const ast>& flat, node_id stmt)
+  {
+    return tree_builder(*flat, flat).build_statement(stmt);
+  }
+}
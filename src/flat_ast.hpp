@@ -0,0 +1,124 @@
+#pragma once
+
+#include "ast.hpp"
+#include "token.hpp"
+
+#include <bit>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <string>
+#include <span>
+#include <string_view>
+#include <vector>
+
+//the same tree the parser builds, stored as parallel arrays indexed by 32 bit node ids
+//instead of one heap object per node. a whole program is a handful of allocations
+
+namespace my_ns::flat
+{
+  using node_id = uint32_t;
+  constexpr node_id no_node = std::numeric_limits<node_id>::max();
+
+  //what a, b and c hold depends on the kind:
+  //  program, block, array        a = list of children
+  //  map                          a = list of key, value, key, value...
+  //  identifire, string           the token text
+  //  _import                      the path's string token
+  //  integer                      a = index into the integer pool
+  //  floating                     a = index into the integer pool, it holds the double's bits
+  //  boolean                      the token type is the value
+  //  prefix                       the token type is the operator, a = right
+  //  infix                        the token type is the operator, a = left, b = right
+  //  index                        a = left, b = right
+  //  var                          a = name (an identifire), b = value
+  //  ret, expression_statement    a = value
+  //  _if                          a = condition, b = consequence, c = alternative or no_node
+  //  _while                       a = condition, b = body
+  //  _for                         a = variable (an identifire), b = iterable, c = body
+  //  fun                          a = parameter list, b = body, c = source offset past its closing brace
+  //  call                         a = function, b = argument list
+  //a list is its length followed by the ids, stored in the list pool
+  class ast
+  {
+  public:
+    ast() = default;
+    explicit ast(std::string_view source)
+      : m_source(source)
+    {
+    }
+
+    node_id add(node_type kind, const token& tok, node_id a = no_node, node_id b = no_node, node_id c = no_node);
+    uint32_t add_list(std::span<const node_id> ids);
+    uint32_t add_integer(int64_t value);
+
+    inline node_type kind(node_id id) const { return m_kinds[id]; }
+    inline token_type tok_type(node_id id) const { return m_tok_types[id]; }
+    inline node_id a(node_id id) const { return m_a[id]; }
+    inline node_id b(node_id id) const { return m_b[id]; }
+    inline node_id c(node_id id) const { return m_c[id]; }
+    inline int64_t integer(node_id id) const { return m_integers[m_a[id]]; }
+    inline double floating(node_id id) const { return std::bit_cast<double>(m_integers[m_a[id]]); }
+    inline std::span<const node_id> list(uint32_t at) const
+    {
+      return { m_lists.data() + at + 1, m_lists[at] };
+    }
+
+    //the token text of the node, a view into the source
+    inline std::string_view text(node_id id) const
+    {
+      return m_source.substr(m_text_offsets[id], m_text_lengths[id]);
+    }
+
+    //a rebuilt token, same type, text and offset the lexer produced
+    token get_token(node_id id) const;
+
+    inline size_t size() const { return m_kinds.size(); }
+    inline std::string_view get_source() const { return m_source; }
+
+    inline node_id get_root() const { return m_root; }
+    inline void set_root(node_id root) { m_root = root; }
+
+    //the pools as raw bytes, the payload of a .leac cache file
+    void serialize(std::string& out) const;
+    //rebuild from serialize's bytes, nullopt unless every id, list and text span checks out
+    static std::optional<ast> deserialize(std::string_view bytes, std::string_view source);
+
+    void reserve(size_t nodes);
+    //drop the slack left by growing, done once the parse is over
+    void shrink_to_fit();
+    //bytes held by the pools, what the tree would spread over one allocation per node
+    size_t memory_bytes() const;
+  private:
+    bool validate() const;
+  private:
+    std::string_view m_source;
+    node_id m_root = no_node;
+
+    std::vector<node_type> m_kinds;
+    std::vector<token_type> m_tok_types;
+    std::vector<node_id> m_a;
+    std::vector<node_id> m_b;
+    std::vector<node_id> m_c;
+    std::vector<uint32_t> m_text_offsets;
+    std::vector<uint32_t> m_text_lengths;
+
+    std::vector<node_id> m_lists;
+    std::vector<int64_t> m_integers;
+  };
+
+  //rebuild the pointer tree the evaluator walks
+  std::shared_ptr<program> to_tree(const ast& flat);
+  //same but fun bodies are only built on their first call, they keep the ast alive
+  std::shared_ptr<program> to_tree(const std::shared_ptr<const ast>& flat);
+  //one top level statement, fun bodies built on their first call as above
+  std::shared_ptr<statement> to_tree(const std::shared_ptr<const ast>& flat, node_id stmt);
+
+  inline std::span<const node_id> top_level(const ast& flat)
+  {
+    if(flat.get_root() == no_node)
+      return {};
+    return flat.list(flat.a(flat.get_root()));
+  }
+}
@@ -0,0 +1,479 @@
+#include "flat_parser.hpp"
+#include "flat_ast.hpp"
+#include "token.hpp"
+
+#include <bit>
+#include <charconv>
+#include <string>
+
+namespace my_ns
+{
+  using flat::node_id;
+  using flat::no_node;
+
+  flat_parser::flat_parser(lexer* l, std::string_view source)
+    : m_lexer(l), m_ast(source)
+  {
+    //roughly a node per 6 bytes of source, the pools grow past that if needed
+    m_ast.reserve(source.size() / 6);
+    next_token();
+    next_token();
+  }
+
+  constexpr std::array<flat_parser::prefix_parse_fun, token_type_count> flat_parser::make_prefix_table()
+  {
+    std::array<prefix_parse_fun, token_type_count> table{};
+    const auto set = [&table](token_type t, prefix_parse_fun fn) { table[static_cast<size_t>(t)] = fn; };
+
+    set(token_type::identifire, &flat_parser::parse_identifire);
+    set(token_type::integer,    &flat_parser::parse_integer_literal);
+    set(token_type::floating,   &flat_parser::parse_float_literal);
+    set(token_type::string,     &flat_parser::parse_string_literal);
+    set(token_type::l_paren,    &flat_parser::parse_grouped);
+    set(token_type::_if,        &flat_parser::parse_if);
+    set(token_type::fun,        &flat_parser::parse_fun_literal);
+    set(token_type::l_bracket,  &flat_parser::parse_array_literal);
+    set(token_type::l_brace,    &flat_parser::parse_map_literal);
+    set(token_type::bang,       &flat_parser::parse_prefix);
+    set(token_type::minus,      &flat_parser::parse_prefix);
+    set(token_type::_true,      &flat_parser::parse_boolean);
+    set(token_type::_false,     &flat_parser::parse_boolean);
+    set(token_type::_import,    &flat_parser::parse_import);
+    set(token_type::_while,     &flat_parser::parse_while);
+    set(token_type::_for,       &flat_parser::parse_for);
+    return table;
+  }
+
+  constexpr std::array<flat_parser::infix_parse_fun, token_type_count> flat_parser::make_infix_table()
+  {
+    std::array<infix_parse_fun, token_type_count> table{};
+    const auto set = [&table](token_type t, infix_parse_fun fn) { table[static_cast<size_t>(t)] = fn; };
+
+    set(token_type::equal,     &flat_parser::parse_infix);
+    set(token_type::not_equal, &flat_parser::parse_infix);
+    set(token_type::less,      &flat_parser::parse_infix);
+    set(token_type::greater,   &flat_parser::parse_infix);
+    set(token_type::plus,      &flat_parser::parse_infix);
+    set(token_type::minus,     &flat_parser::parse_infix);
+    set(token_type::astrisk,   &flat_parser::parse_infix);
+    set(token_type::slash,     &flat_parser::parse_infix);
+    set(token_type::l_paren,   &flat_parser::parse_call);
+    set(token_type::l_bracket, &flat_parser::parse_index);
+    return table;
+  }
+
+  constinit const std::array<flat_parser::prefix_parse_fun, token_type_count> flat_parser::s_prefix_funs = flat_parser::make_prefix_table();
+  constinit const std::array<flat_parser::infix_parse_fun, token_type_count> flat_parser::s_infix_funs = flat_parser::make_infix_table();
+
+  void flat_parser::next_token()
+  {
+    m_current_token = m_peek_token;
+    m_peek_token = m_lexer->next_token();
+  }
+
+  bool flat_parser::expect_next(token_type tok)
+  {
+    if(m_peek_token.type == tok)
+    {
+      next_token();
+      return true;
+    }
+    peek_error(tok);
+    return false;
+  }
+
+  flat::ast flat_parser::parse_program()
+  {
+    auto mark = m_scratch.size();
+    while(m_current_token.type != token_type::eof)
+    {
+      auto stmt = parse_statement();
+      if(stmt != no_node)
+        m_scratch.push_back(stmt);
+      next_token();
+    }
+    m_ast.set_root(m_ast.add(node_type::program, {}, finish_list(mark)));
+    m_ast.shrink_to_fit();
+    return std::move(m_ast);
+  }
+
+  node_id flat_parser::parse_statement()
+  {
+    switch(m_current_token.type)
+    {
+      case token_type::var: return parse_var_statement();
+      case token_type::ret: return parse_ret_statement();
+      default:              return parse_expression_statement();
+    }
+  }
+
+  node_id flat_parser::parse_var_statement()
+  {
+    auto tok = m_current_token;
+    if(!expect_next(token_type::identifire))
+      return no_node;
+
+    auto name = m_ast.add(node_type::identifire, m_current_token);
+    if(!expect_next(token_type::assign))
+      return no_node;
+
+    next_token();
+    auto value = parse_expression(precedence::lowest);
+
+    if(m_peek_token.type == token_type::semicolon) //optional semicolon
+      next_token();
+
+    return m_ast.add(node_type::var, tok, name, value);
+  }
+
+  node_id flat_parser::parse_ret_statement()
+  {
+    auto tok = m_current_token;
+    next_token();
+    auto value = parse_expression(precedence::lowest);
+
+    if(m_peek_token.type == token_type::semicolon) //optional semicolon
+      next_token();
+
+    return m_ast.add(node_type::ret, tok, value);
+  }
+
+  node_id flat_parser::parse_expression_statement()
+  {
+    auto tok = m_current_token;
+    auto expr = parse_expression(precedence::lowest);
+
+    if(m_peek_token.type == token_type::semicolon)
+      next_token();
+
+    return m_ast.add(node_type::expression_statement, tok, expr);
+  }
+
+  node_id flat_parser::parse_expression(precedence p)
+  {
+    auto prefix = s_prefix_funs[static_cast<size_t>(m_current_token.type)];
+    if(!prefix)
+    {
+      no_prefix_parse_fun_error(m_current_token.type);
+      return no_node;
+    }
+
+    auto left = (this->*prefix)();
+
+    while(m_peek_token.type != token_type::semicolon && (p < parser::get_precedence(m_peek_token.type)))
+    {
+      auto infix = s_infix_funs[static_cast<size_t>(m_peek_token.type)];
+      if(!infix)
+        return left;
+
+      next_token();
+      left = (this->*infix)(left);
+    }
+    return left;
+  }
+
+  node_id flat_parser::parse_identifire()
+  {
+    return m_ast.add(node_type::identifire, m_current_token);
+  }
+
+  node_id flat_parser::parse_integer_literal()
+  {
+    const auto& lit = m_current_token.literal;
+    int64_t value = 0;
+    auto [_, ec] = std::from_chars(lit.data(), lit.data() + lit.size(), value);
+    if(ec != std::errc())
+    {
+      m_errors.emplace_back("could not parse: '" + std::string(lit) + "' as integer.");
+      return no_node;
+    }
+    return m_ast.add(node_type::integer, m_current_token, m_ast.add_integer(value));
+  }
+
+  node_id flat_parser::parse_float_literal()
+  {
+    const auto& lit = m_current_token.literal;
+    double value = 0;
+    auto [_, ec] = std::from_chars(lit.data(), lit.data() + lit.size(), value);
+    if(ec != std::errc())
+    {
+      m_errors.emplace_back("could not parse: '" + std::string(lit) + "' as float.");
+      return no_node;
+    }
+    return m_ast.add(node_type::floating, m_current_token, m_ast.add_integer(std::bit_cast<int64_t>(value)));
+  }
+
+  node_id flat_parser::parse_string_literal()
+  {
+    return m_ast.add(node_type::string, m_current_token);
+  }
+
+  node_id flat_parser::parse_boolean()
+  {
+    return m_ast.add(node_type::boolean, m_current_token);
+  }
+
+  node_id flat_parser::parse_prefix()
+  {
+    auto tok = m_current_token;
+    next_token();
+    auto right = parse_expression(precedence::prefix);
+    return m_ast.add(node_type::prefix, tok, right);
+  }
+
+  node_id flat_parser::parse_infix(node_id left)
+  {
+    auto tok = m_current_token;
+    auto preced = parser::get_precedence(tok.type);
+    next_token();
+    auto right = parse_expression(preced);
+    return m_ast.add(node_type::infix, tok, left, right);
+  }
+
+  node_id flat_parser::parse_grouped()
+  {
+    next_token();
+    auto expr = parse_expression(precedence::lowest);
+    if(!expect_next(token_type::r_paren))
+      return no_node;
+    return expr;
+  }
+
+  node_id flat_parser::parse_block()
+  {
+    auto tok = m_current_token;
+    auto mark = m_scratch.size();
+    next_token();
+    while(m_current_token.type != token_type::r_brace && m_current_token.type != token_type::eof)
+    {
+      auto stmt = parse_statement();
+      if(stmt != no_node)
+        m_scratch.push_back(stmt);
+      next_token();
+    }
+    return m_ast.add(node_type::block, tok, finish_list(mark));
+  }
+
+  node_id flat_parser::parse_if()
+  {
+    auto tok = m_current_token;
+    if(!expect_next(token_type::l_paren))
+      return no_node;
+
+    next_token();
+    auto condition = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_paren))
+      return no_node;
+    if(!expect_next(token_type::l_brace))
+      return no_node;
+
+    auto consequence = parse_block();
+    auto alternative = no_node;
+
+    if(m_peek_token.type == token_type::_else)
+    {
+      next_token();
+      if(!expect_next(token_type::l_brace))
+        return no_node;
+
+      alternative = parse_block();
+    }
+    return m_ast.add(node_type::_if, tok, condition, consequence, alternative);
+  }
+
+  node_id flat_parser::parse_while()
+  {
+    auto tok = m_current_token;
+    if(!expect_next(token_type::l_paren))
+      return no_node;
+
+    next_token();
+    auto condition = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_paren))
+      return no_node;
+    if(!expect_next(token_type::l_brace))
+      return no_node;
+
+    auto body = parse_block();
+    return m_ast.add(node_type::_while, tok, condition, body);
+  }
+
+  node_id flat_parser::parse_for()
+  {
+    auto tok = m_current_token;
+    if(!expect_next(token_type::l_paren))
+      return no_node;
+    if(!expect_next(token_type::identifire))
+      return no_node;
+
+    auto variable = m_ast.add(node_type::identifire, m_current_token);
+    if(!expect_next(token_type::_in))
+      return no_node;
+
+    next_token();
+    auto iterable = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_paren))
+      return no_node;
+    if(!expect_next(token_type::l_brace))
+      return no_node;
+
+    auto body = parse_block();
+    return m_ast.add(node_type::_for, tok, variable, iterable, body);
+  }
+
+  node_id flat_parser::parse_fun_literal()
+  {
+    auto tok = m_current_token;
+    if(!expect_next(token_type::l_paren))
+      return no_node;
+
+    auto params = parse_fun_params();
+    if(!expect_next(token_type::l_brace))
+      return no_node;
+
+    auto body = parse_block();
+    //c is the offset just past the closing brace, the literal's text is tok to there
+    auto end = m_current_token.type == token_type::r_brace ? m_current_token.offset + 1 : tok.offset + tok.literal.size();
+    return m_ast.add(node_type::fun, tok, params, body, static_cast<node_id>(end));
+  }
+
+  node_id flat_parser::parse_import()
+  {
+    if(!expect_next(token_type::string))
+      return no_node;
+    return m_ast.add(node_type::_import, m_current_token);
+  }
+
+  node_id flat_parser::parse_fun_params()
+  {
+    auto mark = m_scratch.size();
+    if(m_peek_token.type == token_type::r_paren) //no params
+    {
+      next_token();
+      return finish_list(mark);
+    }
+
+    next_token();
+    m_scratch.push_back(m_ast.add(node_type::identifire, m_current_token));
+
+    while(m_peek_token.type == token_type::comma)
+    {
+      next_token();
+      next_token();
+      m_scratch.push_back(m_ast.add(node_type::identifire, m_current_token));
+    }
+
+    if(!expect_next(token_type::r_paren))
+      m_scratch.resize(mark);
+
+    return finish_list(mark);
+  }
+
+  node_id flat_parser::parse_call(node_id left)
+  {
+    auto tok = m_current_token;
+    auto args = parse_expression_list(token_type::r_paren);
+    return m_ast.add(node_type::call, tok, left, args);
+  }
+
+  node_id flat_parser::parse_array_literal()
+  {
+    auto tok = m_current_token;
+    auto elements = parse_expression_list(token_type::r_bracket);
+    return m_ast.add(node_type::array, tok, elements);
+  }
+
+  node_id flat_parser::parse_expression_list(token_type expect_end)
+  {
+    auto mark = m_scratch.size();
+    if(m_peek_token.type == expect_end)
+    {
+      next_token();
+      return finish_list(mark);
+    }
+
+    next_token();
+    m_scratch.push_back(parse_expression(precedence::lowest));
+
+    while(m_peek_token.type == token_type::comma)
+    {
+      next_token();
+      next_token();
+      m_scratch.push_back(parse_expression(precedence::lowest));
+    }
+
+    if(!expect_next(expect_end))
+      m_scratch.resize(mark);
+
+    return finish_list(mark);
+  }
+
+  node_id flat_parser::parse_index(node_id left)
+  {
+    auto tok = m_current_token;
+    next_token();
+    auto right = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_bracket))
+      return no_node;
+
+    return m_ast.add(node_type::index, tok, left, right);
+  }
+
+  node_id flat_parser::parse_map_literal()
+  {
+    auto tok = m_current_token;
+    auto mark = m_scratch.size();
+
+    while(m_peek_token.type != token_type::r_brace)
+    {
+      next_token();
+      auto key = parse_expression(precedence::lowest);
+
+      if(!expect_next(token_type::colon))
+      {
+        m_scratch.resize(mark);
+        return no_node;
+      }
+
+      next_token();
+      auto value = parse_expression(precedence::lowest);
+      m_scratch.push_back(key);
+      m_scratch.push_back(value);
+
+      if(m_peek_token.type != token_type::r_brace && !expect_next(token_type::comma))
+      {
+        m_scratch.resize(mark);
+        return no_node;
+      }
+    }
+
+    if(!expect_next(token_type::r_brace))
+    {
+      m_scratch.resize(mark);
+      return no_node;
+    }
+
+    return m_ast.add(node_type::map, tok, finish_list(mark));
+  }
+
+  node_id flat_parser::finish_list(size_t mark)
+  {
+    auto at = m_ast.add_list({ m_scratch.data() + mark, m_scratch.size() - mark });
+    m_scratch.resize(mark);
+    return at;
+  }
+
+  void flat_parser::peek_error(token_type tok)
+  {
+    m_errors.emplace_back("expected next token to be: '" + std::string(token_type_to_string(tok)) + "' got: '" + std::string(token_type_to_string(m_peek_token.type)) + "'." );
+  }
+
+  void flat_parser::no_prefix_parse_fun_error(token_type tok)
+  {
+    m_errors.emplace_back("no prefix parse function found for: '" + std::string(token_type_to_string(tok)) + "'.");
+  }
+}
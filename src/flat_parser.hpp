@@ -0,0 +1,81 @@
+#pragma once
+
+#include "flat_ast.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "token.hpp"
+
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace my_ns
+{
+  //same grammar and errors as parser, builds a flat::ast. prefix and infix handlers are
+  //looked up in arrays indexed by the token type, filled at compile time
+  class flat_parser
+  {
+  public:
+    using errors = parser::errors;
+    using precedence = parser::precedence;
+    using prefix_parse_fun = flat::node_id (flat_parser::*)();
+    using infix_parse_fun = flat::node_id (flat_parser::*)(flat::node_id left);
+  public:
+    flat_parser(lexer* l, std::string_view source);
+    flat::ast parse_program();
+    inline const errors& get_errors() const
+    {
+      return m_errors;
+    }
+  private:
+    void next_token();
+    bool expect_next(token_type tok);
+
+    flat::node_id parse_statement();
+    flat::node_id parse_var_statement();
+    flat::node_id parse_ret_statement();
+    flat::node_id parse_expression_statement();
+
+    flat::node_id parse_expression(precedence p);
+    flat::node_id parse_identifire();
+    flat::node_id parse_integer_literal();
+    flat::node_id parse_float_literal();
+    flat::node_id parse_string_literal();
+    flat::node_id parse_boolean();
+    flat::node_id parse_prefix();
+    flat::node_id parse_infix(flat::node_id left);
+    flat::node_id parse_grouped();
+    flat::node_id parse_block();
+    flat::node_id parse_if();
+    flat::node_id parse_while();
+    flat::node_id parse_for();
+    flat::node_id parse_fun_literal();
+    flat::node_id parse_import();
+    flat::node_id parse_call(flat::node_id left);
+    flat::node_id parse_array_literal();
+    flat::node_id parse_index(flat::node_id left);
+    flat::node_id parse_map_literal();
+
+    //lists collect in m_scratch so nested lists don't allocate, they return the list index
+    //and come back empty on a syntax error like the tree parser's
+    flat::node_id parse_fun_params();
+    flat::node_id parse_expression_list(token_type expect_end);
+    flat::node_id finish_list(size_t mark);
+
+    void peek_error(token_type tok);
+    void no_prefix_parse_fun_error(token_type tok);
+  private:
+    static constexpr std::array<prefix_parse_fun, token_type_count> make_prefix_table();
+    static constexpr std::array<infix_parse_fun, token_type_count> make_infix_table();
+    static const std::array<prefix_parse_fun, token_type_count> s_prefix_funs;
+    static const std::array<infix_parse_fun, token_type_count> s_infix_funs;
+  private:
+    lexer* m_lexer;
+    token m_current_token;
+    token m_peek_token;
+    flat::ast m_ast;
+    std::vector<flat::node_id> m_scratch;
+    errors m_errors;
+  };
+}
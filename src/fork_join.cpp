@@ -0,0 +1,225 @@
+#include "fork_join.hpp"
+
+#include <algorithm>
+
+namespace my_ns
+{
+  namespace
+  {
+    //the pool and deque the current thread works from, threads that aren't workers have none
+    thread_local const fork_join_pool* t_pool = nullptr;
+    thread_local size_t t_index = 0;
+    thread_local size_t t_depth = 0;
+  }
+
+  fork_join_pool::fork_join_pool(size_t threads)
+  {
+    start(threads);
+  }
+
+  fork_join_pool::~fork_join_pool()
+  {
+    stop();
+  }
+
+  void fork_join_pool::invoke(const std::function<void()>& a, const std::function<void()>& b)
+  {
+    if(size() == 1)
+    {
+      a();
+      b();
+      return;
+    }
+
+    s_running.fetch_add(1, std::memory_order_acq_rel);
+    task forked{ .work = &b, .depth = t_depth + 1 };
+    push(forked);
+
+    std::exception_ptr error;
+    auto saved = t_depth;
+    t_depth = forked.depth;
+    try
+    {
+      a();
+    }
+    catch(...)
+    {
+      error = std::current_exception();
+    }
+    t_depth = saved;
+
+    if(take(forked))
+      run(forked);
+    while(!forked.done.load(std::memory_order_acquire))
+    {
+      if(auto* other = find(forked.depth))
+        run(*other);
+      else
+        std::this_thread::yield();
+    }
+    s_running.fetch_sub(1, std::memory_order_acq_rel);
+
+    if(error)
+      std::rethrow_exception(error);
+    if(forked.error)
+      std::rethrow_exception(forked.error);
+  }
+
+  void fork_join_pool::for_range(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body)
+  {
+    grain = std::max<size_t>(grain, 1);
+    if(end - begin <= grain || size() == 1)
+    {
+      for(auto at = begin; at < end; at += grain)
+        body(at, std::min(at + grain, end));
+      return;
+    }
+    auto mid = begin + (end - begin) / 2;
+    invoke([&] { for_range(begin, mid, grain, body); }, [&] { for_range(mid, end, grain, body); });
+  }
+
+  void fork_join_pool::resize(size_t threads)
+  {
+    if(std::max<size_t>(threads, 1) == size())
+      return;
+    stop();
+    start(threads);
+  }
+
+  size_t fork_join_pool::depth()
+  {
+    return t_depth;
+  }
+
+  void fork_join_pool::start(size_t threads)
+  {
+    threads = std::max<size_t>(threads, 1);
+    m_queues.clear();
+    for(size_t i = 0; i < threads; ++i)
+      m_queues.push_back(std::make_unique<queue>());
+    for(size_t i = 1; i < threads; ++i)
+      m_workers.emplace_back([this, i](std::stop_token stop) { work(i, stop); });
+  }
+
+  void fork_join_pool::stop()
+  {
+    for(auto& worker : m_workers)
+      worker.request_stop();
+    {
+      std::lock_guard lock(m_sleep_mutex);
+    }
+    m_wake.notify_all();
+    m_workers.clear();
+  }
+
+  void fork_join_pool::work(size_t index, std::stop_token stop)
+  {
+    t_pool = this;
+    t_index = index;
+    while(!stop.stop_requested())
+    {
+      if(auto* t = find(0))
+      {
+        run(*t);
+        continue;
+      }
+      std::unique_lock lock(m_sleep_mutex);
+      m_wake.wait(lock, stop, [this] { return m_queued.load(std::memory_order_acquire) != 0; });
+    }
+  }
+
+  fork_join_pool::queue& fork_join_pool::own_queue()
+  {
+    return t_pool == this ? *m_queues[t_index] : *m_queues[0];
+  }
+
+  void fork_join_pool::push(task& t)
+  {
+    auto& own = own_queue();
+    {
+      std::lock_guard lock(own.mutex);
+      own.tasks.push_back(&t);
+    }
+    m_queued.fetch_add(1, std::memory_order_acq_rel);
+    //through the mutex, a worker between its check and its wait would miss the notify
+    {
+      std::lock_guard lock(m_sleep_mutex);
+    }
+    m_wake.notify_one();
+  }
+
+  bool fork_join_pool::take(task& t)
+  {
+    auto& own = own_queue();
+    std::lock_guard lock(own.mutex);
+    //the shared deque gets pushes from several threads, it's not always the last one
+    auto it = std::find(own.tasks.rbegin(), own.tasks.rend(), &t);
+    if(it == own.tasks.rend())
+      return false;
+    own.tasks.erase(std::next(it).base());
+    m_queued.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+  }
+
+  fork_join_pool::task* fork_join_pool::find(size_t min_depth)
+  {
+    if(m_queued.load(std::memory_order_acquire) == 0)
+      return nullptr;
+
+    auto& own = own_queue();
+    {
+      std::lock_guard lock(own.mutex);
+      if(!own.tasks.empty() && own.tasks.back()->depth > min_depth)
+      {
+        auto* t = own.tasks.back();
+        own.tasks.pop_back();
+        m_queued.fetch_sub(1, std::memory_order_acq_rel);
+        return t;
+      }
+    }
+
+    auto start = t_pool == this ? t_index : 0;
+    for(size_t i = 1; i < m_queues.size(); ++i)
+    {
+      auto& victim = *m_queues[(start + i) % m_queues.size()];
+      std::lock_guard lock(victim.mutex);
+      auto it = std::find_if(victim.tasks.begin(), victim.tasks.end(), [&](const task* t) { return t->depth > min_depth; });
+      if(it == victim.tasks.end())
+        continue;
+      auto* t = *it;
+      victim.tasks.erase(it);
+      m_queued.fetch_sub(1, std::memory_order_acq_rel);
+      return t;
+    }
+    return nullptr;
+  }
+
+  void fork_join_pool::run(task& t)
+  {
+    auto saved = t_depth;
+    t_depth = t.depth;
+    try
+    {
+      (*t.work)();
+    }
+    catch(...)
+    {
+      t.error = std::current_exception();
+    }
+    t_depth = saved;
+    //the thread waiting may drop the task as soon as it sees this
+    t.done.store(true, std::memory_order_release);
+  }
+
+  std::mutex& lazy_lock(const void* owner)
+  {
+    static std::array<std::mutex, 64> s_locks;
+    return s_locks[(reinterpret_cast<uintptr_t>(owner) >> 4) % s_locks.size()];
+  }
+
+  fork_join_pool& get_fork_join_pool()
+  {
+    static fork_join_pool s_pool;
+    return s_pool;
+  }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <bit>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stop_token>
+#include <thread>
+#include <vector>
+
+namespace my_ns
+{
+  //fork-join over a fixed set of workers, each with its own deque of tasks. a thread pushes and
+  //pops the tasks it forks at the back, a worker with nothing to do steals from the front of
+  //another's. a join runs the task itself if nobody took it, otherwise it runs tasks forked deeper
+  //than the one it waits for, so no thread blocks and a stack only grows by the fork depth.
+  //threads that aren't workers share one deque. with one thread everything runs in place
+  class fork_join_pool
+  {
+  public:
+    explicit fork_join_pool(size_t threads = std::thread::hardware_concurrency());
+
+    fork_join_pool(const fork_join_pool&) = delete;
+    fork_join_pool& operator = (const fork_join_pool&) = delete;
+
+    ~fork_join_pool();
+
+    //runs both and returns once they are done, b may run on another thread. an exception from
+    //either comes out here, a's first
+    void invoke(const std::function<void()>& a, const std::function<void()>& b);
+
+    //body over [begin, end) in pieces of at most grain, halved each time so a thief takes big ones
+    void for_range(size_t begin, size_t end, size_t grain, const std::function<void(size_t, size_t)>& body);
+
+    //the threads work is spread over, the one forking included
+    inline size_t size() const
+    {
+      return m_workers.size() + 1;
+    }
+
+    //whether a fork here pays for itself. a few levels past one task per thread there are
+    //enough to steal, forking deeper only costs
+    inline bool worth_forking() const
+    {
+      return size() > 1 && depth() < static_cast<size_t>(std::bit_width(size())) + 3;
+    }
+
+    //stops the workers and starts threads - 1 new ones, only while nothing is running
+    void resize(size_t threads);
+
+    //how many forks the running code is under, 0 outside of any
+    static size_t depth();
+
+    //whether any fork is still running, in any pool
+    static inline bool running()
+    {
+      return s_running.load(std::memory_order_acquire) != 0;
+    }
+  private:
+    struct task
+    {
+      const std::function<void()>* work;
+      size_t depth;
+      std::atomic<bool> done = false;
+      std::exception_ptr error = nullptr;
+    };
+
+    struct queue
+    {
+      std::mutex mutex;
+      std::deque<task*> tasks;
+    };
+  private:
+    void start(size_t threads);
+    void stop();
+    void work(size_t index, std::stop_token stop);
+    queue& own_queue();
+    void push(task& t);
+    //takes t back if it's still queued
+    bool take(task& t);
+    //a task deeper than min_depth from the own deque's back or another's front
+    task* find(size_t min_depth);
+    void run(task& t);
+  private:
+    std::vector<std::unique_ptr<queue>> m_queues; //0 is for threads that aren't workers
+    std::atomic<size_t> m_queued = 0;
+    std::mutex m_sleep_mutex;
+    std::condition_variable_any m_wake;
+    std::vector<std::jthread> m_workers; //last, so the workers stop before the deques go away
+    static inline std::atomic<size_t> s_running = 0;
+  };
+
+  //lazy state on a value, a rope's flat text or a hash, is filled under the lock for its address
+  std::mutex& lazy_lock(const void* owner);
+
+  //whether a fork is running. the caches the interpreter keeps on the tree are only written while
+  //none is, inside one a miss is looked up again and not kept
+  inline bool in_parallel()
+  {
+    return fork_join_pool::running();
+  }
+
+  //the pool the evaluator forks on, as many threads as the machine has until told otherwise
+  fork_join_pool& get_fork_join_pool();
+}
@@ -0,0 +1,225 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace my_ns
+{
+  //a hash map that is a value. a copy shares every node with the original and an insert copies
+  //only the ones on the path to its key, so keeping both costs log32 of the size. each level
+  //takes five bits of the hash, a bitmap tells which of its 32 slots are used and only those are
+  //stored. keys whose whole hash is the same share one node past the last level, searched in
+  //order. a node no other trie holds is changed in place, building one up copies nothing
+  template <typename K, typename V, typename Hash = std::hash<K>>
+  class hash_trie
+  {
+  public:
+    using value_type = std::pair<K, V>;
+  private:
+    struct node;
+
+    struct slot
+    {
+      value_type entry;
+      std::shared_ptr<node> child = nullptr; //a deeper level instead of an entry
+    };
+
+    struct node
+    {
+      uint32_t bitmap = 0;
+      std::vector<slot> slots;
+    };
+
+    static constexpr size_t s_bits = 5;
+    static constexpr size_t s_levels = (64 + s_bits - 1) / s_bits;
+  public:
+    class const_iterator
+    {
+    public:
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = hash_trie::value_type;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const value_type*;
+      using reference = const value_type&;
+    public:
+      const_iterator() = default;
+
+      inline reference operator * () const
+      {
+        return current().entry;
+      }
+
+      inline pointer operator -> () const
+      {
+        return &current().entry;
+      }
+
+      const_iterator& operator ++ ()
+      {
+        while(!m_path.empty() && ++m_path.back().second == m_path.back().first->slots.size())
+          m_path.pop_back();
+        descend();
+        return *this;
+      }
+
+      const_iterator operator ++ (int)
+      {
+        auto copy = *this;
+        ++*this;
+        return copy;
+      }
+
+      inline bool operator == (const const_iterator& other) const
+      {
+        return m_path == other.m_path;
+      }
+    private:
+      friend class hash_trie;
+
+      explicit const_iterator(const node* root)
+      {
+        if(root && !root->slots.empty())
+        {
+          m_path.emplace_back(root, 0);
+          descend();
+        }
+      }
+
+      inline const slot& current() const
+      {
+        return m_path.back().first->slots[m_path.back().second];
+      }
+
+      //down to the first entry under the slot it's on, nodes below the root are never empty
+      void descend()
+      {
+        while(!m_path.empty() && current().child)
+          m_path.emplace_back(current().child.get(), 0);
+      }
+    private:
+      std::vector<std::pair<const node*, size_t>> m_path; //empty at the end
+    };
+  public:
+    inline size_t size() const
+    {
+      return m_size;
+    }
+
+    inline bool empty() const
+    {
+      return m_size == 0;
+    }
+
+    const V* find(const K& key) const
+    {
+      auto h = hash_of(key);
+      const node* n = m_root.get();
+      for(size_t level = 0; n; ++level)
+      {
+        if(level == s_levels)
+        {
+          for(const auto& s : n->slots)
+            if(s.entry.first == key)
+              return &s.entry.second;
+          return nullptr;
+        }
+        auto bit = bit_at(h, level);
+        if(!(n->bitmap & bit))
+          return nullptr;
+        const auto& s = n->slots[std::popcount(n->bitmap & (bit - 1))];
+        if(!s.child)
+          return s.entry.first == key ? &s.entry.second : nullptr;
+        n = s.child.get();
+      }
+      return nullptr;
+    }
+
+    inline bool contains(const K& key) const
+    {
+      return find(key) != nullptr;
+    }
+
+    //false and nothing changes when the key is already there
+    bool try_emplace(const K& key, V value)
+    {
+      if(contains(key))
+        return false;
+      if(!m_root)
+        m_root = std::make_shared<node>();
+      else if(m_root.use_count() > 1)
+        m_root = std::make_shared<node>(*m_root);
+      insert_into(*m_root, 0, hash_of(key), value_type(key, std::move(value)));
+      ++m_size;
+      return true;
+    }
+
+    inline bool insert(const value_type& entry)
+    {
+      return try_emplace(entry.first, entry.second);
+    }
+
+    inline const_iterator begin() const
+    {
+      return const_iterator(m_root.get());
+    }
+
+    inline const_iterator end() const
+    {
+      return const_iterator();
+    }
+  private:
+    static inline size_t hash_of(const K& key)
+    {
+      return utils::hash_mix(Hash{}(key));
+    }
+
+    static inline uint32_t bit_at(size_t h, size_t level)
+    {
+      return 1u << ((h >> (level * s_bits)) & 31);
+    }
+
+    //n is owned by this trie alone, the children it goes down through are copied first if not
+    static void insert_into(node& n, size_t level, size_t h, value_type&& entry)
+    {
+      if(level == s_levels)
+      {
+        n.slots.push_back({ std::move(entry) });
+        return;
+      }
+
+      auto bit = bit_at(h, level);
+      auto at = std::popcount(n.bitmap & (bit - 1));
+      if(!(n.bitmap & bit))
+      {
+        n.bitmap |= bit;
+        n.slots.insert(n.slots.begin() + at, slot{ std::move(entry) });
+        return;
+      }
+
+      auto& s = n.slots[at];
+      if(!s.child)
+      {
+        //the entry there moves a level down to make room
+        auto child = std::make_shared<node>();
+        auto moved_hash = hash_of(s.entry.first);
+        insert_into(*child, level + 1, moved_hash, std::move(s.entry));
+        s.entry = {};
+        s.child = std::move(child);
+      }
+      else if(s.child.use_count() > 1)
+        s.child = std::make_shared<node>(*s.child);
+      insert_into(*s.child, level + 1, h, std::move(entry));
+    }
+  private:
+    std::shared_ptr<node> m_root = nullptr;
+    size_t m_size = 0;
+  };
+}
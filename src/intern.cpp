@@ -0,0 +1,67 @@
+#include "intern.hpp"
+
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+
+namespace my_ns
+{
+  namespace
+  {
+    struct view_hash
+    {
+      size_t operator()(std::string_view str) const
+      {
+        return utils::fast_hash(str);
+      }
+    };
+
+    //entries are never freed, symbols hold raw pointers into them
+    std::unordered_map<std::string_view, std::unique_ptr<symbol::entry>, view_hash>& get_table()
+    {
+      static std::unordered_map<std::string_view, std::unique_ptr<symbol::entry>, view_hash> s_table;
+      return s_table;
+    }
+
+    //modules are parsed on several threads, most names are already in the table so
+    //lookups share the lock and only a new string takes it alone
+    std::shared_mutex& get_table_mutex()
+    {
+      static std::shared_mutex s_mutex;
+      return s_mutex;
+    }
+  }
+
+  symbol intern(std::string_view str)
+  {
+    auto& table = get_table();
+    {
+      std::shared_lock lock(get_table_mutex());
+      auto it = table.find(str);
+      if(it != table.end())
+        return symbol(it->second.get());
+    }
+
+    std::unique_lock lock(get_table_mutex());
+    auto it = table.find(str); //another thread may have added it in between
+    if(it != table.end())
+      return symbol(it->second.get());
+
+    auto e = std::make_unique<symbol::entry>();
+    e->value = std::make_shared<const std::string>(str);
+    e->hash = utils::fast_hash(str);
+    std::string_view key = *e->value; //key views the entry's own buffer
+    auto [ins, _] = table.emplace(key, std::move(e));
+    return symbol(ins->second.get());
+  }
+
+  std::optional<symbol> find_interned(std::string_view str)
+  {
+    auto& table = get_table();
+    std::shared_lock lock(get_table_mutex());
+    auto it = table.find(str);
+    if(it == table.end())
+      return std::nullopt;
+    return symbol(it->second.get());
+  }
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "utils.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace my_ns
+{
+  //an interned string, equal text means equal pointer so compare and hash are O(1)
+  class symbol
+  {
+  public:
+    struct entry
+    {
+      std::shared_ptr<const std::string> value;
+      utils::hash_type hash;
+      mutable std::atomic<uint8_t> flags = 0;
+    };
+
+    enum flag : uint8_t
+    {
+      builtin = 1, //names a builtin function
+      shadowed = 2, //a builtin's name some environment has bound, it stays set
+      local = 4, //bound in a scope below the top level, it stays set
+    };
+  public:
+    symbol() = default;
+    explicit symbol(const entry* e)
+      : m_entry(e)
+    {
+    }
+
+    inline const std::string& str() const
+    {
+      static const std::string empty;
+      return m_entry ? *m_entry->value : empty;
+    }
+
+    //shared with every runtime string made from this symbol
+    inline const std::shared_ptr<const std::string>& buffer() const
+    {
+      static const std::shared_ptr<const std::string> empty = std::make_shared<const std::string>();
+      return m_entry ? m_entry->value : empty;
+    }
+
+    inline utils::hash_type hash() const
+    {
+      return m_entry ? m_entry->hash : 0;
+    }
+
+    inline bool empty() const
+    {
+      return m_entry == nullptr;
+    }
+
+    inline bool is_builtin() const
+    {
+      return m_entry && (m_entry->flags.load(std::memory_order_relaxed) & flag::builtin);
+    }
+    inline bool is_shadowed() const
+    {
+      return m_entry && (m_entry->flags.load(std::memory_order_relaxed) & flag::shadowed);
+    }
+    inline bool is_local() const
+    {
+      return m_entry && (m_entry->flags.load(std::memory_order_relaxed) & flag::local);
+    }
+    inline void mark_builtin() const
+    {
+      m_entry->flags.fetch_or(flag::builtin, std::memory_order_relaxed);
+    }
+    inline void mark_shadowed() const
+    {
+      m_entry->flags.fetch_or(flag::shadowed, std::memory_order_relaxed);
+    }
+    inline void mark_local() const
+    {
+      m_entry->flags.fetch_or(flag::local, std::memory_order_relaxed);
+    }
+
+    bool operator == (const symbol& other) const
+    {
+      return m_entry == other.m_entry;
+    }
+  private:
+    const entry* m_entry = nullptr;
+  };
+
+  symbol intern(std::string_view str);
+  //lookup without inserting, a string that was never interned can't be bound anywhere
+  std::optional<symbol> find_interned(std::string_view str);
+}
+
+namespace std
+{
+  template <>
+  struct hash<my_ns::symbol>
+  {
+    size_t operator()(const my_ns::symbol& s) const
+    {
+      return s.hash();
+    }
+  };
+}
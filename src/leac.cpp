@@ -0,0 +1,114 @@
+#include "leac.hpp"
+#include "mapped_file.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+#endif
+
+namespace my_ns::leac
+{
+  namespace
+  {
+    constexpr char s_magic[4] = { 'L', 'E', 'A', 'C' };
+
+    struct header
+    {
+      char magic[4];
+      uint32_t version;
+      uint64_t source_hash;
+      uint64_t source_size;
+      uint64_t payload_hash;
+      uint64_t payload_size;
+    };
+
+    uint64_t process_id()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      return static_cast<uint64_t>(::getpid());
+#else
+      return 0;
+#endif
+    }
+  }
+
+  std::filesystem::path cache_path(const std::filesystem::path& script)
+  {
+    auto path = script;
+    path += "c";
+    return path;
+  }
+
+  utils::hash_type hash_source(std::string_view source)
+  {
+    return utils::fast_hash(source);
+  }
+
+  bool save(const std::filesystem::path& path, const flat::ast& flat, std::string_view source)
+  {
+    std::string payload;
+    flat.serialize(payload);
+
+    header head;
+    std::memcpy(head.magic, s_magic, sizeof(s_magic));
+    head.version = format_version;
+    head.source_hash = hash_source(source);
+    head.source_size = source.size();
+    head.payload_hash = utils::fast_hash(payload);
+    head.payload_size = payload.size();
+
+    //a reader never sees a half written cache, rename replaces it in one step
+    auto tmp = path;
+    tmp += ".tmp" + std::to_string(process_id());
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      if(!out)
+        return false;
+      out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+      out.write(payload.data(), static_cast<std::streamsize>(payload.size()));
+      if(!out.flush())
+      {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return false;
+      }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if(ec)
+    {
+      std::filesystem::remove(tmp, ec);
+      return false;
+    }
+    return true;
+  }
+
+  std::optional<flat::ast> load(const std::filesystem::path& path, std::string_view source)
+  {
+    auto file = mapped_file::open(path);
+    if(!file.has_value())
+      return std::nullopt;
+
+    auto bytes = file->view();
+    header head;
+    if(bytes.size() < sizeof(head))
+      return std::nullopt;
+    std::memcpy(&head, bytes.data(), sizeof(head));
+    bytes.remove_prefix(sizeof(head));
+
+    if(std::memcmp(head.magic, s_magic, sizeof(s_magic)) != 0 || head.version != format_version)
+      return std::nullopt;
+    if(head.source_size != source.size() || head.payload_size != bytes.size())
+      return std::nullopt;
+    if(head.source_hash != hash_source(source) || head.payload_hash != utils::fast_hash(bytes))
+      return std::nullopt;
+
+    return flat::ast::deserialize(bytes, source);
+  }
+}
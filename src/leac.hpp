@@ -0,0 +1,28 @@
+#pragma once
+
+#include "flat_ast.hpp"
+#include "utils.hpp"
+
+#include <cstdint>
+#include <filesystem>
+#include <optional>
+#include <string_view>
+
+//.leac files cache the parsed program next to its script. the header keys it to the
+//exact source, the payload is flat::ast's pools and carries its own hash
+
+namespace my_ns::leac
+{
+  constexpr uint32_t format_version = 4;
+
+  //foo.lea caches to foo.leac
+  std::filesystem::path cache_path(const std::filesystem::path& script);
+
+  utils::hash_type hash_source(std::string_view source);
+
+  //written to a temp file then renamed over the old cache, false if it couldn't be written
+  bool save(const std::filesystem::path& path, const flat::ast& flat, std::string_view source);
+
+  //nullopt for a missing, stale or damaged cache, the caller parses instead
+  std::optional<flat::ast> load(const std::filesystem::path& path, std::string_view source);
+}
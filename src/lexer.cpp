@@ -1,12 +1,10 @@
 #include "lexer.hpp"
+#include "simd.hpp"
 #include "token.hpp"
 
 namespace my_ns
 {
-  constexpr static bool is_literal(char ch);
-  constexpr static bool is_digit(char ch);
-
-  lexer::lexer(const std::string& input)
+  lexer::lexer(std::string_view input)
     : m_input(input)
   {
     read_char(); //set to valid state
@@ -20,60 +18,59 @@ namespace my_ns
     {
       case ';':
       {
-        tok = { token_type::semicolon, m_current_char };
+        tok = make_token(token_type::semicolon);
         break;
       }
       case ':':
       {
-        tok = { token_type::colon, m_current_char };
+        tok = make_token(token_type::colon);
         break;
       }
       case ',':
       {
-        tok = { token_type::comma, m_current_char };
+        tok = make_token(token_type::comma);
         break;
       }
       case '(':
       {
-        tok = { token_type::l_paren, m_current_char };
+        tok = make_token(token_type::l_paren);
         break;
       }
       case ')':
       {
-        tok = { token_type::r_paren, m_current_char };
+        tok = make_token(token_type::r_paren);
         break;
       }
       case '{':
       {
-        tok = { token_type::l_brace, m_current_char };
+        tok = make_token(token_type::l_brace);
         break;
       }
       case '}':
       {
-        tok = { token_type::r_brace, m_current_char };
+        tok = make_token(token_type::r_brace);
         break;
       }
       case '[':
       {
-        tok = { token_type::l_bracket, m_current_char };
+        tok = make_token(token_type::l_bracket);
         break;
       }
       case ']':
       {
-        tok = { token_type::r_bracket, m_current_char };
+        tok = make_token(token_type::r_bracket);
         break;
       }
       case '=':
       {
         if(peek_char() == '=')
         {
-          auto ch = m_current_char;
+          tok = make_token(token_type::equal, 2);
           read_char();
-          tok = { token_type::equal, std::string{ch} + std::string{m_current_char} }; //FIXME: stupid std::string!
         }
         else
         {
-          tok = { token_type::assign, m_current_char };
+          tok = make_token(token_type::assign);
         }
         break;
       }
@@ -81,81 +78,83 @@ namespace my_ns
       {
         if(peek_char() == '=')
         {
-          auto ch = m_current_char;
+          tok = make_token(token_type::not_equal, 2);
           read_char();
-          tok = { token_type::not_equal, std::string{ch} + std::string{m_current_char} }; //FIXME: stupid std::string!
         }
         else
         {
-          tok = { token_type::bang, m_current_char };
+          tok = make_token(token_type::bang);
         }
         break;
       }
       case '+':
       {
-        tok = { token_type::plus, m_current_char };
+        tok = make_token(token_type::plus);
         break;
       }
       case '-':
       {
-        tok = { token_type::minus, m_current_char };
+        tok = make_token(token_type::minus);
         break;
       }
       case '*':
       {
-        tok = { token_type::astrisk, m_current_char };
+        tok = make_token(token_type::astrisk);
         break;
       }
       case '/':
       {
-        tok = { token_type::slash, m_current_char };
+        tok = make_token(token_type::slash);
         break;
       }
       case '<':
       {
-        tok = { token_type::less, m_current_char };
+        tok = make_token(token_type::less);
         break;
       }
       case '>':
       {
-        tok = { token_type::greater, m_current_char };
+        tok = make_token(token_type::greater);
         break;
       }
       case '\'':
       {
-        tok.type = token_type::string ;
+        tok.type = token_type::string;
+        tok.offset = m_current_position;
         tok.literal = read_string('\'');
         break;
       }
       case '"':
       {
-        tok.type = token_type::string ;
+        tok.type = token_type::string;
+        tok.offset = m_current_position;
         tok.literal = read_string('"');
         break;
       }
       case 0:
       {
-        tok = { token_type::eof, "" };
+        tok = { token_type::eof, "", m_input.size() };
         break;
       }
       default:
       {
-        if(is_literal(m_current_char))
+        tok.offset = m_current_position;
+        if(simd::is_ident_start(m_current_char))
         {
           tok.literal = read_identifier();
           tok.type = lookup_identifier(tok.literal);
           //return here because read_identifire calls read_char multiple times
           return tok;
         }
-        else if(is_digit(m_current_char))
+        else if(simd::is_digit(m_current_char))
         {
           tok.literal = read_number();
-          tok.type = token_type::integer;
+          tok.type = tok.literal.find('.') == std::string_view::npos ? token_type::integer : token_type::floating;
           return tok;
         }
         else
         {
-          tok = { token_type::illegal, m_current_char };
+          tok = make_token(token_type::illegal);
         }
         break;
       }
@@ -165,6 +164,47 @@ namespace my_ns
     return tok;
   }
 
+  bool lexer::skip_to_closing_brace(size_t from)
+  {
+    size_t depth = 1;
+    for(auto pos = simd::find_any_of(m_input, from, '{', '}', '"', '\'');
+        pos != simd::npos;
+        pos = simd::find_any_of(m_input, pos + 1, '{', '}', '"', '\''))
+    {
+      switch(m_input[pos])
+      {
+        case '{':
+          ++depth;
+          break;
+        case '}':
+          if(--depth == 0)
+          {
+            seek(pos);
+            return true;
+          }
+          break;
+        case '"':
+        case '\'':
+        {
+          pos = simd::find_byte(m_input, m_input[pos], pos + 1);
+          if(pos == simd::npos)
+          {
+            seek(m_input.size());
+            return false;
+          }
+          break;
+        }
+      }
+    }
+    seek(m_input.size());
+    return false;
+  }
+
+  token lexer::make_token(token_type type, size_t len)
+  {
+    return { type, m_input.substr(m_current_position, len), m_current_position };
+  }
+
   void lexer::read_char()
   {
     if(m_read_position >= m_input.size())
@@ -182,56 +222,42 @@ namespace my_ns
     return m_input[m_read_position];
   }
 
-  std::string lexer::read_identifier()
+  //jump to pos, same state read_char would leave after walking there
+  void lexer::seek(size_t pos)
+  {
+    m_read_position = pos;
+    read_char();
+  }
+
+  std::string_view lexer::read_identifier()
   {
     auto pos = m_current_position;
-    while(is_literal(m_current_char) || is_digit(m_current_char))
-    {
-      read_char();
-    }
+    seek(simd::scan_identifier(m_input, pos));
     return m_input.substr(pos, m_current_position - pos);
   }
 
-  std::string lexer::read_number()
+  std::string_view lexer::read_number()
   {
     auto pos = m_current_position;
-    while(is_digit(m_current_char))
-    {
-      read_char();
-    }
+    seek(simd::scan_digits(m_input, pos));
+    //a fraction needs a digit after the point
+    if(m_current_char == '.' && simd::is_digit(peek_char()))
+      seek(simd::scan_digits(m_input, m_read_position));
     return m_input.substr(pos, m_current_position - pos);
   }
 
-  std::string lexer::read_string(char start)
+  std::string_view lexer::read_string(char start)
   {
     auto pos = m_current_position + 1;
-    while(true)
-    {
-      read_char();
-      //TODO: escape seq and error if not closed
-      if(m_current_char == start)
-        break;
-      else if(m_current_char == 0)
-        break; //error 
-    }
+    //TODO: escape seq and error if not closed
+    auto end = simd::find_byte(m_input, start, pos);
+    seek(end == simd::npos ? m_input.size() : end);
     return m_input.substr(pos, m_current_position - pos);
   }
 
   void lexer::consume_whitespace()
   {
-    while(std::isspace(m_current_char))
-    {
-      read_char();
-    }
-  }
-
-  constexpr static bool is_literal(char ch)
-  {
-    return std::isalpha(ch) || ch == '_';
-  }
-
-  constexpr static bool is_digit(char ch)
-  {
-    return std::isdigit(ch);
+    if(simd::is_space(m_current_char))
+      seek(simd::skip_whitespace(m_input, m_current_position));
   }
 }
@@ -1,29 +1,42 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include "token.hpp"
 
 //TODO: unicode support
 
 namespace my_ns
 {
+  //lexes a view of the source in place, tokens point back into it
   class lexer
   {
   public:
-    lexer(const std::string& input);
+    lexer(std::string_view input);
+    lexer(std::string&&) = delete; //the tokens would dangle
 
     token next_token();
+    //the last token read ran into the end of the input, it may be cut short
+    inline bool at_end() const
+    {
+      return m_current_position >= m_input.size();
+    }
+    //skip to the '}' closing a block already open at from, the next token is that '}'.
+    //only braces and quotes are looked at, false at the end of the input
+    bool skip_to_closing_brace(size_t from);
   private:
     void read_char();
+    void seek(size_t pos);
     char peek_char();
-    std::string read_identifier();
-    std::string read_number();
-    std::string read_string(char str_start);
+    token make_token(token_type type, size_t len = 1);
+    std::string_view read_identifier();
+    std::string_view read_number();
+    std::string_view read_string(char str_start);
     void consume_whitespace();
   private:
-    std::string m_input;
-    int m_current_position = 0;
-    int m_read_position = 0;
+    std::string_view m_input;
+    size_t m_current_position = 0;
+    size_t m_read_position = 0;
     char m_current_char = 0;
   };
 }
@@ -1,21 +1,70 @@
+#include "fork_join.hpp"
+#include "optimizer.hpp"
 #include "repl.hpp"
 #include "runner.hpp"
 
+#include <cstdlib>
 #include <filesystem>
 #include <iostream>
+#include <string_view>
+#include <vector>
 
 
 int main(int argc, char** argv)
 {
-  if(argc == 1)
+  my_ns::runner_options options;
+  bool opt_stats = false;
+  std::vector<std::string_view> files;
+  for(int i = 1; i < argc; ++i)
+  {
+    std::string_view arg = argv[i];
+    if(arg == "--lazy")
+      options.lazy_fun_bodies = true;
+    else if(arg == "--stream")
+      options.stream = true;
+    else if(arg == "--no-cache")
+      options.use_cache = false;
+    else if(arg == "--no-opt")
+      options.optimize = false;
+    else if(arg == "--no-specialize")
+      options.specialize = false;
+    else if(arg == "--auto-memo")
+      options.auto_memo = true;
+    else if(arg == "--memo-size" && i + 1 < argc)
+      options.memo_capacity = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--threads" && i + 1 < argc)
+      options.threads = std::strtoul(argv[++i], nullptr, 10);
+    else if(arg == "--opt-stats")
+      opt_stats = true;
+    else if(arg == "--inline-budget" && i + 1 < argc)
+      options.inline_budget = std::strtoul(argv[++i], nullptr, 10);
+    else if((arg == "--snapshot" || arg == "--save-snapshot") && i + 1 < argc)
+      (arg == "--snapshot" ? options.snapshot : options.save_snapshot) = argv[++i];
+    else if(arg.starts_with("--"))
+    {
+      std::cerr << "unknown option: " << arg << "\n";
+      return 1;
+    }
+    else
+      files.push_back(arg);
+  }
+
+  if(files.empty())
   {
     std::cout << "this is lea language \n";
+    my_ns::get_optimizer().set_enabled(options.optimize);
+    my_ns::get_optimizer().set_inline_budget(options.inline_budget);
+    my_ns::get_optimizer().set_specialize(options.specialize);
+    my_ns::get_optimizer().set_auto_memo(options.auto_memo);
+    my_ns::get_optimizer().set_memo_capacity(options.memo_capacity);
+    if(options.threads)
+      my_ns::get_fork_join_pool().resize(options.threads);
     my_ns::start_repl();
   }
-  else if(argc == 2)
+  else if(files.size() == 1)
   {
-    auto f = std::filesystem::path(argv[1]);
-    auto ret = my_ns::start_runner(f);
+    auto f = std::filesystem::path(files[0]);
+    auto ret = my_ns::start_runner(f, options);
     if(!ret.has_value())
     {
       const my_ns::runner_error& errs = ret.error();
@@ -34,10 +83,39 @@ int main(int argc, char** argv)
             case my_ns::runner_error::type::cant_open_file:
               prefix = "cant open file error: ";
               break;
+            case my_ns::runner_error::type::snapshot_error:
+              prefix = "snapshot error: ";
+              break;
           }
           std::cerr << prefix << "message: " << err.second << "\n";
         }
       }
     }
   }
+
+  if(opt_stats)
+  {
+    const auto& stats = my_ns::get_optimizer().get_stats();
+    std::cerr << "optimizer: " << stats.folded << " folded, " << stats.pruned << " pruned, "
+              << stats.pooled << " pooled, " << stats.inlined << " inlined, " << stats.intrinsics << " intrinsics, "
+              << stats.specialized << " specialized, " << stats.pure << " pure, " << stats.memoized << " memoized, " << stats.forkable << " forkable, "
+              << stats.removed << " nodes removed\n";
+    const auto print_names = [](const char* what, const std::vector<std::string>& names)
+    {
+      if(names.empty())
+        return;
+      std::cerr << what << ":";
+      for(size_t i = 0; i < names.size(); ++i)
+        std::cerr << (i ? ", " : " ") << names[i];
+      std::cerr << "\n";
+    };
+    print_names("specialized", my_ns::get_optimizer().get_specialized_names());
+    print_names("pure", my_ns::get_optimizer().get_pure_names());
+    for(const auto& [name, table] : my_ns::get_optimizer().get_memoized())
+    {
+      const auto& cache = table->cache;
+      std::cerr << "memo " << name << ": " << cache.get_stats().hits << " hits, " << cache.get_stats().misses << " misses, "
+                << cache.get_stats().evictions << " evictions, " << cache.size() << "/" << cache.capacity() << " entries\n";
+    }
+  }
 }
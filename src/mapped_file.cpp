@@ -0,0 +1,97 @@
+#include "mapped_file.hpp"
+
+#include <fstream>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define LEA_HAS_MMAP 1
+#endif
+
+namespace my_ns
+{
+  std::expected<mapped_file, mapped_file::error> mapped_file::open(const std::filesystem::path& path)
+  {
+    mapped_file file;
+#if defined(LEA_HAS_MMAP)
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if(fd < 0)
+      return std::unexpected(error::cant_open);
+
+    struct stat st;
+    if(::fstat(fd, &st) != 0)
+    {
+      ::close(fd);
+      return std::unexpected(error::cant_open);
+    }
+
+    file.m_size = static_cast<size_t>(st.st_size);
+    if(file.m_size == 0) //mmap refuses empty files
+    {
+      ::close(fd);
+      file.m_data = "";
+      return file;
+    }
+
+    void* data = ::mmap(nullptr, file.m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if(data == MAP_FAILED)
+      return std::unexpected(error::cant_map);
+
+    ::madvise(data, file.m_size, MADV_SEQUENTIAL);
+    file.m_data = static_cast<const char*>(data);
+    file.m_mapped = true;
+#else
+    std::ifstream fstream(path, std::ios::binary);
+    if(!fstream)
+      return std::unexpected(error::cant_open);
+    std::stringstream ss;
+    ss << fstream.rdbuf();
+    file.m_fallback = ss.str();
+    file.m_data = file.m_fallback.data();
+    file.m_size = file.m_fallback.size();
+#endif
+    return file;
+  }
+
+  mapped_file::mapped_file(mapped_file&& other) noexcept
+  {
+    *this = std::move(other);
+  }
+
+  mapped_file& mapped_file::operator = (mapped_file&& other) noexcept
+  {
+    if(this == &other)
+      return *this;
+
+    release();
+    m_mapped = other.m_mapped;
+    m_size = other.m_size;
+    m_fallback = std::move(other.m_fallback);
+    m_data = m_mapped || m_size == 0 ? other.m_data : m_fallback.data();
+
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_mapped = false;
+    return *this;
+  }
+
+  mapped_file::~mapped_file()
+  {
+    release();
+  }
+
+  void mapped_file::release()
+  {
+#if defined(LEA_HAS_MMAP)
+    if(m_mapped)
+      ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <expected>
+#include <filesystem>
+#include <string>
+#include <string_view>
+
+namespace my_ns
+{
+  //read only view of a whole file, mmap'ed where the platform has it
+  class mapped_file
+  {
+  public:
+    enum class error
+    {
+      cant_open, cant_map
+    };
+  public:
+    static std::expected<mapped_file, error> open(const std::filesystem::path& path);
+
+    mapped_file() = default;
+    mapped_file(mapped_file&& other) noexcept;
+    mapped_file& operator = (mapped_file&& other) noexcept;
+    mapped_file(const mapped_file&) = delete;
+    mapped_file& operator = (const mapped_file&) = delete;
+    ~mapped_file();
+
+    inline std::string_view view() const
+    {
+      return { m_data, m_size };
+    }
+  private:
+    void release();
+  private:
+    const char* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::string m_fallback; //used when mmap isn't available
+  };
+}
@@ -0,0 +1,88 @@
+#include "memo.hpp"
+#include "evaluator.hpp"
+
+namespace my_ns
+{
+  memo_cache::memo_cache(size_t capacity)
+    : m_capacity(std::max<size_t>(capacity, 1))
+  {
+  }
+
+  std::optional<memo_key> memo_cache::make_key(std::span<const std::shared_ptr<object>> args)
+  {
+    memo_key key;
+    key.reserve(args.size());
+    for(const auto& arg : args)
+    {
+      auto h = hash_key(arg);
+      if(!h)
+        return std::nullopt;
+      key.push_back(*h);
+    }
+    return key;
+  }
+
+  std::shared_ptr<object> memo_cache::find(const memo_key& key)
+  {
+    std::lock_guard lock(m_mutex);
+    auto it = m_index.find(key);
+    if(it == m_index.end())
+    {
+      ++m_stats.misses;
+      return nullptr;
+    }
+    ++m_stats.hits;
+    m_order.splice(m_order.begin(), m_order, it->second);
+    return it->second->second;
+  }
+
+  void memo_cache::insert(memo_key key, const std::shared_ptr<object>& value)
+  {
+    std::lock_guard lock(m_mutex);
+    //a call can reach the same arguments again before it returns, the later result wins
+    if(auto it = m_index.find(key); it != m_index.end())
+    {
+      it->second->second = value;
+      m_order.splice(m_order.begin(), m_order, it->second);
+      return;
+    }
+
+    if(m_index.size() >= m_capacity)
+    {
+      m_index.erase(m_order.back().first);
+      m_order.pop_back();
+      ++m_stats.evictions;
+    }
+    m_order.emplace_front(std::move(key), value);
+    m_index.emplace(m_order.front().first, m_order.begin());
+  }
+
+  size_t memo_cache::key_hash::operator()(const memo_key& key) const
+  {
+    utils::hash_type h = key.size();
+    for(const auto& part : key)
+      h = utils::hash_combine(h, std::hash<hash_t>()(part));
+    return h;
+  }
+
+  bool dependencies_hold(const std::vector<memo_dependency>& dependencies, const std::shared_ptr<environment>& env)
+  {
+    for(const auto& dep : dependencies)
+    {
+      auto value = eval_identifire(dep.name, env);
+      if(dep.builtin)
+      {
+        if(value != dep.builtin)
+          return false;
+        continue;
+      }
+      if(value->get_type() != object_type::fun)
+        return false;
+      auto* target = static_cast<fun*>(value.get());
+      //compared by owner, a new literal at a freed one's address isn't the same
+      if(target->env != env || target->literal.owner_before(dep.literal) || dep.literal.owner_before(target->literal))
+        return false;
+    }
+    return true;
+  }
+}
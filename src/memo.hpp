@@ -0,0 +1,137 @@
+#pragma once
+
+#include "ast.hpp"
+#include "object.hpp"
+
+#include <list>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace my_ns
+{
+  //entries a cache keeps unless told otherwise
+  constexpr size_t default_memo_capacity = 65536;
+
+  //a call's arguments by their hashes. equal hashes are taken as equal values, the same as
+  //set elements and map keys
+  using memo_key = std::vector<hash_t>;
+
+  //results by arguments. once it's full the entry used least recently makes room. forks of a
+  //pure function share its cache, every call in goes through a lock
+  class memo_cache
+  {
+  public:
+    struct stats
+    {
+      size_t hits = 0;
+      size_t misses = 0;
+      size_t evictions = 0;
+      size_t skipped = 0; //calls with an argument that can't be hashed
+    };
+  public:
+    explicit memo_cache(size_t capacity);
+
+    //nullopt when one of them can't be hashed
+    static std::optional<memo_key> make_key(std::span<const std::shared_ptr<object>> args);
+
+    //counts a hit or a miss, what it finds becomes the most recently used
+    std::shared_ptr<object> find(const memo_key& key);
+    void insert(memo_key key, const std::shared_ptr<object>& value);
+
+    inline void count_skipped()
+    {
+      std::lock_guard lock(m_mutex);
+      ++m_stats.skipped;
+    }
+    inline size_t size() const
+    {
+      std::lock_guard lock(m_mutex);
+      return m_index.size();
+    }
+    inline size_t capacity() const
+    {
+      return m_capacity;
+    }
+    inline stats get_stats() const
+    {
+      std::lock_guard lock(m_mutex);
+      return m_stats;
+    }
+  private:
+    struct key_hash
+    {
+      size_t operator()(const memo_key& key) const;
+    };
+    using entry = std::pair<memo_key, std::shared_ptr<object>>;
+  private:
+    std::list<entry> m_order; //most recently used first
+    std::unordered_map<memo_key, std::list<entry>::iterator, key_hash> m_index;
+    size_t m_capacity;
+    stats m_stats;
+    mutable std::mutex m_mutex;
+  };
+
+  //a free name a pure function calls and what it has to hold for the cached results to still
+  //be right, a function made from this literal or the builtin itself
+  struct memo_dependency
+  {
+    std::shared_ptr<identifire> name;
+    std::weak_ptr<fun_literal> literal = {};
+    std::shared_ptr<object> builtin = nullptr;
+  };
+
+  //whether every name, looked up where the called function was made, still holds what the
+  //purity check saw. the functions have to be made there too so their names mean the same
+  bool dependencies_hold(const std::vector<memo_dependency>& dependencies, const std::shared_ptr<environment>& env);
+
+  //the cache automatic memoization gives a pure function literal
+  struct memo_table
+  {
+    memo_table(size_t capacity, std::vector<memo_dependency>&& dependencies)
+      : cache(capacity), dependencies(std::move(dependencies))
+    {
+    }
+
+    memo_cache cache;
+    std::vector<memo_dependency> dependencies;
+
+    inline bool holds(const std::shared_ptr<environment>& env) const
+    {
+      return dependencies_hold(dependencies, env);
+    }
+  };
+
+  //what lets calls to a pure function literal run as forks, the names its body calls through
+  //have to hold when one is forked
+  struct fork_plan
+  {
+    std::vector<memo_dependency> dependencies;
+
+    inline bool holds(const std::shared_ptr<environment>& env) const
+    {
+      return dependencies_hold(dependencies, env);
+    }
+  };
+
+  //the result cached for args, or what call returns, kept unless it's an error
+  template <typename Call>
+  std::shared_ptr<object> call_through(memo_cache& cache, std::span<const std::shared_ptr<object>> args, Call&& call)
+  {
+    auto key = memo_cache::make_key(args);
+    if(!key)
+    {
+      cache.count_skipped();
+      return call();
+    }
+    if(auto hit = cache.find(*key))
+      return hit;
+
+    auto res = call();
+    if(res->get_type() != object_type::error)
+      cache.insert(std::move(*key), res);
+    return res;
+  }
+}
@@ -0,0 +1,182 @@
+#include "module.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "optimizer.hpp"
+
+#include <algorithm>
+
+namespace my_ns
+{
+  //one key per file however it was spelled
+  static std::string module_key(const std::filesystem::path& file)
+  {
+    return std::filesystem::absolute(file).lexically_normal().string();
+  }
+
+  //sorted like the records map literals make so equal exports share a shape
+  static std::shared_ptr<map> make_record(const environment& env)
+  {
+    std::vector<std::pair<symbol, std::shared_ptr<object>>> fields(env.get_bindings().begin(), env.get_bindings().end());
+    std::sort(fields.begin(), fields.end(), [](const auto& a, const auto& b) { return a.first.str() < b.first.str(); });
+
+    std::vector<symbol> keys;
+    std::vector<std::shared_ptr<object>> slots;
+    for(auto& [key, value] : fields)
+    {
+      keys.push_back(key);
+      slots.push_back(std::move(value));
+    }
+    return std::make_shared<map>(shape::get(keys), std::move(slots));
+  }
+
+  void module_cache::set_root(const std::filesystem::path& dir)
+  {
+    m_root = dir;
+  }
+
+  std::filesystem::path module_cache::resolve(const import_expression& expr) const
+  {
+    if(!expr.resolved.empty())
+      return expr.resolved;
+    return m_root / expr.path;
+  }
+
+  void module_cache::prefetch(const std::vector<std::filesystem::path>& files)
+  {
+    std::vector<std::pair<std::string, module*>> claimed;
+    {
+      std::lock_guard lock(m_mutex);
+      for(const auto& file : files)
+      {
+        auto key = module_key(file);
+        if(auto mod = claim(key))
+          claimed.emplace_back(std::move(key), mod);
+      }
+    }
+    parse_all(claimed);
+
+    //files another prefetch claimed first may still be parsing
+    std::unique_lock lock(m_mutex);
+    m_parsed.wait(lock, [this] { return m_pending == 0; });
+  }
+
+  module_cache::module* module_cache::claim(const std::string& key)
+  {
+    auto [it, inserted] = m_modules.try_emplace(key);
+    if(!inserted)
+      return nullptr;
+
+    it->second = std::make_unique<module>();
+    ++m_pending;
+    return it->second.get();
+  }
+
+  void module_cache::parse_all(const std::vector<std::pair<std::string, module*>>& claimed)
+  {
+    get_fork_join_pool().for_range(0, claimed.size(), 1, [&](size_t begin, size_t end) {
+      for(auto i = begin; i < end; ++i)
+      {
+        const auto& [key, mod] = claimed[i];
+        auto imports = parse(key, *mod);
+
+        std::vector<std::pair<std::string, module*>> found;
+        {
+          std::lock_guard lock(m_mutex);
+          for(auto& dep : imports)
+            if(auto dep_mod = claim(dep))
+              found.emplace_back(std::move(dep), dep_mod);
+          mod->current = module::state::parsed;
+          if(--m_pending == 0)
+            m_parsed.notify_all();
+        }
+        parse_all(found);
+      }
+    });
+  }
+
+  //runs on any thread of the pool, the module isn't visible to the evaluator until it's parsed
+  std::vector<std::string> module_cache::parse(const std::string& key, module& mod)
+  {
+    auto source = mapped_file::open(key);
+    if(!source.has_value())
+    {
+      mod.errors.push_back("can't read file: " + key);
+      return {};
+    }
+    mod.source = std::move(*source);
+
+    lexer lx(mod.source.view());
+    parser ps(&lx);
+    mod.prog = ps.parse_program();
+    mod.errors = ps.get_errors();
+    if(!mod.errors.empty())
+      return {};
+
+    auto dir = std::filesystem::path(key).parent_path();
+    std::vector<std::string> imports;
+    for(const auto& expr : ps.get_imports())
+    {
+      expr->resolved = module_key(dir / expr->path);
+      imports.push_back(expr->resolved);
+    }
+    return imports;
+  }
+
+  module_cache::module* module_cache::find(const std::string& key) const
+  {
+    std::lock_guard lock(m_mutex);
+    auto it = m_modules.find(key);
+    return it == m_modules.end() ? nullptr : it->second.get();
+  }
+
+  std::shared_ptr<object> module_cache::import(const std::filesystem::path& file)
+  {
+    auto key = module_key(file);
+    auto mod = find(key);
+    if(!mod)
+    {
+      prefetch({ key });
+      mod = find(key);
+    }
+
+    switch(mod->current)
+    {
+      case module::state::done:
+        return mod->value;
+      case module::state::evaluating:
+        return add_error("import cycle: " + key + " is imported while it runs");
+      default:
+        break;
+    }
+
+    if(!mod->errors.empty())
+    {
+      std::string msg = "can't import " + key + ":";
+      for(const auto& e : mod->errors)
+        msg += " " + e;
+      mod->value = add_error(msg);
+      mod->current = module::state::done;
+      return mod->value;
+    }
+
+    mod->current = module::state::evaluating;
+    auto env = std::make_shared<environment>();
+    get_optimizer().optimize(mod->prog);
+    auto res = eval(mod->prog, env);
+    mod->value = res && res->get_type() == object_type::error ? res : make_record(*env);
+    mod->current = module::state::done;
+    return mod->value;
+  }
+
+  size_t module_cache::size() const
+  {
+    std::lock_guard lock(m_mutex);
+    return m_modules.size();
+  }
+
+  module_cache& get_modules()
+  {
+    static module_cache s_modules;
+    return s_modules;
+  }
+}
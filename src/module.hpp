@@ -0,0 +1,71 @@
+#pragma once
+
+#include "ast.hpp"
+#include "fork_join.hpp"
+#include "mapped_file.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+
+#include <condition_variable>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace my_ns
+{
+  //every file imported in this process, each parsed once and evaluated once. the files a
+  //module imports are found while it's parsed so the whole graph under an import is parsed
+  //up front on the fork-join pool the evaluator uses, independent files at the same time.
+  //evaluation stays on the thread that imports
+  class module_cache
+  {
+  public:
+    //imports the parser couldn't tie to a file (the main script's, the repl's) are looked up here
+    void set_root(const std::filesystem::path& dir);
+    inline const std::filesystem::path& get_root() const
+    {
+      return m_root;
+    }
+    std::filesystem::path resolve(const import_expression& expr) const;
+
+    //parse the files and everything they import, returns once the whole graph is parsed
+    void prefetch(const std::vector<std::filesystem::path>& files);
+    //the module's top level names as a record, the file runs on its first import only
+    std::shared_ptr<object> import(const std::filesystem::path& file);
+
+    size_t size() const;
+  private:
+    struct module
+    {
+      enum class state
+      {
+        parsing, parsed, evaluating, done
+      };
+
+      state current = state::parsing;
+      mapped_file source; //the AST views into it
+      std::shared_ptr<program> prog;
+      parser::errors errors;
+      std::shared_ptr<object> value;
+    };
+  private:
+    //the module for key if nobody claimed it yet, m_mutex held
+    module* claim(const std::string& key);
+    //parses the claimed modules side by side, and then what each of them imports
+    void parse_all(const std::vector<std::pair<std::string, module*>>& claimed);
+    std::vector<std::string> parse(const std::string& key, module& mod);
+    module* find(const std::string& key) const;
+  private:
+    std::filesystem::path m_root;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_parsed;
+    size_t m_pending = 0;
+    std::unordered_map<std::string, std::unique_ptr<module>> m_modules;
+  };
+
+  //the one import expressions go through
+  module_cache& get_modules();
+}
@@ -1,22 +1,38 @@
 #pragma once
 
 #include "ast.hpp"
+#include "bignum.hpp"
+#include "fork_join.hpp"
+#include "hash_trie.hpp"
+#include "intern.hpp"
 #include "utils.hpp"
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <charconv>
+#include <cstdint>
 #include <expected>
 #include <functional>
+#include <limits>
 #include <memory>
+#include <optional>
+#include <span>
 #include <sstream>
 #include <string>
+#include <string_view>
 #include <unordered_map>
+#include <vector>
 
 namespace my_ns 
 {
   enum class object_type 
   {
     null = 0, integer, string, array, map, boolean, ret_value, fun, builtin,
-    error, void_obj
+    error, void_obj, set, floating, big_integer, memoized
   };
 
+  constexpr size_t object_type_count = static_cast<size_t>(object_type::memoized) + 1;
+
   struct hash_t
   {
     object_type type;
@@ -109,35 +125,272 @@ namespace my_ns
     int64_t m_value;
   };
 
-  class string : public object, public hashable
+  //the double is held in the object, there's no second allocation for it. arithmetic on a
+  //temporary nothing else holds writes the result over it instead of making a new one
+  class floating : public object, public hashable
   {
   public:
-    string(const std::string& val)
+    floating(double val)
       : m_value(val)
     {
     }
 
     object_type get_type() override
     {
-      return object_type::string;
+      return object_type::floating;
     }
 
+    //shortest text that reads back to the same double, whole values keep a .0
     std::string inspect() override
+    {
+      char buf[32];
+      auto [end, _] = std::to_chars(buf, buf + sizeof(buf), m_value);
+      std::string out(buf, end);
+      if(out.find_first_of(".en") == std::string::npos)
+        out += ".0";
+      return out;
+    }
+
+    inline double get_value() const
     {
       return m_value;
     }
 
-    inline const std::string& get_value() const
+    inline void set_value(double val)
+    {
+      m_value = val;
+    }
+
+    hash_t hash() override
+    {
+      //0.0 and -0.0 are equal, they have to hash the same
+      return { .type = object_type::floating, .value = std::bit_cast<utils::hash_type>(m_value == 0 ? 0.0 : m_value) };
+    }
+  private:
+    double m_value;
+  };
+
+  //what integer arithmetic promotes to when the result doesn't fit in an int64. results that
+  //fit again go back to being an integer, so a big_integer is never in the int64 range
+  class big_integer : public object, public hashable
+  {
+  public:
+    big_integer(bignum val)
+      : m_value(std::move(val))
+    {
+    }
+
+    object_type get_type() override
+    {
+      return object_type::big_integer;
+    }
+
+    std::string inspect() override
+    {
+      return m_value.to_string();
+    }
+
+    inline const bignum& get_value() const
     {
       return m_value;
     }
 
     hash_t hash() override
     {
-      return { .type = object_type::integer, .value = utils::fnv1a_hash(m_value) };
+      utils::hash_type h = m_value.is_negative();
+      for(auto limb : m_value.get_limbs())
+        h = utils::hash_combine(h, limb);
+      return { .type = object_type::big_integer, .value = h };
+    }
+  private:
+    bignum m_value;
+  };
+
+  //a string is either a flat buffer or a lazy concatenation of two strings (a rope).
+  //ropes are kept height balanced and get flattened the first time the text is needed.
+  //flat strings can be slices, they share the buffer of the string they came from.
+  //the text and the hash are filled in under a lock, a value can be shared by forks
+  class string : public object, public hashable
+  {
+  public:
+    //leaves smaller than this get merged on concat so appending one char at a time
+    //doesn't end up with a node per char
+    static constexpr size_t small_leaf = 512;
+  public:
+    string(const std::string& val)
+      : m_buffer(std::make_shared<const std::string>(val)), m_size(val.size()), m_flat(true)
+    {
+    }
+
+    //shares the interned buffer, no copy and the hash is already known
+    string(const symbol& sym)
+      : m_buffer(sym.buffer()), m_size(sym.str().size()), m_flat(true), m_hash(sym.hash()), m_hashed(true)
+    {
+    }
+
+    string(const std::shared_ptr<const std::string>& buffer, size_t offset, size_t size)
+      : m_buffer(buffer), m_offset(offset), m_size(size), m_flat(true)
+    {
+    }
+
+    string(const std::shared_ptr<string>& left, const std::shared_ptr<string>& right)
+      : m_size(left->size() + right->size()), m_depth(std::max(left->depth(), right->depth()) + 1),
+        m_left(left), m_right(right)
+    {
+    }
+
+    object_type get_type() override
+    {
+      return object_type::string;
+    }
+
+    std::string inspect() override
+    {
+      return std::string(get_value());
+    }
+
+    inline std::string_view get_value() const
+    {
+      flatten();
+      return std::string_view(*m_buffer).substr(m_offset, m_size);
+    }
+
+    //zero copy substring, the caller clamps offset and size
+    std::shared_ptr<string> slice(size_t offset, size_t size) const
+    {
+      flatten();
+      return std::make_shared<string>(m_buffer, m_offset + offset, size);
+    }
+
+    inline size_t size() const
+    {
+      return m_size;
+    }
+
+    inline size_t depth() const
+    {
+      return m_depth;
+    }
+
+    inline bool is_flat() const
+    {
+      return m_flat.load(std::memory_order_acquire);
+    }
+
+    hash_t hash() override
+    {
+      if(!m_hashed.load(std::memory_order_acquire))
+      {
+        auto value = get_value();
+        std::lock_guard lock(lazy_lock(this));
+        if(!m_hashed.load(std::memory_order_relaxed))
+        {
+          m_hash = utils::fast_hash(value);
+          m_hashed.store(true, std::memory_order_release);
+        }
+      }
+      return { .type = object_type::string, .value = m_hash };
+    }
+
+    static std::shared_ptr<string> concat(const std::shared_ptr<string>& left, const std::shared_ptr<string>& right)
+    {
+      if(left->size() == 0)
+        return right;
+      if(right->size() == 0)
+        return left;
+      return join(left, right);
+    }
+  private:
+    //AVL style join, only the spine between the two roots gets rebuilt
+    static std::shared_ptr<string> join(const std::shared_ptr<string>& l, const std::shared_ptr<string>& r)
+    {
+      if(l->is_flat() && r->is_flat() && l->size() + r->size() <= small_leaf)
+      {
+        std::string merged;
+        merged.reserve(l->size() + r->size());
+        merged += l->get_value();
+        merged += r->get_value();
+        return std::make_shared<string>(merged);
+      }
+
+      auto hl = l->depth();
+      auto hr = r->depth();
+      bool small_right = r->is_flat() && r->size() < small_leaf;
+      bool small_left = l->is_flat() && l->size() < small_leaf;
+
+      if(!l->is_flat() && (hl > hr + 1 || small_right))
+        return balance(l->m_left, join(l->m_right, r));
+      if(!r->is_flat() && (hr > hl + 1 || small_left))
+        return balance(join(l, r->m_left), r->m_right);
+      return std::make_shared<string>(l, r);
+    }
+
+    static std::shared_ptr<string> balance(const std::shared_ptr<string>& a, const std::shared_ptr<string>& b)
+    {
+      if(a->depth() > b->depth() + 1)
+      {
+        const auto& al = a->m_left;
+        const auto& ar = a->m_right;
+        if(al->depth() >= ar->depth())
+          return std::make_shared<string>(al, std::make_shared<string>(ar, b));
+        return std::make_shared<string>(std::make_shared<string>(al, ar->m_left), std::make_shared<string>(ar->m_right, b));
+      }
+      if(b->depth() > a->depth() + 1)
+      {
+        const auto& bl = b->m_left;
+        const auto& br = b->m_right;
+        if(br->depth() >= bl->depth())
+          return std::make_shared<string>(std::make_shared<string>(a, bl), br);
+        return std::make_shared<string>(std::make_shared<string>(a, bl->m_left), std::make_shared<string>(bl->m_right, br));
+      }
+      return std::make_shared<string>(a, b);
+    }
+
+    //while forks run the pieces stay, another thread may be joining onto them
+    void flatten() const
+    {
+      if(is_flat())
+        return;
+      std::lock_guard lock(lazy_lock(this));
+      if(m_flat.load(std::memory_order_relaxed))
+        return;
+
+      std::string flat;
+      flat.reserve(m_size);
+      std::vector<const string*> stack{ this };
+      while(!stack.empty())
+      {
+        auto str = stack.back();
+        stack.pop_back();
+        if(str->is_flat())
+        {
+          flat += std::string_view(*str->m_buffer).substr(str->m_offset, str->m_size);
+        }
+        else
+        {
+          stack.push_back(str->m_right.get());
+          stack.push_back(str->m_left.get());
+        }
+      }
+
+      m_buffer = std::make_shared<const std::string>(std::move(flat));
+      if(!in_parallel())
+      {
+        m_depth = 0;
+        m_left.reset();
+        m_right.reset();
+      }
+      m_flat.store(true, std::memory_order_release);
     }
   private:
-    std::string m_value;
+    mutable std::shared_ptr<const std::string> m_buffer;
+    size_t m_offset = 0;
+    size_t m_size = 0;
+    mutable size_t m_depth = 0;
+    mutable std::shared_ptr<string> m_left, m_right;
+    mutable std::atomic<bool> m_flat = false;
+    utils::hash_type m_hash = 0;
+    std::atomic<bool> m_hashed = false;
   };
 
   class array : public object
@@ -148,6 +401,11 @@ namespace my_ns
     {
     }
 
+    array(std::vector<std::shared_ptr<object>>&& elems)
+      : m_elements(std::move(elems))
+    {
+    }
+
     object_type get_type() override
     {
       return object_type::array;
@@ -174,6 +432,63 @@ namespace my_ns
     std::vector<std::shared_ptr<object>> m_elements;
   };
 
+  //hidden class of a map whose keys are all constant strings. maps built from
+  //literals with the same key set share one shape and keep their values in a
+  //flat slot array in shape order
+  class shape
+  {
+  public:
+    static constexpr uint32_t no_slot = UINT32_MAX;
+  public:
+    //keys must be sorted and unique. shapes live for the whole process
+    static const shape* get(const std::vector<symbol>& keys)
+    {
+      static std::unordered_map<size_t, std::vector<std::unique_ptr<shape>>> s_shapes;
+      static std::mutex s_mutex;
+      std::lock_guard lock(s_mutex);
+      size_t h = keys.size();
+      for(const auto& key : keys)
+        h = utils::hash_combine(h, key.hash());
+
+      auto& bucket = s_shapes[h];
+      for(const auto& sh : bucket)
+        if(sh->m_keys == keys)
+          return sh.get();
+
+      bucket.push_back(std::unique_ptr<shape>(new shape(keys)));
+      return bucket.back().get();
+    }
+
+    uint32_t find(const symbol& key) const
+    {
+      if(m_index.empty())
+      {
+        for(uint32_t i = 0; i < m_keys.size(); ++i)
+          if(m_keys[i] == key)
+            return i;
+        return no_slot;
+      }
+      auto it = m_index.find(key);
+      return it == m_index.end() ? no_slot : it->second;
+    }
+
+    inline const std::vector<symbol>& get_keys() const
+    {
+      return m_keys;
+    }
+  private:
+    shape(const std::vector<symbol>& keys)
+      : m_keys(keys)
+    {
+      if(m_keys.size() > 8) //linear scan is faster for small records
+        for(uint32_t i = 0; i < m_keys.size(); ++i)
+          m_index[m_keys[i]] = i;
+    }
+  private:
+    std::vector<symbol> m_keys;
+    std::unordered_map<symbol, uint32_t> m_index;
+  };
+
   class map : public object
   {
   public:
@@ -187,6 +502,11 @@ namespace my_ns
     {
     }
 
+    map(const shape* sh, std::vector<std::shared_ptr<object>>&& slots)
+      : m_shape(sh), m_slots(std::move(slots)), m_materialized(false)
+    {
+    }
+
     object_type get_type() override
     {
       return object_type::map;
@@ -197,19 +517,83 @@ namespace my_ns
       std::stringstream ss;
 
       ss << "[";
-      for(const auto& elem : m_map)
+      for(const auto& elem : get_map())
         ss << elem.second.key->inspect() << ": " << elem.second.value->inspect() << ", ";
       ss << "]";
       
       return ss.str();
     }
 
+    //records build their hash table only when someone asks for it
     inline const std::unordered_map<hash_t, hash_pair>& get_map() const
     {
+      if(!m_materialized.load(std::memory_order_acquire))
+      {
+        std::lock_guard lock(lazy_lock(this));
+        if(!m_materialized.load(std::memory_order_relaxed))
+        {
+          const auto& keys = m_shape->get_keys();
+          for(size_t i = 0; i < keys.size(); ++i)
+          {
+            auto key = std::make_shared<string>(keys[i]);
+            m_map[key->hash()] = hash_pair{ .key = key, .value = m_slots[i] };
+          }
+          m_materialized.store(true, std::memory_order_release);
+        }
+      }
       return m_map;
     }
+
+    inline const shape* get_shape() const
+    {
+      return m_shape;
+    }
+
+    inline const std::vector<std::shared_ptr<object>>& get_slots() const
+    {
+      return m_slots;
+    }
+  private:
+    const shape* m_shape = nullptr;
+    std::vector<std::shared_ptr<object>> m_slots;
+    mutable std::unordered_map<hash_t, hash_pair> m_map;
+    mutable std::atomic<bool> m_materialized = true;
+  };
+
+  //a value like the rest, add and the set algebra make a new one that shares what it can
+  class set : public object
+  {
+  public:
+    using elements = hash_trie<hash_t, std::shared_ptr<object>>;
+  public:
+    set(elements&& elems)
+      : m_elements(std::move(elems))
+    {
+    }
+
+    object_type get_type() override
+    {
+      return object_type::set;
+    }
+
+    std::string inspect() override
+    {
+      std::stringstream ss;
+
+      ss << "{";
+      for(const auto& elem : m_elements)
+        ss << elem.second->inspect() << ", ";
+      ss << "}";
+
+      return ss.str();
+    }
+
+    inline const elements& get_elements() const
+    {
+      return m_elements;
+    }
   private:
-    std::unordered_map<hash_t, hash_pair> m_map;
+    elements m_elements;
   };
 
   class boolean : public object, public hashable
@@ -298,49 +682,129 @@ namespace my_ns
       not_found,
     };
   public:
-    environment() = default;
+    environment()
+    {
+      bump_version();
+    }
     environment(const std::initializer_list<std::pair<const std::string, std::shared_ptr<object>>>& inl)
-      : m_map(inl)
     {
+      bump_version();
+      for(const auto& [ident, obj] : inl)
+        m_map[intern(ident)] = obj;
     }
 
     environment(const std::shared_ptr<environment>& outer)
-      : m_outer(outer)
+      : m_outer(outer), m_global(outer->m_global)
     {
     }
 
-    std::expected<std::shared_ptr<object>, error> get(const std::string& ident) const
+    //a loop's frame, it only keeps the loop variable. everything else the body binds goes to the scope
+    //around the loop, a var in the body updates what was there before the loop
+    environment(const std::shared_ptr<environment>& outer, const symbol& only)
+      : m_outer(outer), m_global(outer->m_global), m_only(only)
+    {
+    }
+
+    //the outermost scope keeps a pointer to itself
+    environment(const environment&) = delete;
+    environment& operator = (const environment&) = delete;
+
+    std::expected<std::shared_ptr<object>, error> get(const symbol& ident) const
     {
-      auto it = m_map.find(ident);
-      if(it == m_map.end())
+      const environment* env = this;
+      while(env)
       {
-        if(m_outer == nullptr)
-        {
-          return std::unexpected(error::not_found);
-        }
-        else
-        {
-          return m_outer->get(ident);
-        }
+        auto it = env->m_map.find(ident);
+        if(it != env->m_map.end())
+          return it->second;
+        env = env->m_outer.get();
       }
-      return it->second;
+      return std::unexpected(error::not_found);
+    }
+
+    std::expected<std::shared_ptr<object>, error> get(const std::string& ident) const
+    {
+      auto sym = find_interned(ident);
+      if(!sym)
+        return std::unexpected(error::not_found);
+      return get(*sym);
     }
 
     //TODO: non replacing set
+    void set(const symbol& ident, const std::shared_ptr<object>& obj)
+    {
+      if(!m_only.empty() && !(ident == m_only))
+      {
+        m_outer->set(ident, obj);
+        return;
+      }
+      if(ident.is_builtin())
+        ident.mark_shadowed();
+      if(m_outer)
+      {
+        if(!ident.is_local())
+          ident.mark_local();
+        m_map[ident] = obj;
+        return;
+      }
+      //a global set again keeps its cell, only a new name makes cached misses stale
+      auto [it, added] = m_map.insert_or_assign(ident, obj);
+      if(added)
+        bump_version();
+    }
+
     void set(const std::string& ident, const std::shared_ptr<object>& obj)
     {
-      m_map[ident] = obj;
+      set(intern(ident), obj);
+    }
+
+    //this scope's own names, the outer ones aren't included
+    inline const std::unordered_map<symbol, std::shared_ptr<object>>& get_bindings() const
+    {
+      return m_map;
+    }
+
+    inline const std::shared_ptr<environment>& get_outer() const
+    {
+      return m_outer;
+    }
+
+    inline const environment* get_global() const
+    {
+      return m_global;
+    }
+
+    //the slot a global lives in, a map node never moves so the pointer stays good while the scope lives.
+    //null when the outermost scope doesn't have the name
+    const std::shared_ptr<object>* find_cell(const symbol& ident) const
+    {
+      auto it = m_global->m_map.find(ident);
+      return it == m_global->m_map.end() ? nullptr : &it->second;
+    }
+
+    //changes whenever a global scope is made or gets a new name
+    static inline uint64_t version()
+    {
+      return s_version.load(std::memory_order_acquire);
+    }
+  private:
+    static inline void bump_version()
+    {
+      s_version.fetch_add(1, std::memory_order_acq_rel);
     }
   private:
-    std::unordered_map<std::string, std::shared_ptr<object>> m_map;
+    std::unordered_map<symbol, std::shared_ptr<object>> m_map;
     std::shared_ptr<environment> m_outer = nullptr;
+    const environment* m_global = this;
+    symbol m_only;
+    static inline std::atomic<uint64_t> s_version = 0;
   };
 
   class fun : public object 
   {
   public:
-    fun(const std::vector<std::shared_ptr<identifire>>& params, std::shared_ptr<block> body, const std::shared_ptr<environment>& env)
-      : parameters(params), body(body), env(env)
+    fun(const std::shared_ptr<fun_literal>& literal, const std::shared_ptr<environment>& env)
+      : parameters(literal->parameters), body(literal->body), literal(literal), env(env)
     {
     }
 
@@ -358,26 +822,36 @@ namespace my_ns
         ss << p << ", ";
 
       ss << ")\n{\n";
-      ss << body->to_string();
+      if(body)
+        ss << body->to_string();
+      else
+        ss << literal->body_source;
       ss << "\n}";
 
       return ss.str();
     }
   public:
     std::vector<std::shared_ptr<identifire>> parameters;
-    std::shared_ptr<block> body;
+    std::shared_ptr<block> body; //null until the first call when the parser skipped it
+    std::shared_ptr<fun_literal> literal;
     std::shared_ptr<environment> env;
   };
 
   class builtin : public object
   {
   public:
-    using fun_type = std::function<std::shared_ptr<object>(const std::vector<std::shared_ptr<object>>&)>;
+    using arguments = std::span<const std::shared_ptr<object>>;
+    using fun_type = std::shared_ptr<object>(*)(arguments);
   public:
     builtin() = default;
-    builtin(const fun_type& fn)
-      : _fun(fn)
+    builtin(fun_type fn, size_t min_args = 0, size_t max_args = std::numeric_limits<size_t>::max())
+      : _fun(fn), min_args(min_args), max_args(max_args)
+    {
+    }
+
+    inline bool accepts(size_t count) const
     {
+      return count >= min_args && count <= max_args;
     }
 
     object_type get_type() override
@@ -390,7 +864,57 @@ namespace my_ns
       return "builtin function";
     }
   public:
-    fun_type _fun;
+    fun_type _fun = nullptr;
+    //the counts it takes, calls outside them are left for the builtin to report
+    size_t min_args = 0;
+    size_t max_args = std::numeric_limits<size_t>::max();
+    //whether it only returns what its arguments decide, set once when the builtins get their names
+    bool pure = true;
   };
+
+  class memo_cache;
+
+  //a function behind a cache of its results, what memo(f) returns. calling it calls the
+  //function only for arguments it hasn't seen
+  class memoized : public object
+  {
+  public:
+    memoized(const std::shared_ptr<object>& target, const std::shared_ptr<memo_cache>& cache)
+      : target(target), cache(cache)
+    {
+    }
+
+    object_type get_type() override
+    {
+      return object_type::memoized;
+    }
+
+    std::string inspect() override
+    {
+      return "memo(" + target->inspect() + ")";
+    }
+  public:
+    std::shared_ptr<object> target;
+    std::shared_ptr<memo_cache> cache;
+  };
+
+  //fast path for the usual key types, avoids a dynamic_cast per element
+  inline std::optional<hash_t> hash_key(const std::shared_ptr<object>& obj)
+  {
+    switch(obj->get_type())
+    {
+      case object_type::integer: return static_cast<integer*>(obj.get())->hash();
+      case object_type::floating: return static_cast<floating*>(obj.get())->hash();
+      case object_type::big_integer: return static_cast<big_integer*>(obj.get())->hash();
+      case object_type::string:  return static_cast<string*>(obj.get())->hash();
+      case object_type::boolean: return static_cast<boolean*>(obj.get())->hash();
+      default:
+      {
+        if(auto h = std::dynamic_pointer_cast<hashable>(obj))
+          return h->hash();
+        return std::nullopt;
+      }
+    }
+  }
 }
 
@@ -0,0 +1,1129 @@
+#include "optimizer.hpp"
+#include "builtins.hpp"
+#include "evaluator.hpp"
+#include "memo.hpp"
+#include "object.hpp"
+#include "parser.hpp"
+#include "specializer.hpp"
+
+#include <algorithm>
+#include <unordered_set>
+
+namespace my_ns
+{
+  //nodes in the tree under n, bodies that weren't parsed yet count as nothing
+  static size_t count_nodes(const std::shared_ptr<node>& n)
+  {
+    if(!n)
+      return 0;
+
+    size_t count = 1;
+    switch(n->get_type())
+    {
+      case node_type::program:
+      {
+        for(const auto& stmt : std::static_pointer_cast<program>(n)->m_statements)
+          count += count_nodes(stmt);
+        break;
+      }
+      case node_type::var:
+        count += 1 + count_nodes(std::static_pointer_cast<var>(n)->value);
+        break;
+      case node_type::ret:
+        count += count_nodes(std::static_pointer_cast<ret>(n)->return_value);
+        break;
+      case node_type::expression_statement:
+        count += count_nodes(std::static_pointer_cast<expression_statement>(n)->_expression);
+        break;
+      case node_type::block:
+      {
+        for(const auto& stmt : std::static_pointer_cast<block>(n)->statements)
+          count += count_nodes(stmt);
+        break;
+      }
+      case node_type::array:
+      {
+        for(const auto& e : std::static_pointer_cast<array_literal>(n)->elements)
+          count += count_nodes(e);
+        break;
+      }
+      case node_type::map:
+      {
+        for(const auto& [key, value] : std::static_pointer_cast<map_literal>(n)->pairs)
+          count += count_nodes(key) + count_nodes(value);
+        break;
+      }
+      case node_type::index:
+      {
+        auto idx = std::static_pointer_cast<index>(n);
+        count += count_nodes(idx->left) + count_nodes(idx->right);
+        break;
+      }
+      case node_type::prefix:
+        count += count_nodes(std::static_pointer_cast<prefix>(n)->right);
+        break;
+      case node_type::infix:
+      {
+        auto inf = std::static_pointer_cast<infix>(n);
+        count += count_nodes(inf->left) + count_nodes(inf->right);
+        break;
+      }
+      case node_type::_if:
+      {
+        auto if_node = std::static_pointer_cast<_if>(n);
+        count += count_nodes(if_node->condition) + count_nodes(if_node->consequence) + count_nodes(if_node->alternative);
+        break;
+      }
+      case node_type::_while:
+      {
+        auto loop = std::static_pointer_cast<_while>(n);
+        count += count_nodes(loop->condition) + count_nodes(loop->body);
+        break;
+      }
+      case node_type::_for:
+      {
+        auto loop = std::static_pointer_cast<_for>(n);
+        count += 1 + count_nodes(loop->iterable) + count_nodes(loop->body);
+        break;
+      }
+      case node_type::fun:
+      {
+        auto literal = std::static_pointer_cast<fun_literal>(n);
+        count += literal->parameters.size() + count_nodes(literal->body);
+        break;
+      }
+      case node_type::call:
+      {
+        auto call_node = std::static_pointer_cast<call>(n);
+        count += count_nodes(call_node->function);
+        for(const auto& arg : call_node->arguments)
+          count += count_nodes(arg);
+        break;
+      }
+      case node_type::inlined:
+        count = count_nodes(std::static_pointer_cast<inlined_call>(n)->original);
+        break;
+      case node_type::intrinsic:
+        count = count_nodes(std::static_pointer_cast<intrinsic_call>(n)->original);
+        break;
+      default:
+        break;
+    }
+    return count;
+  }
+
+  //what the copy of an inlined body says in place of the callee's params and locals
+  struct renames
+  {
+    std::unordered_map<symbol, symbol> names;
+    std::unordered_map<symbol, std::shared_ptr<expression>> constants; //params given a constant
+  };
+
+  //whether a function body can run in its caller's environment. it may only read its params,
+  //the locals its top level vars bind and builtins, so it means the same wherever it's copied
+  //to. a var in a nested block or a read before its var could leave a name unbound that the
+  //real call would have found further out
+  class inline_check
+  {
+  public:
+    inline_check(const fun_literal& literal)
+    {
+      for(const auto& param : literal.parameters)
+        m_locals.insert(param->sym);
+      for(const auto& stmt : literal.body->statements)
+        if(stmt->get_type() == node_type::var)
+          m_declared.insert(std::static_pointer_cast<var>(stmt)->name.sym);
+    }
+
+    bool check_body(const block& body)
+    {
+      for(const auto& stmt : body.statements)
+      {
+        if(stmt->get_type() == node_type::var)
+        {
+          auto var_node = std::static_pointer_cast<var>(stmt);
+          if(!check(var_node->value))
+            return false;
+          m_locals.insert(var_node->name.sym);
+        }
+        else if(!check(stmt))
+          return false;
+      }
+      return true;
+    }
+
+    inline const std::vector<symbol>& get_builtins_used() const
+    {
+      return m_builtins;
+    }
+  private:
+    bool check(const std::shared_ptr<node>& n)
+    {
+      if(!n)
+        return true;
+
+      switch(n->get_type())
+      {
+        case node_type::identifire:
+        {
+          auto sym = std::static_pointer_cast<identifire>(n)->sym;
+          if(m_locals.contains(sym))
+            return true;
+          if(m_declared.contains(sym) || !get_builtins().get(sym).has_value())
+            return false;
+          if(std::find(m_builtins.begin(), m_builtins.end(), sym) == m_builtins.end())
+            m_builtins.push_back(sym);
+          return true;
+        }
+        case node_type::integer:
+        case node_type::floating:
+        case node_type::string:
+        case node_type::boolean:
+        case node_type::constant:
+          return true;
+        case node_type::ret:
+          return check(std::static_pointer_cast<ret>(n)->return_value);
+        case node_type::expression_statement:
+          return check(std::static_pointer_cast<expression_statement>(n)->_expression);
+        case node_type::block:
+        {
+          for(const auto& stmt : std::static_pointer_cast<block>(n)->statements)
+            if(stmt->get_type() == node_type::var || !check(stmt))
+              return false;
+          return true;
+        }
+        case node_type::array:
+        {
+          for(const auto& e : std::static_pointer_cast<array_literal>(n)->elements)
+            if(!check(e))
+              return false;
+          return true;
+        }
+        case node_type::map:
+        {
+          for(const auto& [key, value] : std::static_pointer_cast<map_literal>(n)->pairs)
+            if(!check(key) || !check(value))
+              return false;
+          return true;
+        }
+        case node_type::index:
+        {
+          auto idx = std::static_pointer_cast<index>(n);
+          return check(idx->left) && check(idx->right);
+        }
+        case node_type::prefix:
+          return check(std::static_pointer_cast<prefix>(n)->right);
+        case node_type::infix:
+        {
+          auto inf = std::static_pointer_cast<infix>(n);
+          return check(inf->left) && check(inf->right);
+        }
+        case node_type::_if:
+        {
+          auto if_node = std::static_pointer_cast<_if>(n);
+          return check(if_node->condition) && check(if_node->consequence) && check(if_node->alternative);
+        }
+        case node_type::call:
+        {
+          auto call_node = std::static_pointer_cast<call>(n);
+          if(!check(call_node->function))
+            return false;
+          for(const auto& arg : call_node->arguments)
+            if(!check(arg))
+              return false;
+          return true;
+        }
+        case node_type::intrinsic:
+          return check(std::static_pointer_cast<intrinsic_call>(n)->original);
+        default:
+          return false; //closures, imports and calls already inlined
+      }
+    }
+  private:
+    std::unordered_set<symbol> m_locals;
+    std::unordered_set<symbol> m_declared;
+    std::vector<symbol> m_builtins;
+  };
+
+  //whether what a call returns can only depend on its arguments. the body may read its params
+  //and the locals bound by then, and call builtins and top level functions the same holds for.
+  //those calls are followed to every function they reach, and the names they go through are
+  //what the result depends on besides the arguments
+  class purity_check
+  {
+  public:
+    //a free name to the top level function literal it's bound to with its body loaded
+    using resolver = std::function<std::shared_ptr<fun_literal>(const symbol&)>;
+  public:
+    purity_check(const resolver& resolve)
+      : m_resolve(resolve)
+    {
+    }
+
+    bool check_function(const std::shared_ptr<fun_literal>& root)
+    {
+      m_pending.push_back(root);
+      m_visited.insert(root.get());
+      while(!m_pending.empty())
+      {
+        auto literal = std::move(m_pending.back());
+        m_pending.pop_back();
+        if(!literal->body)
+          return false;
+
+        m_defined.clear();
+        m_declared.clear();
+        for(const auto& param : literal->parameters)
+          m_defined.insert(param->sym);
+        declare(literal->body);
+        if(!check(literal->body))
+          return false;
+      }
+      return true;
+    }
+
+    inline std::vector<memo_dependency>& get_dependencies()
+    {
+      return m_dependencies;
+    }
+  private:
+    //every name a var binds anywhere in the body, a read of one before it's bound would find
+    //whatever the name means outside
+    void declare(const std::shared_ptr<node>& n)
+    {
+      if(!n)
+        return;
+      switch(n->get_type())
+      {
+        case node_type::var:
+          m_declared.insert(std::static_pointer_cast<var>(n)->name.sym);
+          break;
+        case node_type::block:
+        {
+          for(const auto& stmt : std::static_pointer_cast<block>(n)->statements)
+            declare(stmt);
+          break;
+        }
+        case node_type::expression_statement:
+          declare(std::static_pointer_cast<expression_statement>(n)->_expression);
+          break;
+        case node_type::_if:
+        {
+          auto if_node = std::static_pointer_cast<_if>(n);
+          declare(if_node->consequence);
+          declare(if_node->alternative);
+          break;
+        }
+        case node_type::_while:
+          declare(std::static_pointer_cast<_while>(n)->body);
+          break;
+        case node_type::_for:
+          declare(std::static_pointer_cast<_for>(n)->body);
+          break;
+        default:
+          break;
+      }
+    }
+
+    //blocks under an if or a loop may not run, their vars aren't bound after them
+    bool check_nested(const std::shared_ptr<node>& n)
+    {
+      auto saved = m_defined;
+      bool pure = check(n);
+      m_defined = std::move(saved);
+      return pure;
+    }
+
+    bool check(const std::shared_ptr<node>& n)
+    {
+      if(!n)
+        return true;
+
+      switch(n->get_type())
+      {
+        case node_type::identifire:
+          return m_defined.contains(std::static_pointer_cast<identifire>(n)->sym);
+        case node_type::integer:
+        case node_type::floating:
+        case node_type::string:
+        case node_type::boolean:
+        case node_type::constant:
+          return true;
+        case node_type::var:
+        {
+          auto var_node = std::static_pointer_cast<var>(n);
+          if(!check(var_node->value))
+            return false;
+          m_defined.insert(var_node->name.sym);
+          return true;
+        }
+        case node_type::ret:
+          return check(std::static_pointer_cast<ret>(n)->return_value);
+        case node_type::expression_statement:
+          return check(std::static_pointer_cast<expression_statement>(n)->_expression);
+        case node_type::block:
+        {
+          for(const auto& stmt : std::static_pointer_cast<block>(n)->statements)
+            if(!check(stmt))
+              return false;
+          return true;
+        }
+        case node_type::array:
+        {
+          for(const auto& e : std::static_pointer_cast<array_literal>(n)->elements)
+            if(!check(e))
+              return false;
+          return true;
+        }
+        case node_type::map:
+        {
+          for(const auto& [key, value] : std::static_pointer_cast<map_literal>(n)->pairs)
+            if(!check(key) || !check(value))
+              return false;
+          return true;
+        }
+        case node_type::index:
+        {
+          auto idx = std::static_pointer_cast<index>(n);
+          return check(idx->left) && check(idx->right);
+        }
+        case node_type::prefix:
+          return check(std::static_pointer_cast<prefix>(n)->right);
+        case node_type::infix:
+        {
+          auto inf = std::static_pointer_cast<infix>(n);
+          return check(inf->left) && check(inf->right);
+        }
+        case node_type::_if:
+        {
+          auto if_node = std::static_pointer_cast<_if>(n);
+          return check(if_node->condition) && check_nested(if_node->consequence) && check_nested(if_node->alternative);
+        }
+        case node_type::_while:
+        {
+          auto loop = std::static_pointer_cast<_while>(n);
+          return check(loop->condition) && check_nested(loop->body);
+        }
+        case node_type::_for:
+        {
+          auto loop = std::static_pointer_cast<_for>(n);
+          if(!check(loop->iterable))
+            return false;
+          auto saved = m_defined;
+          m_defined.insert(loop->variable.sym);
+          bool pure = check(loop->body);
+          m_defined = std::move(saved);
+          return pure;
+        }
+        case node_type::call:
+        {
+          auto call_node = std::static_pointer_cast<call>(n);
+          return check_callee(call_node->function, nullptr) && check_arguments(call_node->function, call_node->arguments);
+        }
+        case node_type::inlined:
+        {
+          //the copy is the target's body with its names changed, the target is checked instead
+          auto inline_node = std::static_pointer_cast<inlined_call>(n);
+          return check_callee(inline_node->original->function, inline_node->target) && check_arguments(inline_node->original->function, inline_node->original->arguments);
+        }
+        case node_type::intrinsic:
+          return check(std::static_pointer_cast<intrinsic_call>(n)->original);
+        default:
+          return false; //closures and imports
+      }
+    }
+
+    //the function map and the others are given is called too, it's followed like a callee
+    bool check_arguments(const std::shared_ptr<expression>& function, const std::vector<std::shared_ptr<expression>>& args)
+    {
+      bool calls = calls_argument(std::static_pointer_cast<identifire>(function)->sym);
+      for(size_t i = 0; i < args.size(); ++i)
+        if(calls && i == 1 ? !check_callee(args[i], nullptr) : !check(args[i]))
+          return false;
+      return true;
+    }
+
+    //a call to a param or a local could be to anything, only free names are followed
+    bool check_callee(const std::shared_ptr<expression>& function, std::shared_ptr<fun_literal> target)
+    {
+      if(function->get_type() != node_type::identifire)
+        return false;
+      auto ident = std::static_pointer_cast<identifire>(function);
+      if(m_defined.contains(ident->sym) || m_declared.contains(ident->sym))
+        return false;
+
+      if(!target)
+      {
+        if(auto found = get_builtins().get(ident->sym))
+        {
+          if(is_impure_builtin(ident->sym))
+            return false;
+          m_dependencies.push_back({ .name = ident, .builtin = *found });
+          return true;
+        }
+        target = m_resolve(ident->sym);
+        if(!target)
+          return false;
+      }
+
+      m_dependencies.push_back({ .name = ident, .literal = target });
+      if(m_visited.insert(target.get()).second)
+        m_pending.push_back(std::move(target));
+      return true;
+    }
+  private:
+    const resolver& m_resolve;
+    std::vector<std::shared_ptr<fun_literal>> m_pending;
+    std::unordered_set<const fun_literal*> m_visited;
+    std::unordered_set<symbol> m_defined;
+    std::unordered_set<symbol> m_declared;
+    std::vector<memo_dependency> m_dependencies;
+  };
+
+  //copies of what inline_check accepts, with the locals renamed and the caches cleared
+  static std::shared_ptr<expression> clone_expression(const std::shared_ptr<expression>& expr, const renames& names);
+
+  static std::shared_ptr<block> clone_block(const std::shared_ptr<block>& blk, const renames& names);
+
+  static std::shared_ptr<statement> clone_statement(const std::shared_ptr<statement>& stmt, const renames& names)
+  {
+    switch(stmt->get_type())
+    {
+      case node_type::var:
+      {
+        auto copy = std::make_shared<var>(*std::static_pointer_cast<var>(stmt));
+        copy->name.sym = names.names.at(copy->name.sym);
+        copy->name.value = std::string(copy->name.sym.str());
+        copy->value = clone_expression(copy->value, names);
+        return copy;
+      }
+      case node_type::ret:
+      {
+        auto copy = std::make_shared<ret>(*std::static_pointer_cast<ret>(stmt));
+        copy->return_value = clone_expression(copy->return_value, names);
+        return copy;
+      }
+      case node_type::expression_statement:
+      {
+        auto copy = std::make_shared<expression_statement>(*std::static_pointer_cast<expression_statement>(stmt));
+        copy->_expression = clone_expression(copy->_expression, names);
+        return copy;
+      }
+      case node_type::block:
+        return clone_block(std::static_pointer_cast<block>(stmt), names);
+      default:
+        return stmt;
+    }
+  }
+
+  static std::shared_ptr<block> clone_block(const std::shared_ptr<block>& blk, const renames& names)
+  {
+    if(!blk)
+      return blk;
+    auto copy = std::make_shared<block>(*blk);
+    for(auto& stmt : copy->statements)
+      stmt = clone_statement(stmt, names);
+    return copy;
+  }
+
+  static std::shared_ptr<expression> clone_expression(const std::shared_ptr<expression>& expr, const renames& names)
+  {
+    if(!expr)
+      return expr;
+
+    switch(expr->get_type())
+    {
+      case node_type::identifire:
+      {
+        auto sym = std::static_pointer_cast<identifire>(expr)->sym;
+        if(auto value = names.constants.find(sym); value != names.constants.end())
+          return value->second;
+        auto it = names.names.find(sym);
+        if(it == names.names.end())
+          return expr;
+        auto copy = std::make_shared<identifire>(*std::static_pointer_cast<identifire>(expr));
+        copy->sym = it->second;
+        copy->value = std::string(it->second.str());
+        return copy;
+      }
+      case node_type::array:
+      {
+        auto copy = std::make_shared<array_literal>(*std::static_pointer_cast<array_literal>(expr));
+        for(auto& e : copy->elements)
+          e = clone_expression(e, names);
+        return copy;
+      }
+      case node_type::map:
+      {
+        auto copy = std::make_shared<map_literal>(*std::static_pointer_cast<map_literal>(expr));
+        decltype(copy->pairs) pairs;
+        for(const auto& [key, value] : copy->pairs)
+          pairs.emplace(clone_expression(key, names), clone_expression(value, names));
+        copy->pairs = std::move(pairs);
+        copy->record_checked = false;
+        copy->record_shape = nullptr;
+        copy->record_values.clear();
+        return copy;
+      }
+      case node_type::index:
+      {
+        auto copy = std::make_shared<index>(*std::static_pointer_cast<index>(expr));
+        copy->left = clone_expression(copy->left, names);
+        copy->right = clone_expression(copy->right, names);
+        copy->cached_shape = nullptr;
+        return copy;
+      }
+      case node_type::prefix:
+      {
+        auto copy = std::make_shared<prefix>(*std::static_pointer_cast<prefix>(expr));
+        copy->right = clone_expression(copy->right, names);
+        return copy;
+      }
+      case node_type::infix:
+      {
+        auto copy = std::make_shared<infix>(*std::static_pointer_cast<infix>(expr));
+        copy->left = clone_expression(copy->left, names);
+        copy->right = clone_expression(copy->right, names);
+        return copy;
+      }
+      case node_type::_if:
+      {
+        auto copy = std::make_shared<_if>(*std::static_pointer_cast<_if>(expr));
+        copy->condition = clone_expression(copy->condition, names);
+        copy->consequence = clone_block(copy->consequence, names);
+        copy->alternative = clone_block(copy->alternative, names);
+        return copy;
+      }
+      case node_type::call:
+      {
+        auto copy = std::make_shared<call>(*std::static_pointer_cast<call>(expr));
+        copy->function = clone_expression(copy->function, names);
+        for(auto& arg : copy->arguments)
+          arg = clone_expression(arg, names);
+        return copy;
+      }
+      case node_type::intrinsic:
+        return clone_expression(std::static_pointer_cast<intrinsic_call>(expr)->original, names);
+      default:
+        return expr; //literals and constants are never changed, the copy can share them
+    }
+  }
+
+  //the value an expression always has, nullptr if it depends on anything
+  static std::shared_ptr<object> constant_value(const std::shared_ptr<expression>& expr)
+  {
+    switch(expr->get_type())
+    {
+      case node_type::constant:
+        return std::static_pointer_cast<constant>(expr)->value;
+      case node_type::integer:
+        return std::static_pointer_cast<integer_literal>(expr)->pooled;
+      case node_type::floating:
+        return std::static_pointer_cast<float_literal>(expr)->pooled;
+      case node_type::string:
+        return std::static_pointer_cast<string_literal>(expr)->pooled;
+      case node_type::boolean:
+        return to_boolean(std::static_pointer_cast<boolean_literal>(expr)->value);
+      default:
+        return nullptr;
+    }
+  }
+
+  void optimizer::optimize(const std::shared_ptr<program>& prog)
+  {
+    if(!m_enabled || !prog)
+      return;
+    //calls in bodies that come before a function's var can be inlined too
+    for(const auto& stmt : prog->m_statements)
+      if(stmt->get_type() == node_type::var)
+        bind(std::static_pointer_cast<var>(stmt)->name.sym, std::static_pointer_cast<var>(stmt)->value);
+    for(const auto& stmt : prog->m_statements)
+      optimize(stmt);
+  }
+
+  void optimizer::optimize(const std::shared_ptr<statement>& stmt)
+  {
+    if(!m_enabled || !stmt)
+      return;
+
+    switch(stmt->get_type())
+    {
+      case node_type::var:
+      {
+        auto var_node = std::static_pointer_cast<var>(stmt);
+        var_node->value = rewrite(var_node->value);
+        if(m_nesting == 0)
+          bind(var_node->name.sym, var_node->value);
+        break;
+      }
+      case node_type::ret:
+      {
+        auto ret_node = std::static_pointer_cast<ret>(stmt);
+        ret_node->return_value = rewrite(ret_node->return_value);
+        break;
+      }
+      case node_type::expression_statement:
+      {
+        auto exp_stmt = std::static_pointer_cast<expression_statement>(stmt);
+        exp_stmt->_expression = rewrite(exp_stmt->_expression);
+        break;
+      }
+      case node_type::block:
+        optimize(std::static_pointer_cast<block>(stmt));
+        break;
+      default:
+        break;
+    }
+  }
+
+  void optimizer::optimize(const std::shared_ptr<block>& blk)
+  {
+    if(!m_enabled || !blk)
+      return;
+    ++m_nesting;
+    for(const auto& stmt : blk->statements)
+      optimize(stmt);
+    --m_nesting;
+  }
+
+  //an expression that can't do anything but compute a value out of names and literals
+  static bool is_plain(const std::shared_ptr<expression>& expr)
+  {
+    switch(expr->get_type())
+    {
+      case node_type::identifire:
+      case node_type::integer:
+      case node_type::floating:
+      case node_type::string:
+      case node_type::boolean:
+      case node_type::constant:
+        return true;
+      case node_type::prefix:
+        return is_plain(std::static_pointer_cast<prefix>(expr)->right);
+      case node_type::infix:
+      {
+        auto inf = std::static_pointer_cast<infix>(expr);
+        return is_plain(inf->left) && is_plain(inf->right);
+      }
+      case node_type::index:
+      {
+        auto idx = std::static_pointer_cast<index>(expr);
+        return is_plain(idx->left) && is_plain(idx->right);
+      }
+      default:
+        return false;
+    }
+  }
+
+  //a call through a name with plain arguments. it may run as a fork next to others like it, if
+  //the name holds a pure function once it's called
+  static bool is_fork_call(const std::shared_ptr<expression>& expr)
+  {
+    std::shared_ptr<call> call_node;
+    if(expr->get_type() == node_type::call)
+      call_node = std::static_pointer_cast<call>(expr);
+    else if(expr->get_type() == node_type::inlined)
+      call_node = std::static_pointer_cast<inlined_call>(expr)->original;
+    else
+      return false;
+    if(call_node->function->get_type() != node_type::identifire)
+      return false;
+    return std::all_of(call_node->arguments.begin(), call_node->arguments.end(), is_plain);
+  }
+
+  std::shared_ptr<expression> optimizer::rewrite(const std::shared_ptr<expression>& expr)
+  {
+    if(!expr)
+      return expr;
+
+    switch(expr->get_type())
+    {
+      case node_type::integer:
+      {
+        auto int_node = std::static_pointer_cast<integer_literal>(expr);
+        if(!int_node->pooled)
+        {
+          int_node->pooled = std::make_shared<integer>(int_node->value);
+          ++m_stats.pooled;
+        }
+        return expr;
+      }
+      case node_type::floating:
+      {
+        auto float_node = std::static_pointer_cast<float_literal>(expr);
+        if(!float_node->pooled)
+        {
+          float_node->pooled = std::make_shared<floating>(float_node->value);
+          ++m_stats.pooled;
+        }
+        return expr;
+      }
+      case node_type::string:
+      {
+        auto string_node = std::static_pointer_cast<string_literal>(expr);
+        if(!string_node->pooled)
+        {
+          string_node->pooled = std::make_shared<string>(string_node->buffer, 0, string_node->buffer->size());
+          ++m_stats.pooled;
+        }
+        return expr;
+      }
+      case node_type::array:
+      {
+        auto arr_node = std::static_pointer_cast<array_literal>(expr);
+        size_t calls = 0;
+        bool plain = true;
+        for(auto& e : arr_node->elements)
+        {
+          e = rewrite(e);
+          if(is_fork_call(e))
+            ++calls;
+          else
+            plain = plain && is_plain(e);
+        }
+        arr_node->fork = plain && calls > 1;
+        return expr;
+      }
+      case node_type::map:
+      {
+        //string literal keys stay literals, rewrite leaves them in place so records still work
+        auto map_node = std::static_pointer_cast<map_literal>(expr);
+        decltype(map_node->pairs) pairs;
+        for(const auto& [key, value] : map_node->pairs)
+          pairs.emplace(rewrite(key), rewrite(value));
+        map_node->pairs = std::move(pairs);
+        map_node->record_checked = false;
+        map_node->record_shape = nullptr;
+        map_node->record_values.clear();
+        return expr;
+      }
+      case node_type::index:
+      {
+        auto index_node = std::static_pointer_cast<index>(expr);
+        index_node->left = rewrite(index_node->left);
+        index_node->right = rewrite(index_node->right);
+        return expr;
+      }
+      case node_type::prefix:
+      {
+        auto prefix_node = std::static_pointer_cast<prefix>(expr);
+        prefix_node->right = rewrite(prefix_node->right);
+
+        auto right = constant_value(prefix_node->right);
+        if(!right)
+          return expr;
+        return fold(expr, eval_prefix_expression(prefix_node->op, right), prefix_node->_token);
+      }
+      case node_type::infix:
+      {
+        auto infix_node = std::static_pointer_cast<infix>(expr);
+        infix_node->left = rewrite(infix_node->left);
+        infix_node->right = rewrite(infix_node->right);
+
+        auto left = constant_value(infix_node->left);
+        auto right = left ? constant_value(infix_node->right) : nullptr;
+        if(!right)
+        {
+          infix_node->fork = is_fork_call(infix_node->left) && is_fork_call(infix_node->right);
+          return expr;
+        }
+        return fold(expr, eval_infix_expression(infix_node->op, left, right), infix_node->_token);
+      }
+      case node_type::_if:
+        return rewrite_if(std::static_pointer_cast<_if>(expr));
+      case node_type::_while:
+      {
+        auto loop = std::static_pointer_cast<_while>(expr);
+        loop->condition = rewrite(loop->condition);
+        optimize(loop->body);
+
+        auto cond = constant_value(loop->condition);
+        if(!cond || to_boolean(cond)->get_value())
+          return expr;
+        ++m_stats.pruned;
+        m_stats.removed += count_nodes(expr) - 1;
+        return std::make_shared<constant>(loop->_token, get_null(), "null");
+      }
+      case node_type::_for:
+      {
+        auto loop = std::static_pointer_cast<_for>(expr);
+        loop->iterable = rewrite(loop->iterable);
+        optimize(loop->body);
+        return expr;
+      }
+      case node_type::fun:
+      {
+        optimize(std::static_pointer_cast<fun_literal>(expr)->body);
+        return expr;
+      }
+      case node_type::call:
+      {
+        auto call_node = std::static_pointer_cast<call>(expr);
+        call_node->function = rewrite(call_node->function);
+        for(auto& arg : call_node->arguments)
+          arg = rewrite(arg);
+        if(call_node->function->get_type() != node_type::identifire)
+          return expr;
+        if(m_inline_budget)
+          if(auto inlined = inline_call(call_node); inlined != call_node)
+            return inlined;
+        if(m_intrinsics)
+          return bind_intrinsic(call_node);
+        return expr;
+      }
+      default:
+        return expr;
+    }
+  }
+
+  std::shared_ptr<expression> optimizer::rewrite_if(const std::shared_ptr<_if>& expr)
+  {
+    expr->condition = rewrite(expr->condition);
+    optimize(expr->consequence);
+    optimize(expr->alternative);
+
+    auto cond = constant_value(expr->condition);
+    if(!cond)
+      return expr;
+
+    if(to_boolean(cond)->get_value())
+    {
+      if(expr->alternative)
+      {
+        m_stats.removed += count_nodes(expr->alternative);
+        expr->alternative = nullptr;
+        ++m_stats.pruned;
+      }
+      return expr;
+    }
+
+    ++m_stats.pruned;
+    if(!expr->alternative)
+    {
+      m_stats.removed += count_nodes(expr) - 1;
+      return std::make_shared<constant>(expr->_token, get_null(), "null");
+    }
+
+    //the else block runs in place of the then block behind a condition that's always true
+    m_stats.removed += count_nodes(expr->consequence) + count_nodes(expr->condition) - 1;
+    expr->condition = std::make_shared<constant>(expr->_token, to_boolean(true), "true");
+    expr->consequence = expr->alternative;
+    expr->alternative = nullptr;
+    return expr;
+  }
+
+  std::shared_ptr<expression> optimizer::fold(const std::shared_ptr<expression>& expr, const std::shared_ptr<object>& value, const token& tok)
+  {
+    if(!value || value->get_type() == object_type::error)
+      return expr;
+
+    m_stats.removed += count_nodes(expr) - 1;
+    ++m_stats.folded;
+    return std::make_shared<constant>(tok, value, value->inspect());
+  }
+
+  void optimizer::bind(const symbol& name, const std::shared_ptr<expression>& value)
+  {
+    if(!value || value->get_type() != node_type::fun)
+    {
+      m_candidates.erase(name);
+      return;
+    }
+
+    auto literal = std::static_pointer_cast<fun_literal>(value);
+    auto& cand = m_candidates[name];
+    if(cand.literal != literal)
+      cand = { .literal = literal };
+  }
+
+  std::shared_ptr<expression> optimizer::inline_call(const std::shared_ptr<call>& call_node)
+  {
+    auto it = m_candidates.find(std::static_pointer_cast<identifire>(call_node->function)->sym);
+    if(it == m_candidates.end())
+      return call_node;
+
+    auto& cand = it->second;
+    auto literal = cand.literal;
+    if(!cand.checked)
+    {
+      //set first, a body that calls itself sees a candidate that isn't inlinable
+      cand.checked = true;
+      load(literal);
+
+      if(literal->body && !literal->body->statements.empty() && count_nodes(literal->body) <= m_inline_budget)
+      {
+        inline_check check(*literal);
+        cand.inlinable = check.check_body(*literal->body);
+        cand.builtins = check.get_builtins_used();
+      }
+    }
+    if(!cand.inlinable || call_node->arguments.size() != literal->parameters.size())
+      return call_node;
+
+    //each call site gets its own names so copies that end up in one function keep their locals apart.
+    //a constant argument is put where the param is read, then it folds with the body
+    auto site = std::to_string(++m_inline_sites);
+    renames names;
+    auto local = [&](const symbol& sym) { names.names.try_emplace(sym, intern(std::string(sym.str()) + "@" + site)); };
+    for(const auto& stmt : literal->body->statements)
+      if(stmt->get_type() == node_type::var)
+        local(std::static_pointer_cast<var>(stmt)->name.sym);
+
+    auto node = std::make_shared<inlined_call>(call_node, literal);
+    for(size_t i = 0; i < literal->parameters.size(); ++i)
+    {
+      auto sym = literal->parameters[i]->sym;
+      const auto& arg = call_node->arguments[i];
+      if(constant_value(arg) && !names.names.contains(sym) && !names.constants.contains(sym))
+        names.constants.emplace(sym, arg);
+      else
+      {
+        names.constants.erase(sym); //a param named twice takes the last argument
+        local(sym);
+        node->parameters.emplace_back(i, names.names.at(sym));
+      }
+    }
+    node->body = clone_block(literal->body, names);
+    node->builtins = cand.builtins;
+    optimize(node->body);
+    ++m_stats.inlined;
+    return node;
+  }
+
+  void optimizer::load(const std::shared_ptr<fun_literal>& literal)
+  {
+    if(literal->body)
+      return;
+    if(literal->load_body)
+      literal->body = literal->load_body();
+    else if(!literal->body_source.empty())
+    {
+      parser::errors errs;
+      literal->body = parser::parse_fun_body(literal->body_source, errs);
+    }
+    optimize(literal->body);
+  }
+
+  void optimizer::specialize(const std::shared_ptr<fun_literal>& literal)
+  {
+    //set first, a body that calls itself is typed by the compiler, not through here
+    literal->specialize_checked = true;
+    if(!m_enabled || !m_specialize)
+      return;
+    //the compiled code calls itself without the cache, that would undo what the cache saves
+    if(m_auto_memo && !literal->memo_checked)
+      memoize(literal);
+    if(literal->memo)
+      return;
+    load(literal);
+
+    auto resolve = [this](const symbol& sym) -> std::shared_ptr<fun_literal> {
+      auto it = m_candidates.find(sym);
+      if(it == m_candidates.end())
+        return nullptr;
+      //a copy, specializing the callee can bind more candidates
+      auto callee = it->second.literal;
+      if(!callee->specialize_checked)
+        specialize(callee);
+      return callee;
+    };
+    literal->specialized = specialize_function(*literal, resolve);
+    if(!literal->specialized)
+      return;
+
+    ++m_stats.specialized;
+    m_specialized.push_back(name_of(literal));
+  }
+
+  bool optimizer::is_pure(const std::shared_ptr<fun_literal>& literal, std::vector<memo_dependency>* dependencies)
+  {
+    load(literal);
+    purity_check::resolver resolve = [this](const symbol& sym) -> std::shared_ptr<fun_literal> {
+      auto it = m_candidates.find(sym);
+      if(it == m_candidates.end())
+        return nullptr;
+      auto callee = it->second.literal;
+      load(callee);
+      return callee;
+    };
+    purity_check check(resolve);
+    if(!check.check_function(literal))
+      return false;
+    if(!literal->pure_counted)
+    {
+      literal->pure_counted = true;
+      ++m_stats.pure;
+      m_pure.push_back(name_of(literal));
+    }
+    if(!dependencies)
+      return true;
+
+    //a name called from several places is checked once
+    dependencies->clear();
+    for(auto& dep : check.get_dependencies())
+    {
+      bool seen = false;
+      for(const auto& other : *dependencies)
+        seen = seen || (other.name->sym == dep.name->sym && other.builtin == dep.builtin && !other.literal.owner_before(dep.literal) && !dep.literal.owner_before(other.literal));
+      if(!seen)
+        dependencies->push_back(std::move(dep));
+    }
+    return true;
+  }
+
+  void optimizer::memoize(const std::shared_ptr<fun_literal>& literal)
+  {
+    literal->memo_checked = true;
+    if(!m_enabled || !m_auto_memo)
+      return;
+
+    std::vector<memo_dependency> dependencies;
+    if(!is_pure(literal, &dependencies))
+      return;
+
+    literal->memo = std::make_shared<memo_table>(m_memo_capacity, std::move(dependencies));
+    ++m_stats.memoized;
+    m_memoized.push_back({ name_of(literal), literal->memo });
+  }
+
+  void optimizer::plan_fork(const std::shared_ptr<fun_literal>& literal)
+  {
+    literal->fork_checked = true;
+    if(!m_enabled)
+      return;
+
+    std::vector<memo_dependency> dependencies;
+    if(!is_pure(literal, &dependencies))
+      return;
+    literal->fork = std::make_shared<fork_plan>(fork_plan{ std::move(dependencies) });
+    ++m_stats.forkable;
+  }
+
+  std::string optimizer::name_of(const std::shared_ptr<fun_literal>& literal) const
+  {
+    for(const auto& [sym, cand] : m_candidates)
+      if(cand.literal == literal)
+        return std::string(sym.str());
+    return "fun";
+  }
+
+  std::shared_ptr<expression> optimizer::bind_intrinsic(const std::shared_ptr<call>& call_node)
+  {
+    auto name = std::static_pointer_cast<identifire>(call_node->function)->sym;
+    if(!name.is_builtin() || name.is_shadowed())
+      return call_node;
+
+    auto target = get_builtins().get(name);
+    if(!target.has_value() || !static_cast<builtin*>(target->get())->accepts(call_node->arguments.size()))
+      return call_node;
+
+    ++m_stats.intrinsics;
+    return std::make_shared<intrinsic_call>(call_node, name, *target);
+  }
+
+  optimizer& get_optimizer()
+  {
+    static optimizer s_optimizer;
+    return s_optimizer;
+  }
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "ast.hpp"
+#include "memo.hpp"
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace my_ns
+{
+  //rewrites the tree between parse and eval. operators on constants are folded with the
+  //evaluator's own functions so a folded result is exactly what eval would make, literals
+  //get their runtime object made once and ifs with a constant condition lose the dead branch.
+  //anything that would be an error at runtime is left for the runtime. calls to small top
+  //level functions are replaced with a copy of their body, calls to builtins are bound to them.
+  //functions that only ever compute integers are compiled to unboxed code on their first call,
+  //and pure ones can be given a cache of their results. calls side by side in an operator or an
+  //array literal are marked so they can run as forks when they turn out to be pure
+  class optimizer
+  {
+  public:
+    struct stats
+    {
+      size_t folded = 0; //expressions turned into constants
+      size_t pruned = 0; //if branches that can never run
+      size_t pooled = 0; //literals whose object is made once
+      size_t removed = 0; //nodes gone from the tree
+      size_t inlined = 0; //calls replaced with the callee's body
+      size_t intrinsics = 0; //calls bound to a builtin
+      size_t specialized = 0; //functions compiled to unboxed integer code
+      size_t pure = 0; //functions whose result only depends on their arguments
+      size_t memoized = 0; //pure functions given a cache
+      size_t forkable = 0; //pure functions whose calls may run as forks
+    };
+  public:
+    void optimize(const std::shared_ptr<program>& prog);
+    void optimize(const std::shared_ptr<statement>& stmt);
+    //fun bodies that were skipped or not built yet go through here once they are
+    void optimize(const std::shared_ptr<block>& blk);
+
+    inline bool enabled() const
+    {
+      return m_enabled;
+    }
+    inline void set_enabled(bool on)
+    {
+      m_enabled = on;
+    }
+    inline const stats& get_stats() const
+    {
+      return m_stats;
+    }
+    //the most nodes a body may have to be inlined, 0 turns inlining off
+    inline void set_inline_budget(size_t nodes)
+    {
+      m_inline_budget = nodes;
+    }
+    inline size_t inline_budget() const
+    {
+      return m_inline_budget;
+    }
+    inline void set_intrinsics(bool on)
+    {
+      m_intrinsics = on;
+    }
+    inline void set_specialize(bool on)
+    {
+      m_specialize = on;
+    }
+    inline const std::vector<std::string>& get_specialized_names() const
+    {
+      return m_specialized;
+    }
+    //compiles the literal's body for integer arguments if every value in it is provably an
+    //integer or a boolean, called once per literal on its first call
+    void specialize(const std::shared_ptr<fun_literal>& literal);
+
+    //pure functions get a cache of their results on their first call, off by default
+    inline void set_auto_memo(bool on)
+    {
+      m_auto_memo = on;
+    }
+    inline void set_memo_capacity(size_t entries)
+    {
+      m_memo_capacity = entries;
+    }
+    //whether a call's result can only depend on its arguments. the free names the calls in
+    //it go through, followed into every function they reach, go to dependencies
+    bool is_pure(const std::shared_ptr<fun_literal>& literal, std::vector<memo_dependency>* dependencies = nullptr);
+    //gives the literal a cache if it's pure, called once per literal on its first call
+    void memoize(const std::shared_ptr<fun_literal>& literal);
+    //lets calls to the literal run as forks if it's pure, called once per literal the first
+    //time a call to it could be forked
+    void plan_fork(const std::shared_ptr<fun_literal>& literal);
+
+    struct memoized_function
+    {
+      std::string name;
+      std::shared_ptr<memo_table> table;
+    };
+    inline const std::vector<std::string>& get_pure_names() const
+    {
+      return m_pure;
+    }
+    inline const std::vector<memoized_function>& get_memoized() const
+    {
+      return m_memoized;
+    }
+  private:
+    std::shared_ptr<expression> rewrite(const std::shared_ptr<expression>& expr);
+    std::shared_ptr<expression> rewrite_if(const std::shared_ptr<_if>& expr);
+    std::shared_ptr<expression> fold(const std::shared_ptr<expression>& expr, const std::shared_ptr<object>& value, const token& tok);
+
+    //a top level var, its function is what later calls to the name are inlined from
+    void bind(const symbol& name, const std::shared_ptr<expression>& value);
+    std::shared_ptr<expression> inline_call(const std::shared_ptr<call>& call_node);
+    std::shared_ptr<expression> bind_intrinsic(const std::shared_ptr<call>& call_node);
+    //builds and optimizes a body that was skipped or not built from the flat ast yet
+    void load(const std::shared_ptr<fun_literal>& literal);
+    //the top level name it's bound to, for reports
+    std::string name_of(const std::shared_ptr<fun_literal>& literal) const;
+  private:
+    struct candidate
+    {
+      std::shared_ptr<fun_literal> literal;
+      bool checked = false; //the body is only looked at once a call to it is seen
+      bool inlinable = false;
+      std::vector<symbol> builtins = {};
+    };
+  private:
+    bool m_enabled = true;
+    stats m_stats;
+    size_t m_inline_budget = 32;
+    bool m_intrinsics = true;
+    bool m_specialize = true;
+    std::vector<std::string> m_specialized; //names of the functions specialize compiled
+    bool m_auto_memo = false;
+    size_t m_memo_capacity = default_memo_capacity;
+    std::vector<std::string> m_pure; //names of the functions is_pure found pure, each once
+    std::vector<memoized_function> m_memoized;
+    size_t m_nesting = 0; //blocks entered, 0 is the top level
+    size_t m_inline_sites = 0;
+    //a name bound again replaces its candidate, calls check at runtime they still hold it
+    std::unordered_map<symbol, candidate> m_candidates;
+  };
+
+  //the one the runner, the repl and lazily loaded fun bodies go through
+  optimizer& get_optimizer();
+}
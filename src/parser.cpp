@@ -2,6 +2,7 @@
 #include "ast.hpp"
 #include "token.hpp"
 
+#include <charconv>
 #include <iostream>
 #include <memory>
 #include <string>
@@ -11,44 +12,63 @@
 
 namespace my_ns
 {
-  parser::parser(lexer* l)
-    : m_lexer(l)
+  parser::parser(lexer* l, bool lazy_bodies)
+    : m_lexer(l), m_lazy_bodies(lazy_bodies)
   {
     next_token();
     next_token();
+  }
 
-    const auto prefix_fun = [this]() -> auto { return parse_prefix(); };
-    const auto infix_fun  = [this](const auto& expr) -> auto { return parse_infix(expr); };
-    const auto boolean_fun = [this]() -> auto { return parse_boolean(); };
-
-    //prefix
-    m_prefix_funs[token_type::identifire] = [this]() -> auto { return parse_identifire(); };
-    m_prefix_funs[token_type::integer]    = [this]() -> auto { return parse_integer_literal(); };
-    m_prefix_funs[token_type::string]     = [this]() -> auto { return parse_string_literal(); };
-    m_prefix_funs[token_type::l_paren]    = [this]() -> auto { return parse_grouped(); };
-    m_prefix_funs[token_type::_if]        = [this]() -> auto { return parse_if(); };
-    m_prefix_funs[token_type::fun]        = [this]() -> auto { return parse_fun_literal(); };
-    m_prefix_funs[token_type::l_bracket]  = [this]() -> auto { return parse_open_bracket(); };
-    m_prefix_funs[token_type::l_brace]    = [this]() -> auto { return parse_open_brace(); };
-
-    m_prefix_funs[token_type::bang]       = prefix_fun;
-    m_prefix_funs[token_type::minus]      = prefix_fun;
-    m_prefix_funs[token_type::_true]      = boolean_fun;
-    m_prefix_funs[token_type::_false]     = boolean_fun;
-
-    //infix
-    m_infix_funs[token_type::equal]     = infix_fun;
-    m_infix_funs[token_type::not_equal] = infix_fun;
-    m_infix_funs[token_type::less]      = infix_fun;
-    m_infix_funs[token_type::greater]   = infix_fun;
-    m_infix_funs[token_type::plus]      = infix_fun;
-    m_infix_funs[token_type::minus]     = infix_fun;
-    m_infix_funs[token_type::astrisk]   = infix_fun;
-    m_infix_funs[token_type::slash]     = infix_fun;
-    m_infix_funs[token_type::l_paren]   = [this](const auto& expr) -> auto { return parse_call(expr); };
-    m_infix_funs[token_type::l_bracket] = [this](const auto& expr) -> auto { return parse_index(expr); };
+  //dispatch tables indexed by token type, built at compile time
+  constexpr std::array<parser::prefix_parse_fun, token_type_count> parser::make_prefix_table()
+  {
+    std::array<prefix_parse_fun, token_type_count> table{};
+    const auto set = [&table](token_type t, prefix_parse_fun fn) { table[static_cast<size_t>(t)] = fn; };
+
+    set(token_type::identifire, [](parser& p) -> std::shared_ptr<expression> { return p.parse_identifire(); });
+    set(token_type::integer,    [](parser& p) -> std::shared_ptr<expression> { return p.parse_integer_literal(); });
+    set(token_type::floating,   [](parser& p) -> std::shared_ptr<expression> { return p.parse_float_literal(); });
+    set(token_type::string,     [](parser& p) -> std::shared_ptr<expression> { return p.parse_string_literal(); });
+    set(token_type::l_paren,    [](parser& p) -> std::shared_ptr<expression> { return p.parse_grouped(); });
+    set(token_type::_if,        [](parser& p) -> std::shared_ptr<expression> { return p.parse_if(); });
+    set(token_type::fun,        [](parser& p) -> std::shared_ptr<expression> { return p.parse_fun_literal(); });
+    set(token_type::l_bracket,  [](parser& p) -> std::shared_ptr<expression> { return p.parse_open_bracket(); });
+    set(token_type::l_brace,    [](parser& p) -> std::shared_ptr<expression> { return p.parse_open_brace(); });
+    set(token_type::_import,    [](parser& p) -> std::shared_ptr<expression> { return p.parse_import(); });
+    set(token_type::_while,     [](parser& p) -> std::shared_ptr<expression> { return p.parse_while(); });
+    set(token_type::_for,       [](parser& p) -> std::shared_ptr<expression> { return p.parse_for(); });
+
+    const prefix_parse_fun prefix_fun = [](parser& p) -> std::shared_ptr<expression> { return p.parse_prefix(); };
+    const prefix_parse_fun boolean_fun = [](parser& p) -> std::shared_ptr<expression> { return p.parse_boolean(); };
+    set(token_type::bang,   prefix_fun);
+    set(token_type::minus,  prefix_fun);
+    set(token_type::_true,  boolean_fun);
+    set(token_type::_false, boolean_fun);
+    return table;
+  }
+
+  constexpr std::array<parser::infix_parse_fun, token_type_count> parser::make_infix_table()
+  {
+    std::array<infix_parse_fun, token_type_count> table{};
+    const auto set = [&table](token_type t, infix_parse_fun fn) { table[static_cast<size_t>(t)] = fn; };
+
+    const infix_parse_fun infix_fun = [](parser& p, const std::shared_ptr<expression>& expr) -> std::shared_ptr<expression> { return p.parse_infix(expr); };
+    set(token_type::equal,     infix_fun);
+    set(token_type::not_equal, infix_fun);
+    set(token_type::less,      infix_fun);
+    set(token_type::greater,   infix_fun);
+    set(token_type::plus,      infix_fun);
+    set(token_type::minus,     infix_fun);
+    set(token_type::astrisk,   infix_fun);
+    set(token_type::slash,     infix_fun);
+    set(token_type::l_paren,   [](parser& p, const std::shared_ptr<expression>& expr) -> std::shared_ptr<expression> { return p.parse_call(expr); });
+    set(token_type::l_bracket, [](parser& p, const std::shared_ptr<expression>& expr) -> std::shared_ptr<expression> { return p.parse_index(expr); });
+    return table;
   }
 
+  constinit const std::array<parser::prefix_parse_fun, token_type_count> parser::s_prefix_funs = parser::make_prefix_table();
+  constinit const std::array<parser::infix_parse_fun, token_type_count> parser::s_infix_funs = parser::make_infix_table();
+
   void parser::next_token()
   {
     m_current_token = m_peek_token;
@@ -70,6 +90,18 @@ namespace my_ns
     return prog;
   }
 
+  std::shared_ptr<statement> parser::parse_next_statement()
+  {
+    while(m_current_token.type != token_type::eof)
+    {
+      auto stmt = parse_statement();
+      next_token();
+      if(stmt)
+        return stmt;
+    }
+    return nullptr;
+  }
+
   std::shared_ptr<statement> parser::parse_statement()
   {
     switch(m_current_token.type)
@@ -127,24 +159,23 @@ namespace my_ns
 
   std::shared_ptr<expression> parser::parse_expression(precedence p)
   {
-    const auto& it = m_prefix_funs.find(m_current_token.type);
-    if(it == m_prefix_funs.end())
+    auto prefix = s_prefix_funs[static_cast<size_t>(m_current_token.type)];
+    if(!prefix)
     {
       no_prefix_parse_fun_error(m_current_token.type);
       return nullptr;
     }
 
-    const auto& prefix = it->second;
-    auto left_expr = prefix();
+    auto left_expr = prefix(*this);
 
     while(m_peek_token.type != token_type::semicolon && (p < get_precedence(m_peek_token.type)))
     {
-      const auto& in_it = m_infix_funs.find(m_peek_token.type);
-      if(in_it == m_infix_funs.end())
+      auto infix = s_infix_funs[static_cast<size_t>(m_peek_token.type)];
+      if(!infix)
         return left_expr;
 
       next_token();
-      left_expr = in_it->second(left_expr);
+      left_expr = infix(*this, left_expr);
     }
     return left_expr;
   }
@@ -169,11 +200,30 @@ namespace my_ns
   {
     auto int_lit = std::make_shared<integer_literal>(m_current_token);
 
-    auto _int = std::stol(m_current_token.literal); //TODO: error handleing
-    int_lit->value = _int;
+    const auto& lit = m_current_token.literal;
+    auto [_, ec] = std::from_chars(lit.data(), lit.data() + lit.size(), int_lit->value);
+    if(ec != std::errc())
+    {
+      m_errors.emplace_back("could not parse: '" + std::string(lit) + "' as integer.");
+      return nullptr;
+    }
     return int_lit;
   }
 
+  std::shared_ptr<float_literal> parser::parse_float_literal()
+  {
+    auto float_lit = std::make_shared<float_literal>(m_current_token);
+
+    const auto& lit = m_current_token.literal;
+    auto [_, ec] = std::from_chars(lit.data(), lit.data() + lit.size(), float_lit->value);
+    if(ec != std::errc())
+    {
+      m_errors.emplace_back("could not parse: '" + std::string(lit) + "' as float.");
+      return nullptr;
+    }
+    return float_lit;
+  }
+
   std::shared_ptr<string_literal> parser::parse_string_literal()
   {
     return std::make_shared<string_literal>(m_current_token, m_current_token.literal);
@@ -251,9 +301,52 @@ namespace my_ns
     return if_expr;
   }
 
+  std::shared_ptr<_while> parser::parse_while()
+  {
+    auto loop = std::make_shared<_while>(m_current_token);
+    if(!expect_next(token_type::l_paren))
+      return nullptr;
+
+    next_token();
+    loop->condition = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_paren))
+      return nullptr;
+    if(!expect_next(token_type::l_brace))
+      return nullptr;
+
+    loop->body = parse_block();
+    return loop;
+  }
+
+  std::shared_ptr<_for> parser::parse_for()
+  {
+    auto loop = std::make_shared<_for>(m_current_token);
+    if(!expect_next(token_type::l_paren))
+      return nullptr;
+    if(!expect_next(token_type::identifire))
+      return nullptr;
+
+    loop->variable = { m_current_token, m_current_token.literal };
+    if(!expect_next(token_type::_in))
+      return nullptr;
+
+    next_token();
+    loop->iterable = parse_expression(precedence::lowest);
+
+    if(!expect_next(token_type::r_paren))
+      return nullptr;
+    if(!expect_next(token_type::l_brace))
+      return nullptr;
+
+    loop->body = parse_block();
+    return loop;
+  }
+
   std::shared_ptr<fun_literal> parser::parse_fun_literal()
   {
     auto fun = std::make_shared<fun_literal>(m_current_token);
+    ++m_fun_literals;
     if(!expect_next(token_type::l_paren))
       return nullptr;
 
@@ -261,10 +354,57 @@ namespace my_ns
     if(!expect_next(token_type::l_brace)) //support for non block blocks
       return nullptr;
 
-    fun->body = parse_block();
+    auto start = m_current_token.literal.data();
+    if(!m_lazy_bodies)
+      fun->body = parse_block();
+    else if(skip_block())
+      fun->body_source = { start, static_cast<size_t>(m_current_token.literal.data() + 1 - start) };
+    else
+      return nullptr;
+
+    if(m_current_token.type == token_type::r_brace)
+      fun->source = { fun->_token.literal.data(), static_cast<size_t>(m_current_token.literal.data() + 1 - fun->_token.literal.data()) };
     return fun;
   }
 
+  std::shared_ptr<import_expression> parser::parse_import()
+  {
+    if(!expect_next(token_type::string))
+      return nullptr;
+
+    auto import_expr = std::make_shared<import_expression>(m_current_token, m_current_token.literal);
+    m_imports.push_back(import_expr);
+    return import_expr;
+  }
+
+  //from a '{' to its matching '}' without making tokens, the lexer scans for braces
+  //starting at the token after the '{' it already read ahead
+  bool parser::skip_block()
+  {
+    if(m_peek_token.type != token_type::r_brace)
+    {
+      if(m_peek_token.type == token_type::eof || !m_lexer->skip_to_closing_brace(m_peek_token.offset))
+      {
+        m_errors.emplace_back("unterminated function body.");
+        return false;
+      }
+      m_peek_token = m_lexer->next_token();
+    }
+    next_token();
+    return true;
+  }
+
+  std::shared_ptr<block> parser::parse_fun_body(std::string_view body_source, errors& errs)
+  {
+    lexer lx(body_source);
+    parser ps(&lx, true);
+    auto body = ps.parse_block();
+    errs = ps.get_errors();
+    if(!errs.empty())
+      return nullptr;
+    return body;
+  }
+
   std::vector<std::shared_ptr<identifire>> parser::parse_fun_params()
   {
     std::vector<std::shared_ptr<identifire>> ids;
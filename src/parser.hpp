@@ -3,10 +3,10 @@
 #include "lexer.hpp"
 #include "ast.hpp"
 #include "token.hpp"
-#include <cmath>
-#include <functional>
+#include <array>
 #include <memory>
-#include <unordered_map>
+#include <string>
+#include <vector>
 
 //TODO: solve the shared ptr problem i don't think every thing have to be shared!
 
@@ -16,8 +16,8 @@ namespace my_ns
   {
   public:
     using errors = std::vector<std::string>;
-    using prefix_parse_fun = std::function<std::shared_ptr<expression>(void)>;
-    using infix_parse_fun = std::function<std::shared_ptr<expression>(const std::shared_ptr<expression>& expr)>;
+    using prefix_parse_fun = std::shared_ptr<expression>(*)(parser&);
+    using infix_parse_fun = std::shared_ptr<expression>(*)(parser&, const std::shared_ptr<expression>& expr);
 
     enum class precedence
     {
@@ -31,12 +31,35 @@ namespace my_ns
       index // arr[idx]
     };
   public:
-    parser(lexer* l);
+    //lazy_bodies only balances the braces of fun bodies and keeps their text
+    parser(lexer* l, bool lazy_bodies = false);
     std::shared_ptr<program> parse_program();
+    //parse a body skipped in lazy mode, nested bodies stay lazy
+    static std::shared_ptr<block> parse_fun_body(std::string_view body_source, errors& errs);
+
+    //one top level statement per call, nullptr once the input is used up
+    std::shared_ptr<statement> parse_next_statement();
+    //offset of the first token the next statement starts with
+    inline size_t position() const
+    {
+      return m_current_token.offset;
+    }
+    //fun literals parsed so far, their AST has to outlive the statement
+    inline size_t fun_literal_count() const
+    {
+      return m_fun_literals;
+    }
     inline const errors& get_errors() const
     {
       return m_errors;
     }
+    //every import parsed so far, bodies skipped in lazy mode find theirs when they're parsed
+    inline const std::vector<std::shared_ptr<import_expression>>& get_imports() const
+    {
+      return m_imports;
+    }
+
+    static precedence get_precedence(token_type tok);
   private:
     void next_token();
 
@@ -51,6 +74,7 @@ namespace my_ns
     std::shared_ptr<expression> parse_expression(precedence p);
     std::shared_ptr<identifire> parse_identifire();
     std::shared_ptr<integer_literal> parse_integer_literal();
+    std::shared_ptr<float_literal> parse_float_literal();
     std::shared_ptr<string_literal> parse_string_literal();
     std::shared_ptr<boolean_literal> parse_boolean();
     std::shared_ptr<prefix> parse_prefix();
@@ -58,7 +82,11 @@ namespace my_ns
     std::shared_ptr<expression> parse_grouped();
     std::shared_ptr<block> parse_block();
     std::shared_ptr<_if> parse_if();
+    std::shared_ptr<_while> parse_while();
+    std::shared_ptr<_for> parse_for();
     std::shared_ptr<fun_literal> parse_fun_literal();
+    std::shared_ptr<import_expression> parse_import();
+    bool skip_block();
     std::vector<std::shared_ptr<identifire>> parse_fun_params();
     std::shared_ptr<call> parse_call(const std::shared_ptr<expression>& expr);
     std::vector<std::shared_ptr<expression>> parse_call_args();
@@ -73,13 +101,17 @@ namespace my_ns
     void peek_error(token_type tok);
     void no_prefix_parse_fun_error(token_type tok);
   private:
-    static precedence get_precedence(token_type tok);
+    static constexpr std::array<prefix_parse_fun, token_type_count> make_prefix_table();
+    static constexpr std::array<infix_parse_fun, token_type_count> make_infix_table();
+    static const std::array<prefix_parse_fun, token_type_count> s_prefix_funs;
+    static const std::array<infix_parse_fun, token_type_count> s_infix_funs;
   private:
     lexer* m_lexer;
     token m_current_token;
     token m_peek_token;
-    std::unordered_map<token_type, prefix_parse_fun> m_prefix_funs;
-    std::unordered_map<token_type, infix_parse_fun> m_infix_funs;
     errors m_errors;
+    bool m_lazy_bodies = false;
+    size_t m_fun_literals = 0;
+    std::vector<std::shared_ptr<import_expression>> m_imports;
   };
 }
@@ -1,9 +1,11 @@
 #include "lexer.hpp"
 #include "object.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
 #include "token.hpp"
 #include "evaluator.hpp"
 
+#include <deque>
 #include <iostream>
 #include <ostream>
 #include <string_view>
@@ -29,10 +31,12 @@ namespace my_ns
   {
     bool running = true;
     auto env = std::make_shared<environment>();
+    //functions defined on earlier lines still point into their text
+    std::deque<std::string> lines;
     while(running)
     {
       std::cout << prompt;
-      std::string line;
+      auto& line = lines.emplace_back();
       running = static_cast<bool>(std::getline(std::cin, line));
       if(!running) break;
 
@@ -48,6 +52,7 @@ namespace my_ns
         continue;
       }
 
+      get_optimizer().optimize(program);
       auto evaluated = eval(program, env);
       if(evaluated)
         std::cout << evaluated->inspect() << "\n";
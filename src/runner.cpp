@@ -1,16 +1,172 @@
 #include "runner.hpp"
+#include "chunked_source.hpp"
 #include "evaluator.hpp"
+#include "flat_parser.hpp"
+#include "leac.hpp"
 #include "lexer.hpp"
+#include "mapped_file.hpp"
+#include "module.hpp"
 #include "object.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
+#include "snapshot.hpp"
+#include <cstdint>
+#include <deque>
 #include <filesystem>
-#include <fstream>
 #include <iostream>
-#include <sstream>
+#include <optional>
 
 namespace my_ns 
 {
-  std::expected<void, runner_error> start_runner(const std::filesystem::path& file)
+  //runs while the script's text is still loaded, functions are saved as their source
+  static std::expected<void, runner_error> finish(const runner_options& options, const std::shared_ptr<environment>& env, runner_error& err)
+  {
+    if(options.save_snapshot.empty())
+      return {};
+    if(auto saved = snapshot::save(options.save_snapshot, env); !saved)
+    {
+      err.errors.emplace_back(runner_error::type::snapshot_error, saved.error());
+      return std::unexpected(err);
+    }
+    return {};
+  }
+
+  //the window only holds the statements that aren't done yet, a statement is run and its
+  //AST dropped before the next one is parsed. statements with fun literals keep their text
+  //since closures point into it
+  static std::expected<void, runner_error> run_stream(const std::filesystem::path& file, const runner_options& options, const std::shared_ptr<environment>& env)
+  {
+    runner_error err;
+    auto source = chunked_source::open(file, options.stream_chunk);
+    if(!source.has_value())
+    {
+      err.errors.emplace_back(runner_error::type::cant_open_file, "can't read file: " + file.string());
+      return std::unexpected(err);
+    }
+
+    std::deque<std::string> retained;
+    bool done = false;
+    while(!done)
+    {
+      auto window = source->window();
+      lexer lx(window);
+      parser ps(&lx, options.lazy_fun_bodies);
+      size_t funs = 0;
+      while(true)
+      {
+        auto start = ps.position();
+        auto stmt = ps.parse_next_statement();
+        //the statement or the token after it may go on past the window, read more and redo it
+        if(lx.at_end() && !source->at_end())
+        {
+          source->consume(start);
+          source->read_more();
+          break;
+        }
+
+        const auto& errors = ps.get_errors();
+        if(!errors.empty())
+        {
+          for(const auto& msg : errors)
+            err.errors.emplace_back(runner_error::type::parse_error, msg);
+          return std::unexpected(err);
+        }
+        if(!stmt)
+        {
+          done = true;
+          break;
+        }
+
+        if(ps.fun_literal_count() != funs)
+        {
+          funs = ps.fun_literal_count();
+          auto& text = retained.emplace_back(window.substr(start, ps.position() - start));
+          lexer own_lexer(text);
+          parser own_parser(&own_lexer, options.lazy_fun_bodies);
+          stmt = own_parser.parse_next_statement();
+        }
+
+        get_optimizer().optimize(stmt);
+        auto res = eval(stmt, env);
+        if(res && (res->get_type() == object_type::ret_value || res->get_type() == object_type::error))
+        {
+          done = true;
+          break;
+        }
+      }
+    }
+    return finish(options, env, err);
+  }
+
+  static std::shared_ptr<program> report_errors(const parser::errors& errors, runner_error& err)
+  {
+    for(const auto& msg : errors)
+      err.errors.emplace_back(runner_error::type::parse_error, msg);
+    return nullptr;
+  }
+
+  static std::shared_ptr<program> parse_source(std::string_view source, const runner_options& options, runner_error& err)
+  {
+    lexer lx(source);
+    parser ps(&lx, options.lazy_fun_bodies);
+    auto prog = ps.parse_program();
+    if(!ps.get_errors().empty())
+      return report_errors(ps.get_errors(), err);
+
+    std::vector<std::filesystem::path> imports;
+    for(const auto& expr : ps.get_imports())
+      imports.push_back(get_modules().resolve(*expr));
+    get_modules().prefetch(imports);
+    get_optimizer().optimize(prog);
+    return prog;
+  }
+
+  //the flat AST comes from the .leac cache when it matches the source, else it's parsed and
+  //the cache rewritten
+  static std::shared_ptr<const flat::ast> parse_cached(const std::filesystem::path& file, std::string_view source, runner_error& err)
+  {
+    auto cache = leac::cache_path(file);
+    if(auto flat = leac::load(cache, source))
+      return std::make_shared<const flat::ast>(std::move(*flat));
+
+    lexer lx(source);
+    flat_parser ps(&lx, source);
+    auto flat = std::make_shared<const flat::ast>(ps.parse_program());
+    if(!ps.get_errors().empty())
+    {
+      report_errors(ps.get_errors(), err);
+      return nullptr;
+    }
+
+    leac::save(cache, *flat, source); //a read only directory just means no cache
+    return flat;
+  }
+
+  //the files the script imports and everything under them are parsed before it starts
+  static void prefetch_imports(const flat::ast& flat)
+  {
+    std::vector<std::filesystem::path> imports;
+    for(flat::node_id id = 0; id < flat.size(); ++id)
+      if(flat.kind(id) == node_type::_import)
+        imports.push_back(get_modules().get_root() / flat.text(id));
+    get_modules().prefetch(imports);
+  }
+
+  //each top level statement becomes a tree right before it runs and fun bodies on their
+  //first call, so a cached script starts running once the cache is mapped and checked
+  static void run_flat(const std::shared_ptr<const flat::ast>& flat, const std::shared_ptr<environment>& env)
+  {
+    for(auto id : flat::top_level(*flat))
+    {
+      auto stmt = flat::to_tree(flat, id);
+      get_optimizer().optimize(stmt);
+      auto res = eval(stmt, env);
+      if(res && (res->get_type() == object_type::ret_value || res->get_type() == object_type::error))
+        break;
+    }
+  }
+
+  std::expected<void, runner_error> start_runner(const std::filesystem::path& file, const runner_options& options)
   {
     runner_error err;
     if(!std::filesystem::exists(file))
@@ -20,24 +176,59 @@ namespace my_ns
       return std::unexpected(err);
     }
 
-    std::ifstream fstream(file);
-    std::stringstream ss;
-    ss << fstream.rdbuf();
+    //imports in the script are relative to it, the ones in modules to their own file
+    get_modules().set_root(std::filesystem::absolute(file).parent_path());
+    get_optimizer().set_enabled(options.optimize);
+    get_optimizer().set_inline_budget(options.inline_budget);
+    get_optimizer().set_specialize(options.specialize);
+    get_optimizer().set_auto_memo(options.auto_memo);
+    get_optimizer().set_memo_capacity(options.memo_capacity);
+    get_fork_join_pool().resize(options.threads ? options.threads : std::thread::hardware_concurrency());
 
-    auto env = std::make_shared<environment>();
-    lexer lx(ss.str());
-    parser ps(&lx);
-    auto prog = ps.parse_program();
+    //restored functions view the snapshot, it stays loaded for the whole run
+    std::optional<snapshot> start;
+    std::shared_ptr<environment> env;
+    if(!options.snapshot.empty())
+    {
+      auto loaded = snapshot::load(options.snapshot);
+      if(!loaded.has_value())
+      {
+        err.errors.emplace_back(runner_error::type::snapshot_error, loaded.error());
+        return std::unexpected(err);
+      }
+      start = std::move(*loaded);
+      env = start->restore();
+    }
+    else
+      env = std::make_shared<environment>();
+
+    if(options.stream)
+      return run_stream(file, options, env);
 
-    const auto& errors = ps.get_errors();
-    if(!errors.empty())
+    //the AST keeps views into the mapping, it has to outlive the evaluation
+    auto source = mapped_file::open(file);
+    if(!source.has_value())
     {
-      for(const auto& msg : errors)
-        err.errors.emplace_back(runner_error::type::parse_error, msg);
+      err.errors.emplace_back(runner_error::type::cant_open_file, "can't read file: " + file.string());
       return std::unexpected(err);
     }
 
+    //flat ids and text spans are 32 bit, bigger scripts always parse
+    if(options.use_cache && source->view().size() <= UINT32_MAX)
+    {
+      auto flat = parse_cached(file, source->view(), err);
+      if(!flat)
+        return std::unexpected(err);
+      prefetch_imports(*flat);
+      run_flat(flat, env);
+      return finish(options, env, err);
+    }
+
+    auto prog = parse_source(source->view(), options, err);
+    if(!prog)
+      return std::unexpected(err);
+
     auto evaluated = eval(prog, env);
-    return {};
+    return finish(options, env, err);
   }
 }
@@ -1,7 +1,10 @@
 #pragma once
 
+#include "memo.hpp"
+
 #include <expected>
 #include <filesystem>
+#include <string>
 #include <vector>
 namespace my_ns
 {
@@ -9,10 +12,36 @@ namespace my_ns
   {
     enum class type
     {
-      cant_open_file, parse_error
+      cant_open_file, parse_error, snapshot_error
     };
     std::vector<std::pair<type, std::string>> errors;
   };
 
-  std::expected<void, runner_error> start_runner(const std::filesystem::path& file);
+  struct runner_options
+  {
+    //skip fun bodies at parse time and parse each on its first call
+    bool lazy_fun_bodies = false;
+    //read the file a chunk at a time and run each top level statement as soon as it's parsed
+    bool stream = false;
+    //keep the parsed program in a .leac file next to the script and reuse it while the source is unchanged
+    bool use_cache = true;
+    //fold constants, pool literal objects and drop dead if branches before running
+    bool optimize = true;
+    //the most nodes a function body may have for its calls to be inlined, 0 never inlines
+    size_t inline_budget = 32;
+    //compile functions that only compute integers to unboxed code on their first call
+    bool specialize = true;
+    //put a cache of results in front of every pure function, and the most entries each keeps
+    bool auto_memo = false;
+    size_t memo_capacity = default_memo_capacity;
+    //threads calls to pure functions side by side may run on, 0 takes every core and 1 runs in order
+    size_t threads = 0;
+    size_t stream_chunk = size_t(1) << 20;
+    //start from this snapshot's environment instead of an empty one
+    std::filesystem::path snapshot;
+    //after the script ran, write its global environment here for later runs to start from
+    std::filesystem::path save_snapshot;
+  };
+
+  std::expected<void, runner_error> start_runner(const std::filesystem::path& file, const runner_options& options = {});
 }
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if !defined(LEA_NO_SIMD) && defined(__AVX2__)
+  #define LEA_AVX2 1
+  #include <immintrin.h>
+#elif !defined(LEA_NO_SIMD) && defined(__SSE2__)
+  #define LEA_SSE2 1
+  #include <emmintrin.h>
+#endif
+
+//byte scanning helpers, every function has a scalar fallback (define LEA_NO_SIMD to force it)
+
+namespace my_ns::simd
+{
+  constexpr auto npos = std::string_view::npos;
+
+  namespace detail
+  {
+#if defined(LEA_AVX2)
+    using vec = __m256i;
+    constexpr size_t width = 32;
+    inline vec load(const char* p) { return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)); }
+    inline vec splat(char c) { return _mm256_set1_epi8(c); }
+    inline vec eq(vec a, vec b) { return _mm256_cmpeq_epi8(a, b); }
+    inline vec either(vec a, vec b) { return _mm256_or_si256(a, b); }
+    inline vec both(vec a, vec b) { return _mm256_and_si256(a, b); }
+    inline vec sub(vec a, vec b) { return _mm256_sub_epi8(a, b); }
+    inline vec min_u(vec a, vec b) { return _mm256_min_epu8(a, b); }
+    inline uint32_t mask(vec a) { return static_cast<uint32_t>(_mm256_movemask_epi8(a)); }
+    constexpr uint32_t full_mask = 0xffffffffu;
+#elif defined(LEA_SSE2)
+    using vec = __m128i;
+    constexpr size_t width = 16;
+    inline vec load(const char* p) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p)); }
+    inline vec splat(char c) { return _mm_set1_epi8(c); }
+    inline vec eq(vec a, vec b) { return _mm_cmpeq_epi8(a, b); }
+    inline vec either(vec a, vec b) { return _mm_or_si128(a, b); }
+    inline vec both(vec a, vec b) { return _mm_and_si128(a, b); }
+    inline vec sub(vec a, vec b) { return _mm_sub_epi8(a, b); }
+    inline vec min_u(vec a, vec b) { return _mm_min_epu8(a, b); }
+    inline uint32_t mask(vec a) { return static_cast<uint32_t>(_mm_movemask_epi8(a)); }
+    constexpr uint32_t full_mask = 0xffffu;
+#endif
+
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    //unsigned a <= b per byte
+    inline vec less_equal_u(vec a, vec b) { return eq(min_u(a, b), a); }
+    //unsigned lo <= a <= hi per byte
+    inline vec in_range(vec a, char lo, char hi) { return less_equal_u(sub(a, splat(lo)), splat(static_cast<char>(hi - lo))); }
+
+    inline vec is_space(vec v) { return either(eq(v, splat(' ')), in_range(v, '\t', '\r')); }
+    inline vec is_digit(vec v) { return in_range(v, '0', '9'); }
+    inline vec is_ident(vec v)
+    {
+      auto lower = either(v, splat(0x20));
+      return either(either(in_range(lower, 'a', 'z'), is_digit(v)), eq(v, splat('_')));
+    }
+#endif
+
+    enum char_class : uint8_t
+    {
+      space = 1, digit = 2, alpha = 4,
+    };
+
+    constexpr std::array<uint8_t, 256> make_class_table()
+    {
+      std::array<uint8_t, 256> table{};
+      for(int ch = 0; ch < 256; ++ch)
+      {
+        if(ch == ' ' || (ch >= '\t' && ch <= '\r'))
+          table[ch] |= space;
+        if(ch >= '0' && ch <= '9')
+          table[ch] |= digit;
+        if((ch >= 'a' && ch <= 'z') || (ch >= 'A' && ch <= 'Z') || ch == '_')
+          table[ch] |= alpha;
+      }
+      return table;
+    }
+    inline constexpr auto class_table = make_class_table();
+
+    inline constexpr bool has_class(char ch, uint8_t cls)
+    {
+      return class_table[static_cast<unsigned char>(ch)] & cls;
+    }
+
+    //runs shorter than this are done byte by byte, most tokens and gaps are short
+    //and a block load only pays off once the run is long
+    constexpr size_t scalar_prefix = 8;
+
+    //advance from pos while the bytes are in the class, returns the first position outside it
+    template <typename VecPred>
+    inline size_t scan_while(std::string_view in, size_t pos, [[maybe_unused]] VecPred&& vec_pred, uint8_t cls)
+    {
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+      for(auto end = std::min(in.size(), pos + scalar_prefix); pos < end; ++pos)
+        if(!has_class(in[pos], cls))
+          return pos;
+
+      for(; pos + width <= in.size(); pos += width)
+      {
+        auto outside = ~mask(vec_pred(load(in.data() + pos))) & full_mask;
+        if(outside)
+          return pos + __builtin_ctz(outside);
+      }
+#endif
+      while(pos < in.size() && has_class(in[pos], cls))
+        ++pos;
+      return pos;
+    }
+  }
+
+  inline bool is_space(char ch) { return detail::has_class(ch, detail::space); }
+  inline bool is_digit(char ch) { return detail::has_class(ch, detail::digit); }
+  inline bool is_ident_start(char ch) { return detail::has_class(ch, detail::alpha); }
+  inline bool is_ident(char ch) { return detail::has_class(ch, detail::alpha | detail::digit); }
+
+  inline size_t skip_whitespace(std::string_view in, size_t pos)
+  {
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    return detail::scan_while(in, pos, [](auto v) { return detail::is_space(v); }, detail::space);
+#else
+    return detail::scan_while(in, pos, 0, detail::space);
+#endif
+  }
+
+  inline size_t scan_identifier(std::string_view in, size_t pos)
+  {
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    return detail::scan_while(in, pos, [](auto v) { return detail::is_ident(v); }, detail::alpha | detail::digit);
+#else
+    return detail::scan_while(in, pos, 0, detail::alpha | detail::digit);
+#endif
+  }
+
+  inline size_t scan_digits(std::string_view in, size_t pos)
+  {
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    return detail::scan_while(in, pos, [](auto v) { return detail::is_digit(v); }, detail::digit);
+#else
+    return detail::scan_while(in, pos, 0, detail::digit);
+#endif
+  }
+
+  inline size_t find_byte(std::string_view hay, char ch, size_t from = 0)
+  {
+    if(from >= hay.size())
+      return npos;
+    auto found = static_cast<const char*>(std::memchr(hay.data() + from, ch, hay.size() - from));
+    return found ? static_cast<size_t>(found - hay.data()) : npos;
+  }
+
+  //first position at or after from holding any of the four bytes
+  inline size_t find_any_of(std::string_view hay, size_t from, char a, char b, char c, char d)
+  {
+    size_t pos = from;
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    using namespace detail;
+    const vec va = splat(a), vb = splat(b), vc = splat(c), vd = splat(d);
+    for(; pos + width <= hay.size(); pos += width)
+    {
+      auto v = load(hay.data() + pos);
+      auto m = mask(either(either(eq(v, va), eq(v, vb)), either(eq(v, vc), eq(v, vd))));
+      if(m)
+        return pos + __builtin_ctz(m);
+    }
+#endif
+    for(; pos < hay.size(); ++pos)
+    {
+      auto ch = hay[pos];
+      if(ch == a || ch == b || ch == c || ch == d)
+        return pos;
+    }
+    return npos;
+  }
+
+  //substring search, compares the first and last needle byte against a whole block
+  //at once and only memcmp's the candidates (Mula's generic SIMD strstr)
+  inline size_t find(std::string_view hay, std::string_view needle, size_t from = 0)
+  {
+    if(needle.empty())
+      return from <= hay.size() ? from : npos;
+    if(needle.size() == 1)
+      return find_byte(hay, needle[0], from);
+    if(from >= hay.size() || hay.size() - from < needle.size())
+      return npos;
+
+    size_t i = from;
+#if defined(LEA_AVX2) || defined(LEA_SSE2)
+    using namespace detail;
+    const char* base = hay.data();
+    const size_t n = needle.size();
+    const size_t last = hay.size() - n; //last valid start
+    const vec first_v = splat(needle[0]);
+    const vec last_v = splat(needle[n - 1]);
+    for(; i + width <= last + 1; i += width)
+    {
+      auto m = mask(both(eq(first_v, load(base + i)), eq(last_v, load(base + i + n - 1))));
+      while(m)
+      {
+        auto bit = __builtin_ctz(m);
+        if(std::memcmp(base + i + bit + 1, needle.data() + 1, n - 2) == 0)
+          return i + bit;
+        m &= m - 1;
+      }
+    }
+#endif
+    return hay.find(needle, i);
+  }
+}
@@ -0,0 +1,615 @@
+#include "snapshot.hpp"
+#include "builtins.hpp"
+#include "evaluator.hpp"
+#include "lexer.hpp"
+#include "memo.hpp"
+#include "parser.hpp"
+#include "utils.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+
+#if defined(__unix__) || defined(__APPLE__)
+  #include <unistd.h>
+#endif
+
+namespace my_ns
+{
+  namespace
+  {
+    constexpr char s_magic[4] = { 'L', 'E', 'A', 'S' };
+    constexpr uint32_t no_scope = std::numeric_limits<uint32_t>::max();
+
+    struct header
+    {
+      char magic[4];
+      uint32_t version;
+      uint64_t payload_hash;
+      uint64_t payload_size;
+    };
+
+    uint64_t process_id()
+    {
+#if defined(__unix__) || defined(__APPLE__)
+      return static_cast<uint64_t>(::getpid());
+#else
+      return 0;
+#endif
+    }
+
+    class writer
+    {
+    public:
+      template <typename T>
+      void put(T value)
+      {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+      }
+
+      void put_string(std::string_view str)
+      {
+        put<uint64_t>(str.size());
+        out.append(str);
+      }
+    public:
+      std::string out;
+    };
+
+    //every read is bounds checked, a short or damaged payload turns ok off and reads zeros
+    class reader
+    {
+    public:
+      reader(std::string_view bytes)
+        : m_bytes(bytes)
+      {
+      }
+
+      template <typename T>
+      T get()
+      {
+        T value{};
+        if(m_bytes.size() < sizeof(T))
+        {
+          ok = false;
+          return value;
+        }
+        std::memcpy(&value, m_bytes.data(), sizeof(T));
+        m_bytes.remove_prefix(sizeof(T));
+        return value;
+      }
+
+      std::string_view get_string()
+      {
+        auto size = get<uint64_t>();
+        if(size > m_bytes.size())
+        {
+          ok = false;
+          return {};
+        }
+        auto str = m_bytes.substr(0, size);
+        m_bytes.remove_prefix(size);
+        return str;
+      }
+
+      inline bool at_end() const
+      {
+        return m_bytes.empty();
+      }
+      inline size_t remaining() const
+      {
+        return m_bytes.size();
+      }
+    public:
+      bool ok = true;
+    private:
+      std::string_view m_bytes;
+    };
+
+    //numbers every scope and value reachable from the root. values are numbered after what
+    //they hold and scopes after their outer scope. a closure only registers its scope, the
+    //scope's bindings are walked later from the list, so going from a value through a scope
+    //back to the same value never recurses and the values form a DAG
+    class graph_writer
+    {
+    public:
+      std::expected<uint32_t, std::string> add_root(const std::shared_ptr<environment>& env)
+      {
+        auto root = add_scope(env);
+        for(size_t i = 0; i < m_scopes.size(); ++i) //grows while walking
+          for(const auto& [name, value] : m_scopes[i]->get_bindings())
+            if(auto res = add(value); !res)
+              return std::unexpected(res.error());
+        return root;
+      }
+
+      void write(writer& out, uint32_t root) const
+      {
+        out.put(static_cast<uint32_t>(m_literals.size()));
+        for(auto text : m_literals)
+          out.put_string(text);
+
+        out.put(static_cast<uint32_t>(m_scopes.size()));
+        for(auto env : m_scopes)
+          out.put(env->get_outer() ? m_scope_ids.at(env->get_outer().get()) : no_scope);
+
+        out.put(static_cast<uint32_t>(m_objects.size()));
+        for(const auto& obj : m_objects)
+          out.out += obj;
+
+        for(auto env : m_scopes)
+        {
+          out.put(static_cast<uint32_t>(env->get_bindings().size()));
+          for(const auto& [name, value] : env->get_bindings())
+          {
+            out.put_string(name.str());
+            out.put(m_ids.at(value.get()));
+          }
+        }
+        out.put(root);
+      }
+    private:
+      uint32_t add_scope(const std::shared_ptr<environment>& env)
+      {
+        if(auto it = m_scope_ids.find(env.get()); it != m_scope_ids.end())
+          return it->second;
+        if(env->get_outer())
+          add_scope(env->get_outer());
+
+        auto id = static_cast<uint32_t>(m_scopes.size());
+        m_scope_ids[env.get()] = id;
+        m_scopes.push_back(env.get());
+        return id;
+      }
+
+      std::expected<void, std::string> add(const std::shared_ptr<object>& obj)
+      {
+        if(m_ids.contains(obj.get()))
+          return {};
+
+        writer body;
+        body.put(static_cast<uint8_t>(obj->get_type()));
+        switch(obj->get_type())
+        {
+          case object_type::null:
+          case object_type::void_obj:
+            break;
+          case object_type::integer:
+            body.put(std::static_pointer_cast<integer>(obj)->get_value());
+            break;
+          case object_type::floating:
+            body.put(std::static_pointer_cast<floating>(obj)->get_value());
+            break;
+          case object_type::big_integer:
+          {
+            const auto& value = std::static_pointer_cast<big_integer>(obj)->get_value();
+            body.put<uint8_t>(value.is_negative());
+            body.put(static_cast<uint32_t>(value.get_limbs().size()));
+            for(auto limb : value.get_limbs())
+              body.put(limb);
+            break;
+          }
+          case object_type::boolean:
+            body.put<uint8_t>(std::static_pointer_cast<boolean>(obj)->get_value());
+            break;
+          case object_type::string:
+            body.put_string(std::static_pointer_cast<string>(obj)->get_value());
+            break;
+          case object_type::array:
+          {
+            const auto& elems = std::static_pointer_cast<array>(obj)->get_elements();
+            if(auto res = add_all(elems.begin(), elems.end(), [](const auto& e) -> const auto& { return e; }); !res)
+              return res;
+            body.put(static_cast<uint32_t>(elems.size()));
+            for(const auto& e : elems)
+              body.put(m_ids[e.get()]);
+            break;
+          }
+          case object_type::set:
+          {
+            const auto& elems = std::static_pointer_cast<set>(obj)->get_elements();
+            if(auto res = add_all(elems.begin(), elems.end(), [](const auto& e) -> const auto& { return e.second; }); !res)
+              return res;
+            body.put(static_cast<uint32_t>(elems.size()));
+            for(const auto& e : elems)
+              body.put(m_ids[e.second.get()]);
+            break;
+          }
+          case object_type::map:
+          {
+            auto m = std::static_pointer_cast<map>(obj);
+            if(auto sh = m->get_shape())
+            {
+              const auto& slots = m->get_slots();
+              if(auto res = add_all(slots.begin(), slots.end(), [](const auto& e) -> const auto& { return e; }); !res)
+                return res;
+              body.put<uint8_t>(1);
+              body.put(static_cast<uint32_t>(slots.size()));
+              for(size_t i = 0; i < slots.size(); ++i)
+              {
+                body.put_string(sh->get_keys()[i].str());
+                body.put(m_ids[slots[i].get()]);
+              }
+              break;
+            }
+
+            const auto& pairs = m->get_map();
+            for(const auto& [_, pair] : pairs)
+            {
+              if(auto res = add(pair.key); !res)
+                return res;
+              if(auto res = add(pair.value); !res)
+                return res;
+            }
+            body.put<uint8_t>(0);
+            body.put(static_cast<uint32_t>(pairs.size()));
+            for(const auto& [_, pair] : pairs)
+            {
+              body.put(m_ids[pair.key.get()]);
+              body.put(m_ids[pair.value.get()]);
+            }
+            break;
+          }
+          case object_type::fun:
+          {
+            auto f = std::static_pointer_cast<fun>(obj);
+            if(f->literal->source.empty())
+              return std::unexpected("snapshot: function without source text");
+            auto env = add_scope(f->env);
+            auto [it, inserted] = m_literal_ids.try_emplace(f->literal.get(), static_cast<uint32_t>(m_literals.size()));
+            if(inserted)
+              m_literals.push_back(f->literal->source);
+            body.put(it->second);
+            body.put(env);
+            break;
+          }
+          case object_type::memoized:
+          {
+            //the function and the cache's size, the results are made again
+            auto memo_fun = std::static_pointer_cast<memoized>(obj);
+            if(auto res = add(memo_fun->target); !res)
+              return res;
+            body.put(m_ids[memo_fun->target.get()]);
+            body.put(static_cast<uint64_t>(memo_fun->cache->capacity()));
+            break;
+          }
+          case object_type::builtin:
+          {
+            auto name = builtin_name(obj);
+            if(name.empty())
+              return std::unexpected("snapshot: builtin that isn't in the builtin table");
+            body.put_string(name);
+            break;
+          }
+          default:
+            return std::unexpected("snapshot: can't save a value of type: " + std::to_string((uint32_t)obj->get_type()));
+        }
+
+        m_ids[obj.get()] = static_cast<uint32_t>(m_objects.size());
+        m_objects.push_back(std::move(body.out));
+        return {};
+      }
+
+      template <typename It, typename Get>
+      std::expected<void, std::string> add_all(It begin, It end, Get&& get)
+      {
+        for(auto it = begin; it != end; ++it)
+        {
+          if(auto res = add(get(*it)); !res)
+            return res;
+        }
+        return {};
+      }
+
+      static std::string builtin_name(const std::shared_ptr<object>& obj)
+      {
+        for(const auto& [name, value] : get_builtins().get_bindings())
+          if(value == obj)
+            return name.str();
+        return {};
+      }
+    private:
+      std::unordered_map<const object*, uint32_t> m_ids;
+      std::vector<std::string> m_objects;
+      std::unordered_map<const environment*, uint32_t> m_scope_ids;
+      std::vector<const environment*> m_scopes;
+      std::unordered_map<const fun_literal*, uint32_t> m_literal_ids;
+      std::vector<std::string_view> m_literals;
+    };
+
+    std::shared_ptr<fun_literal> parse_literal(std::string_view text)
+    {
+      lexer lx(text);
+      parser ps(&lx, true);
+      auto stmt = ps.parse_next_statement();
+      if(!ps.get_errors().empty() || !stmt || stmt->get_type() != node_type::expression_statement)
+        return nullptr;
+      auto expr = std::static_pointer_cast<expression_statement>(stmt)->_expression;
+      if(!expr || expr->get_type() != node_type::fun)
+        return nullptr;
+      return std::static_pointer_cast<fun_literal>(expr);
+    }
+  }
+
+  std::expected<void, std::string> snapshot::save(const std::filesystem::path& path, const std::shared_ptr<environment>& env)
+  {
+    graph_writer graph;
+    auto root = graph.add_root(env);
+    if(!root)
+      return std::unexpected(root.error());
+
+    writer payload;
+    graph.write(payload, *root);
+
+    header head;
+    std::memcpy(head.magic, s_magic, sizeof(s_magic));
+    head.version = format_version;
+    head.payload_hash = utils::fast_hash(payload.out);
+    head.payload_size = payload.out.size();
+
+    //a process that has the old snapshot mapped keeps reading it, rename swaps the new one in
+    auto tmp = path;
+    tmp += ".tmp" + std::to_string(process_id());
+    {
+      std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+      out.write(reinterpret_cast<const char*>(&head), sizeof(head));
+      out.write(payload.out.data(), static_cast<std::streamsize>(payload.out.size()));
+      if(!out.flush())
+      {
+        out.close();
+        std::error_code ec;
+        std::filesystem::remove(tmp, ec);
+        return std::unexpected("can't write snapshot: " + path.string());
+      }
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tmp, path, ec);
+    if(ec)
+    {
+      std::filesystem::remove(tmp, ec);
+      return std::unexpected("can't write snapshot: " + path.string());
+    }
+    return {};
+  }
+
+  std::expected<snapshot, std::string> snapshot::load(const std::filesystem::path& path)
+  {
+    const auto bad = [&path] { return std::unexpected("not a snapshot or damaged: " + path.string()); };
+
+    auto file = mapped_file::open(path);
+    if(!file.has_value())
+      return std::unexpected("can't read snapshot: " + path.string());
+
+    snapshot snap;
+    snap.m_file = std::move(*file);
+    auto bytes = snap.m_file.view();
+
+    header head;
+    if(bytes.size() < sizeof(head))
+      return bad();
+    std::memcpy(&head, bytes.data(), sizeof(head));
+    bytes.remove_prefix(sizeof(head));
+    if(std::memcmp(head.magic, s_magic, sizeof(s_magic)) != 0 || head.version != format_version)
+      return bad();
+    if(head.payload_size != bytes.size() || head.payload_hash != utils::fast_hash(bytes))
+      return bad();
+
+    reader in(bytes);
+    auto literals = in.get<uint32_t>();
+    for(uint32_t i = 0; i < literals && in.ok; ++i)
+    {
+      auto lit = parse_literal(in.get_string());
+      if(!lit)
+        return bad();
+      snap.m_literals.push_back(lit);
+    }
+
+    auto scopes = in.get<uint32_t>();
+    for(uint32_t i = 0; i < scopes && in.ok; ++i)
+    {
+      auto outer = in.get<uint32_t>();
+      if(outer != no_scope && outer >= i)
+        return bad();
+      snap.m_scopes.push_back({ .outer = outer, .bindings = {} });
+    }
+
+    //what's shared between restores is made here, once
+    auto objects = in.get<uint32_t>();
+    std::vector<bool> reaches_scope;
+    const auto read_child = [&](entry& e, uint32_t index)
+    {
+      auto child = in.get<uint32_t>();
+      if(child >= index)
+      {
+        in.ok = false;
+        return;
+      }
+      e.children.push_back(child);
+    };
+    for(uint32_t i = 0; i < objects && in.ok; ++i)
+    {
+      entry e;
+      e.type = static_cast<object_type>(in.get<uint8_t>());
+      switch(e.type)
+      {
+        case object_type::null:
+          e.shared = get_null();
+          break;
+        case object_type::void_obj:
+          e.shared = std::make_shared<void_object>();
+          break;
+        case object_type::integer:
+          e.shared = std::make_shared<integer>(in.get<int64_t>());
+          break;
+        case object_type::floating:
+          e.shared = std::make_shared<floating>(in.get<double>());
+          break;
+        case object_type::big_integer:
+        {
+          bool negative = in.get<uint8_t>() != 0;
+          auto count = in.get<uint32_t>();
+          if(count > in.remaining() / sizeof(bignum::limb))
+          {
+            in.ok = false;
+            break;
+          }
+          bignum::limbs limbs(count);
+          for(auto& limb : limbs)
+            limb = in.get<bignum::limb>();
+          e.shared = std::make_shared<big_integer>(bignum(negative, std::move(limbs)));
+          break;
+        }
+        case object_type::boolean:
+          e.shared = to_boolean(in.get<uint8_t>() != 0);
+          break;
+        case object_type::string:
+          e.shared = std::make_shared<string>(std::string(in.get_string()));
+          break;
+        case object_type::array:
+        case object_type::set:
+        {
+          auto count = in.get<uint32_t>();
+          for(uint32_t c = 0; c < count && in.ok; ++c)
+            read_child(e, i);
+          break;
+        }
+        case object_type::map:
+        {
+          bool is_record = in.get<uint8_t>() != 0;
+          auto count = in.get<uint32_t>();
+          std::vector<symbol> keys;
+          for(uint32_t c = 0; c < count && in.ok; ++c)
+          {
+            if(is_record)
+              keys.push_back(intern(in.get_string()));
+            else
+              read_child(e, i);
+            read_child(e, i);
+          }
+          if(is_record)
+            e.record = shape::get(keys);
+          break;
+        }
+        case object_type::fun:
+          e.literal = in.get<uint32_t>();
+          e.env = in.get<uint32_t>();
+          if(e.literal >= snap.m_literals.size() || e.env >= snap.m_scopes.size())
+            return bad();
+          break;
+        case object_type::memoized:
+          read_child(e, i);
+          e.capacity = in.get<uint64_t>();
+          break;
+        case object_type::builtin:
+        {
+          auto found = get_builtins().get(std::string(in.get_string()));
+          if(!found)
+            return bad();
+          e.shared = *found;
+          break;
+        }
+        default:
+          return bad();
+      }
+      if(!in.ok)
+        return bad();
+
+      bool reaches = e.type == object_type::fun;
+      for(auto child : e.children)
+        reaches = reaches || reaches_scope[child];
+      reaches_scope.push_back(reaches);
+      snap.m_entries.push_back(std::move(e));
+      if(!reaches && !snap.m_entries.back().shared)
+      {
+        std::vector<std::shared_ptr<object>> children;
+        for(auto child : snap.m_entries.back().children)
+          children.push_back(snap.m_entries[child].shared);
+        snap.m_entries.back().shared = snap.build(snap.m_entries.back(), children, {});
+      }
+    }
+
+    for(auto& sc : snap.m_scopes)
+    {
+      auto count = in.get<uint32_t>();
+      for(uint32_t c = 0; c < count && in.ok; ++c)
+      {
+        auto name = intern(in.get_string());
+        auto value = in.get<uint32_t>();
+        if(value >= snap.m_entries.size())
+          return bad();
+        sc.bindings.emplace_back(name, value);
+      }
+    }
+    snap.m_root = in.get<uint32_t>();
+    if(!in.ok || !in.at_end() || snap.m_root >= snap.m_scopes.size())
+      return bad();
+    return snap;
+  }
+
+  //children holds the objects for e.children in the same order
+  std::shared_ptr<object> snapshot::build(const entry& e, const std::vector<std::shared_ptr<object>>& children, const std::vector<std::shared_ptr<environment>>& envs) const
+  {
+    switch(e.type)
+    {
+      case object_type::array:
+        return std::make_shared<array>(children);
+      case object_type::set:
+      {
+        set::elements elems;
+        for(const auto& child : children)
+          if(auto key = std::dynamic_pointer_cast<hashable>(child))
+            elems.try_emplace(key->hash(), child);
+        return std::make_shared<set>(std::move(elems));
+      }
+      case object_type::map:
+      {
+        if(e.record)
+          return std::make_shared<map>(e.record, std::vector<std::shared_ptr<object>>(children));
+        std::unordered_map<hash_t, map::hash_pair> pairs;
+        for(size_t i = 0; i + 1 < children.size(); i += 2)
+          if(auto key = std::dynamic_pointer_cast<hashable>(children[i]))
+            pairs[key->hash()] = map::hash_pair{ .key = children[i], .value = children[i + 1] };
+        return std::make_shared<map>(pairs);
+      }
+      case object_type::fun:
+        return std::make_shared<fun>(m_literals[e.literal], envs[e.env]);
+      case object_type::memoized:
+        return std::make_shared<memoized>(children[0], std::make_shared<memo_cache>(e.capacity));
+      default:
+        return e.shared;
+    }
+  }
+
+  std::shared_ptr<environment> snapshot::restore() const
+  {
+    std::vector<std::shared_ptr<environment>> envs;
+    envs.reserve(m_scopes.size());
+    for(const auto& sc : m_scopes)
+      envs.push_back(sc.outer == no_scope ? std::make_shared<environment>() : std::make_shared<environment>(envs[sc.outer]));
+
+    std::vector<std::shared_ptr<object>> objects;
+    objects.reserve(m_entries.size());
+    std::vector<std::shared_ptr<object>> children;
+    for(const auto& e : m_entries)
+    {
+      if(e.shared)
+      {
+        objects.push_back(e.shared);
+        continue;
+      }
+      children.clear();
+      for(auto child : e.children)
+        children.push_back(objects[child]);
+      objects.push_back(build(e, children, envs));
+    }
+
+    for(size_t i = 0; i < m_scopes.size(); ++i)
+      for(const auto& [name, value] : m_scopes[i].bindings)
+        envs[i]->set(name, objects[value]);
+    return envs[m_root];
+  }
+}
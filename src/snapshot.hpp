@@ -0,0 +1,60 @@
+#pragma once
+
+#include "ast.hpp"
+#include "mapped_file.hpp"
+#include "object.hpp"
+
+#include <cstdint>
+#include <expected>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+//a snapshot holds an environment and every value it reaches, taken after a prelude ran
+//so later runs start from its state instead of running it again. functions are kept as
+//the text of their literal, parsed again on load and their bodies on the first call
+
+namespace my_ns
+{
+  class snapshot
+  {
+  public:
+    static constexpr uint32_t format_version = 1;
+  public:
+    //fails on values that only exist mid evaluation, like errors and return values
+    static std::expected<void, std::string> save(const std::filesystem::path& path, const std::shared_ptr<environment>& env);
+    static std::expected<snapshot, std::string> load(const std::filesystem::path& path);
+
+    //a new environment equal to the saved one. values that can't reach a scope never change
+    //so every restore shares them, only the scopes and the closures and containers leading
+    //to them are made again. functions view the snapshot's text, it has to outlive them
+    std::shared_ptr<environment> restore() const;
+  private:
+    struct entry
+    {
+      object_type type = object_type::null;
+      std::shared_ptr<object> shared; //set when no scope is reachable from it
+      uint32_t literal = 0; //fun
+      uint32_t env = 0; //fun
+      size_t capacity = 0; //memoized
+      const shape* record = nullptr; //map with a shape, children are its slots
+      std::vector<uint32_t> children; //elements, slots or key, value pairs
+    };
+
+    struct scope
+    {
+      uint32_t outer;
+      std::vector<std::pair<symbol, uint32_t>> bindings;
+    };
+  private:
+    snapshot() = default;
+    std::shared_ptr<object> build(const entry& e, const std::vector<std::shared_ptr<object>>& children, const std::vector<std::shared_ptr<environment>>& envs) const;
+  private:
+    mapped_file m_file; //function literals view into it
+    std::vector<std::shared_ptr<fun_literal>> m_literals;
+    std::vector<scope> m_scopes;
+    std::vector<entry> m_entries;
+    uint32_t m_root = 0;
+  };
+}
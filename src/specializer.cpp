@@ -0,0 +1,708 @@
+#include "specializer.hpp"
+#include "evaluator.hpp"
+#include "fork_join.hpp"
+#include "object.hpp"
+
+#include <array>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace my_ns
+{
+  //deeper than this the call runs as written, it reports the same way it always has
+  static constexpr size_t max_depth = 10000;
+
+  //frames of up to 16 slots live on the C++ stack
+  class frame_storage
+  {
+  public:
+    frame_storage(size_t slots)
+    {
+      if(slots > m_small.size())
+      {
+        m_big.resize(slots);
+        m_data = m_big.data();
+      }
+    }
+
+    inline int64_t* data()
+    {
+      return m_data;
+    }
+  private:
+    std::array<int64_t, 16> m_small;
+    std::vector<int64_t> m_big;
+    int64_t* m_data = m_small.data();
+  };
+
+  //most operands are a slot or a constant, they're read without going through exec
+  inline bool int_function::operand(uint32_t at, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const
+  {
+    const auto& in = m_code[at];
+    if(in.code == op::load)
+    {
+      out = frame[in.a];
+      return true;
+    }
+    if(in.code == op::constant)
+    {
+      out = in.value;
+      return true;
+    }
+    return exec(at, frame, env, depth, out);
+  }
+
+  //a fork only pays off for calls, the optimizer made sure their arguments don't store anything
+  inline bool int_function::operands(const instr& in, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& l, int64_t& r) const
+  {
+    if(in.fork)
+    {
+      auto& pool = get_fork_join_pool();
+      if(pool.worth_forking())
+      {
+        bool left = false;
+        bool right = false;
+        pool.invoke([&] { left = exec(in.a, frame, env, depth, l); }, [&] { right = exec(in.b, frame, env, depth, r); });
+        return left && right;
+      }
+    }
+    return operand(in.a, frame, env, depth, l) && operand(in.b, frame, env, depth, r);
+  }
+
+  bool int_function::exec(uint32_t at, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const
+  {
+    const auto& in = m_code[at];
+    int64_t l;
+    int64_t r;
+    switch(in.code)
+    {
+      case op::constant:
+        out = in.value;
+        return true;
+      case op::load:
+        out = frame[in.a];
+        return true;
+      case op::store:
+      {
+        //through a temporary, the value may read the slot it's stored to
+        int64_t value;
+        if(!operand(in.b, frame, env, depth, value))
+          return false;
+        frame[in.a] = value;
+        out = 0;
+        return true;
+      }
+      case op::add:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        return !__builtin_add_overflow(l, r, &out);
+      case op::sub:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        return !__builtin_sub_overflow(l, r, &out);
+      case op::mul:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        return !__builtin_mul_overflow(l, r, &out);
+      case op::div:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        if(r == 0 || (r == -1 && l == std::numeric_limits<int64_t>::min()))
+          return false;
+        out = l / r;
+        return true;
+      case op::less:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        out = l < r;
+        return true;
+      case op::greater:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        out = l > r;
+        return true;
+      case op::equal:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        out = l == r;
+        return true;
+      case op::not_equal:
+        if(!operands(in, frame, env, depth, l, r))
+          return false;
+        out = l != r;
+        return true;
+      case op::neg:
+        if(!operand(in.a, frame, env, depth, r) || r == std::numeric_limits<int64_t>::min())
+          return false;
+        out = -r;
+        return true;
+      case op::truthy:
+        if(!operand(in.a, frame, env, depth, r))
+          return false;
+        out = r != 0;
+        return true;
+      case op::negate:
+        if(!operand(in.a, frame, env, depth, r))
+          return false;
+        out = r == 0;
+        return true;
+      case op::sequence:
+        for(uint32_t i = 0; i < in.b; ++i)
+          if(!exec(m_lists[in.a + i], frame, env, depth, out))
+            return false;
+        return true;
+      case op::branch:
+        if(!exec(in.a, frame, env, depth, l))
+          return false;
+        if(l)
+          return exec(in.b, frame, env, depth, out);
+        if(in.c != none)
+          return exec(in.c, frame, env, depth, out);
+        out = 0;
+        return true;
+      case op::loop:
+        while(true)
+        {
+          if(!exec(in.a, frame, env, depth, l))
+            return false;
+          if(!l)
+            break;
+          if(!exec(in.b, frame, env, depth, r))
+            return false;
+        }
+        out = 0;
+        return true;
+      case op::guard:
+      case op::call:
+      {
+        const auto& site = m_sites[in.a];
+        auto callee = eval_identifire(site.callee, env);
+        if(callee->get_type() != object_type::fun)
+          return false;
+        auto* target = static_cast<fun*>(callee.get());
+        if(target->literal.get() != site.target)
+          return false;
+        if(in.code == op::guard)
+          return exec(in.b, frame, env, depth, out);
+        return call(site, target->env, frame, env, depth, out);
+      }
+    }
+    return false;
+  }
+
+  bool int_function::call(const call_site& site, const std::shared_ptr<environment>& callee_env, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const
+  {
+    //the callee may have given up since, then this call gives up too
+    auto* callee = site.target->specialized.get();
+    if(!callee || callee->gave_up() || depth >= max_depth)
+      return false;
+
+    frame_storage storage(callee->m_slots);
+    auto* callee_frame = storage.data();
+    for(size_t i = 0; i < site.args.size(); ++i)
+    {
+      int64_t arg;
+      if(!exec(site.args[i], frame, env, depth, arg))
+        return false;
+      callee_frame[callee->m_params[i]] = arg;
+    }
+    return callee->exec(callee->m_entry, callee_frame, callee_env, depth + 1, out);
+  }
+
+  std::shared_ptr<object> run_specialized(fun_literal& literal, const std::shared_ptr<environment>& env, const std::vector<std::shared_ptr<object>>& args)
+  {
+    const auto& spec = literal.specialized;
+    if(spec->gave_up() || args.size() != spec->m_params.size())
+      return nullptr;
+
+    frame_storage storage(spec->m_slots);
+    auto* frame = storage.data();
+    for(size_t i = 0; i < args.size(); ++i)
+    {
+      if(args[i]->get_type() != object_type::integer)
+        return nullptr;
+      frame[spec->m_params[i]] = static_cast<integer*>(args[i].get())->get_value();
+    }
+
+    int64_t out;
+    if(!spec->exec(spec->m_entry, frame, env, 0, out))
+    {
+      spec->m_gave_up.store(true, std::memory_order_relaxed);
+      return nullptr;
+    }
+    if(spec->m_boolean)
+      return to_boolean(out != 0);
+    return std::make_shared<integer>(out);
+  }
+
+  //bottom is a local no var has given a type yet, it goes along with anything until one does.
+  //none is a statement or a value that isn't an integer or a boolean
+  enum class int_type : uint8_t
+  {
+    none, bottom, integer, boolean
+  };
+
+  class int_compiler
+  {
+  public:
+    int_compiler(const fun_literal& literal, const literal_resolver& resolve)
+      : m_literal(literal), m_resolve(resolve)
+    {
+    }
+
+    std::shared_ptr<int_function> compile()
+    {
+      if(!m_literal.body)
+        return nullptr;
+      for(const auto& param : m_literal.parameters)
+        add_slot(param->sym, int_type::integer);
+      collect(m_literal.body);
+
+      //every round starts over with the types the last one settled on, they only go up from
+      //bottom so a few rounds are enough
+      for(int round = 0; round < 4; ++round)
+      {
+        m_fn = std::make_shared<int_function>();
+        m_changed = false;
+        m_defined.clear();
+        for(const auto& param : m_literal.parameters)
+        {
+          m_defined.insert(param->sym);
+          m_fn->m_params.push_back(m_slots.at(param->sym));
+        }
+
+        auto body = compile_block(m_literal.body);
+        if(!body)
+          return nullptr;
+        if(body->type != m_self && body->type != int_type::bottom)
+        {
+          //calls to itself were typed with what it returns
+          if(m_self != int_type::bottom)
+            return nullptr;
+          m_self = body->type;
+          m_changed = true;
+        }
+        if(m_changed)
+          continue;
+
+        if(body->type != int_type::integer && body->type != int_type::boolean)
+          return nullptr;
+        for(const auto& [_, type] : m_types)
+          if(type == int_type::bottom)
+            return nullptr;
+        m_fn->m_slots = m_slots.size();
+        m_fn->m_entry = body->at;
+        m_fn->m_boolean = body->type == int_type::boolean;
+        return m_fn;
+      }
+      return nullptr;
+    }
+  private:
+    struct typed
+    {
+      int_type type;
+      uint32_t at;
+    };
+    using result = std::optional<typed>;
+    using op = int_function::op;
+
+    static bool is_int(int_type type)
+    {
+      return type == int_type::integer || type == int_type::bottom;
+    }
+
+    static bool is_bool(int_type type)
+    {
+      return type == int_type::boolean || type == int_type::bottom;
+    }
+
+    void add_slot(const symbol& sym, int_type type)
+    {
+      auto next = static_cast<uint32_t>(m_slots.size());
+      if(m_slots.try_emplace(sym, next).second)
+        m_types.emplace(sym, type);
+    }
+
+    //every name a var in the body binds gets a slot, inlined bodies' renamed params too
+    void collect(const std::shared_ptr<node>& n)
+    {
+      if(!n)
+        return;
+
+      switch(n->get_type())
+      {
+        case node_type::var:
+        {
+          auto var_node = std::static_pointer_cast<var>(n);
+          add_slot(var_node->name.sym, int_type::bottom);
+          collect(var_node->value);
+          break;
+        }
+        case node_type::ret:
+          collect(std::static_pointer_cast<ret>(n)->return_value);
+          break;
+        case node_type::expression_statement:
+          collect(std::static_pointer_cast<expression_statement>(n)->_expression);
+          break;
+        case node_type::block:
+        {
+          for(const auto& stmt : std::static_pointer_cast<block>(n)->statements)
+            collect(stmt);
+          break;
+        }
+        case node_type::prefix:
+          collect(std::static_pointer_cast<prefix>(n)->right);
+          break;
+        case node_type::infix:
+        {
+          auto inf = std::static_pointer_cast<infix>(n);
+          collect(inf->left);
+          collect(inf->right);
+          break;
+        }
+        case node_type::_if:
+        {
+          auto if_node = std::static_pointer_cast<_if>(n);
+          collect(if_node->condition);
+          collect(if_node->consequence);
+          collect(if_node->alternative);
+          break;
+        }
+        case node_type::_while:
+        {
+          auto loop = std::static_pointer_cast<_while>(n);
+          collect(loop->condition);
+          collect(loop->body);
+          break;
+        }
+        case node_type::call:
+        {
+          for(const auto& arg : std::static_pointer_cast<call>(n)->arguments)
+            collect(arg);
+          break;
+        }
+        case node_type::inlined:
+        {
+          auto inline_node = std::static_pointer_cast<inlined_call>(n);
+          for(const auto& [_, sym] : inline_node->parameters)
+            add_slot(sym, int_type::bottom);
+          for(const auto& arg : inline_node->original->arguments)
+            collect(arg);
+          collect(inline_node->body);
+          break;
+        }
+        default:
+          break;
+      }
+    }
+
+    //a local's type is what every value stored to it agrees on
+    bool assign(const symbol& sym, int_type type)
+    {
+      auto& current = m_types.at(sym);
+      if(type == int_type::bottom || type == current)
+        return true;
+      if(type == int_type::none || current != int_type::bottom)
+        return false;
+      current = type;
+      m_changed = true;
+      return true;
+    }
+
+    uint32_t emit(const int_function::instr& in)
+    {
+      m_fn->m_code.push_back(in);
+      return static_cast<uint32_t>(m_fn->m_code.size() - 1);
+    }
+
+    uint32_t emit_constant(int64_t value)
+    {
+      return emit({ .code = op::constant, .value = value });
+    }
+
+    uint32_t emit_sequence(const std::vector<uint32_t>& items)
+    {
+      if(items.size() == 1)
+        return items[0];
+      auto first = static_cast<uint32_t>(m_fn->m_lists.size());
+      m_fn->m_lists.insert(m_fn->m_lists.end(), items.begin(), items.end());
+      return emit({ .code = op::sequence, .a = first, .b = static_cast<uint32_t>(items.size()) });
+    }
+
+    uint32_t add_site(const std::shared_ptr<identifire>& callee, const fun_literal* target, std::shared_ptr<const fun_literal> keep, std::vector<uint32_t> args)
+    {
+      m_fn->m_sites.push_back({ .callee = callee, .target = target, .keep = std::move(keep), .args = std::move(args) });
+      return static_cast<uint32_t>(m_fn->m_sites.size() - 1);
+    }
+
+    //a block's value is its last statement's, like eval_block_statement
+    result compile_block(const std::shared_ptr<block>& blk)
+    {
+      if(!blk || blk->statements.empty())
+        return std::nullopt;
+
+      std::vector<uint32_t> items;
+      auto type = int_type::none;
+      for(const auto& stmt : blk->statements)
+      {
+        auto compiled = compile_statement(stmt);
+        if(!compiled)
+          return std::nullopt;
+        items.push_back(compiled->at);
+        type = compiled->type;
+      }
+      return typed{ type, emit_sequence(items) };
+    }
+
+    //blocks under an if or a loop may not run, a var in them doesn't count as defined after
+    result compile_nested(const std::shared_ptr<block>& blk)
+    {
+      auto saved = m_defined;
+      auto compiled = compile_block(blk);
+      m_defined = std::move(saved);
+      return compiled;
+    }
+
+    result compile_statement(const std::shared_ptr<statement>& stmt)
+    {
+      switch(stmt->get_type())
+      {
+        case node_type::var:
+        {
+          auto var_node = std::static_pointer_cast<var>(stmt);
+          auto value = compile_expression(var_node->value);
+          if(!value || !assign(var_node->name.sym, value->type))
+            return std::nullopt;
+          m_defined.insert(var_node->name.sym);
+          return typed{ int_type::none, emit({ .code = op::store, .a = m_slots.at(var_node->name.sym), .b = value->at }) };
+        }
+        case node_type::ret:
+          return compile_expression(std::static_pointer_cast<ret>(stmt)->return_value);
+        case node_type::expression_statement:
+          return compile_expression(std::static_pointer_cast<expression_statement>(stmt)->_expression);
+        case node_type::block:
+          return compile_block(std::static_pointer_cast<block>(stmt));
+        default:
+          return std::nullopt;
+      }
+    }
+
+    result compile_expression(const std::shared_ptr<expression>& expr)
+    {
+      if(!expr)
+        return std::nullopt;
+
+      switch(expr->get_type())
+      {
+        case node_type::integer:
+          return typed{ int_type::integer, emit_constant(std::static_pointer_cast<integer_literal>(expr)->value) };
+        case node_type::boolean:
+          return typed{ int_type::boolean, emit_constant(std::static_pointer_cast<boolean_literal>(expr)->value) };
+        case node_type::constant:
+        {
+          const auto& value = std::static_pointer_cast<constant>(expr)->value;
+          switch(value->get_type())
+          {
+            case object_type::integer:
+              return typed{ int_type::integer, emit_constant(std::static_pointer_cast<integer>(value)->get_value()) };
+            case object_type::boolean:
+              return typed{ int_type::boolean, emit_constant(std::static_pointer_cast<boolean>(value)->get_value()) };
+            case object_type::null:
+              return typed{ int_type::none, emit_constant(0) }; //a loop that never runs
+            default:
+              return std::nullopt;
+          }
+        }
+        case node_type::identifire:
+        {
+          auto sym = std::static_pointer_cast<identifire>(expr)->sym;
+          auto slot = m_slots.find(sym);
+          if(slot == m_slots.end() || !m_defined.contains(sym))
+            return std::nullopt;
+          return typed{ m_types.at(sym), emit({ .code = op::load, .a = slot->second }) };
+        }
+        case node_type::prefix:
+        {
+          auto prefix_node = std::static_pointer_cast<prefix>(expr);
+          auto right = compile_expression(prefix_node->right);
+          if(!right)
+            return std::nullopt;
+          if(prefix_node->op == operator_type::minus && is_int(right->type))
+            return typed{ int_type::integer, emit({ .code = op::neg, .a = right->at }) };
+          if(prefix_node->op == operator_type::bang && is_int(right->type))
+            return typed{ int_type::boolean, emit({ .code = op::truthy, .a = right->at }) };
+          if(prefix_node->op == operator_type::bang && right->type == int_type::boolean)
+            return typed{ int_type::boolean, emit({ .code = op::negate, .a = right->at }) };
+          return std::nullopt;
+        }
+        case node_type::infix:
+          return compile_infix(std::static_pointer_cast<infix>(expr));
+        case node_type::_if:
+        {
+          auto if_node = std::static_pointer_cast<_if>(expr);
+          auto cond = compile_expression(if_node->condition);
+          if(!cond || cond->type == int_type::none)
+            return std::nullopt;
+          auto consequence = compile_nested(if_node->consequence);
+          if(!consequence)
+            return std::nullopt;
+
+          //without an else the value is null when the condition is false
+          auto type = int_type::none;
+          auto alternative = int_function::none;
+          if(if_node->alternative)
+          {
+            auto compiled = compile_nested(if_node->alternative);
+            if(!compiled)
+              return std::nullopt;
+            alternative = compiled->at;
+            type = join(consequence->type, compiled->type);
+          }
+          return typed{ type, emit({ .code = op::branch, .a = cond->at, .b = consequence->at, .c = alternative }) };
+        }
+        case node_type::_while:
+        {
+          auto loop = std::static_pointer_cast<_while>(expr);
+          auto cond = compile_expression(loop->condition);
+          if(!cond || cond->type == int_type::none)
+            return std::nullopt;
+          auto body = compile_nested(loop->body);
+          if(!body)
+            return std::nullopt;
+          return typed{ int_type::none, emit({ .code = op::loop, .a = cond->at, .b = body->at }) };
+        }
+        case node_type::call:
+          return compile_call(std::static_pointer_cast<call>(expr));
+        case node_type::inlined:
+          return compile_inlined(std::static_pointer_cast<inlined_call>(expr));
+        default:
+          return std::nullopt; //strings, arrays, closures, builtins and anything else boxed
+      }
+    }
+
+    static int_type join(int_type a, int_type b)
+    {
+      if(a == int_type::bottom)
+        return b;
+      if(b == int_type::bottom || a == b)
+        return a;
+      return int_type::none;
+    }
+
+    result compile_infix(const std::shared_ptr<infix>& infix_node)
+    {
+      auto left = compile_expression(infix_node->left);
+      auto right = left ? compile_expression(infix_node->right) : std::nullopt;
+      if(!right)
+        return std::nullopt;
+
+      bool ints = is_int(left->type) && is_int(right->type);
+      bool bools = is_bool(left->type) && is_bool(right->type);
+      bool fork = infix_node->fork && m_fn->m_code[left->at].code == op::call && m_fn->m_code[right->at].code == op::call;
+      auto binary = [&](op code, int_type type) -> result {
+        return typed{ type, emit({ .code = code, .a = left->at, .b = right->at, .fork = fork }) };
+      };
+      switch(infix_node->op)
+      {
+        case operator_type::plus:
+          return ints ? binary(op::add, int_type::integer) : std::nullopt;
+        case operator_type::minus:
+          return ints ? binary(op::sub, int_type::integer) : std::nullopt;
+        case operator_type::astrisk:
+          return ints ? binary(op::mul, int_type::integer) : std::nullopt;
+        case operator_type::slash:
+          return ints ? binary(op::div, int_type::integer) : std::nullopt;
+        case operator_type::less:
+          return ints ? binary(op::less, int_type::boolean) : std::nullopt;
+        case operator_type::greater:
+          return ints ? binary(op::greater, int_type::boolean) : std::nullopt;
+        case operator_type::equal:
+          return ints || bools ? binary(op::equal, int_type::boolean) : std::nullopt;
+        case operator_type::not_equal:
+          return ints || bools ? binary(op::not_equal, int_type::boolean) : std::nullopt;
+        default:
+          return std::nullopt;
+      }
+    }
+
+    //the callee's name can't be one of the function's own, it's looked up where the
+    //function was made like the generic call would
+    std::shared_ptr<identifire> free_callee(const std::shared_ptr<expression>& function)
+    {
+      if(function->get_type() != node_type::identifire)
+        return nullptr;
+      auto ident = std::static_pointer_cast<identifire>(function);
+      return m_slots.contains(ident->sym) ? nullptr : ident;
+    }
+
+    result compile_call(const std::shared_ptr<call>& call_node)
+    {
+      auto callee = free_callee(call_node->function);
+      auto target = callee && m_resolve ? m_resolve(callee->sym) : nullptr;
+      if(!target || target->parameters.size() != call_node->arguments.size())
+        return std::nullopt;
+
+      auto type = m_self;
+      bool self = target.get() == &m_literal;
+      if(!self)
+      {
+        if(!target->specialized)
+          return std::nullopt;
+        type = target->specialized->returns_boolean() ? int_type::boolean : int_type::integer;
+      }
+
+      std::vector<uint32_t> args;
+      for(const auto& arg : call_node->arguments)
+      {
+        auto compiled = compile_expression(arg);
+        if(!compiled || !is_int(compiled->type))
+          return std::nullopt;
+        args.push_back(compiled->at);
+      }
+      auto site = add_site(callee, target.get(), self ? nullptr : target, std::move(args));
+      return typed{ type, emit({ .code = op::call, .a = site }) };
+    }
+
+    //the inlined copy runs in this frame behind the same check eval_inlined_call makes
+    result compile_inlined(const std::shared_ptr<inlined_call>& inline_node)
+    {
+      auto callee = free_callee(inline_node->original->function);
+      if(!callee || !inline_node->builtins.empty())
+        return std::nullopt;
+
+      std::vector<uint32_t> items;
+      for(const auto& [i, sym] : inline_node->parameters)
+      {
+        auto arg = compile_expression(inline_node->original->arguments[i]);
+        if(!arg || !assign(sym, arg->type))
+          return std::nullopt;
+        m_defined.insert(sym);
+        items.push_back(emit({ .code = op::store, .a = m_slots.at(sym), .b = arg->at }));
+      }
+      auto body = compile_nested(inline_node->body);
+      if(!body)
+        return std::nullopt;
+      items.push_back(body->at);
+
+      auto seq = emit_sequence(items);
+      auto site = add_site(callee, inline_node->target.get(), nullptr, {});
+      return typed{ body->type, emit({ .code = op::guard, .a = site, .b = seq }) };
+    }
+  private:
+    const fun_literal& m_literal;
+    const literal_resolver& m_resolve;
+    std::shared_ptr<int_function> m_fn;
+    std::unordered_map<symbol, uint32_t> m_slots;
+    std::unordered_map<symbol, int_type> m_types;
+    std::unordered_set<symbol> m_defined;
+    int_type m_self = int_type::bottom; //what calls to itself return
+    bool m_changed = false;
+  };
+
+  std::shared_ptr<int_function> specialize_function(const fun_literal& literal, const literal_resolver& resolve)
+  {
+    return int_compiler(literal, resolve).compile();
+  }
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "ast.hpp"
+#include "intern.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+namespace my_ns
+{
+  class environment;
+
+  //a fun body that only ever works on integers, compiled to a small tree of int64 ops over
+  //frame slots. values stay unboxed and no op checks a type, the check happens once when a
+  //call comes in. overflow, division by zero, a callee name bound to something else or deep
+  //recursion give up, and the call runs again as written. that's safe because nothing the
+  //code does can be seen from outside its frame, for the same reason two calls that are the
+  //operands of one op can run as forks
+  class int_function
+  {
+  public:
+    enum class op : uint8_t
+    {
+      constant, load, store, add, sub, mul, div, less, greater, equal, not_equal,
+      neg, truthy, negate, sequence, branch, loop, guard, call
+    };
+
+    static constexpr uint32_t none = UINT32_MAX;
+
+    //operands are other instrs, a slot, or for sequence the first and count in m_lists.
+    //fork is set on a binary op whose operands are both calls
+    struct instr
+    {
+      op code;
+      uint32_t a = none;
+      uint32_t b = none;
+      uint32_t c = none;
+      int64_t value = 0;
+      bool fork = false;
+    };
+
+    //a call or an inlined body, it only stands while the name holds the literal it was
+    //compiled against. a callee other than the function itself is kept alive so a new
+    //literal can't take its address, the function itself or an inlined one already is
+    struct call_site
+    {
+      std::shared_ptr<identifire> callee;
+      const fun_literal* target;
+      std::shared_ptr<const fun_literal> keep;
+      std::vector<uint32_t> args;
+    };
+  public:
+    inline bool returns_boolean() const
+    {
+      return m_boolean;
+    }
+    inline size_t slot_count() const
+    {
+      return m_slots;
+    }
+    inline size_t size() const
+    {
+      return m_code.size();
+    }
+    //a call gave up on it, every call after runs as written
+    inline bool gave_up() const
+    {
+      return m_gave_up.load(std::memory_order_relaxed);
+    }
+  private:
+    //false when the call has to give up, out is only meaningful on true
+    bool exec(uint32_t at, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const;
+    bool operand(uint32_t at, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const;
+    bool operands(const instr& in, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& l, int64_t& r) const;
+    bool call(const call_site& site, const std::shared_ptr<environment>& callee_env, int64_t* frame, const std::shared_ptr<environment>& env, size_t depth, int64_t& out) const;
+  private:
+    friend class int_compiler;
+    friend std::shared_ptr<object> run_specialized(fun_literal&, const std::shared_ptr<environment>&, const std::vector<std::shared_ptr<object>>&);
+
+    std::vector<instr> m_code;
+    std::vector<uint32_t> m_lists;
+    std::vector<call_site> m_sites;
+    std::vector<uint32_t> m_params; //the slot each argument goes to
+    size_t m_slots = 0;
+    uint32_t m_entry = none;
+    bool m_boolean = false;
+    std::atomic<bool> m_gave_up = false;
+  };
+
+  //a free name in call position to the function literal it's bound to, nullptr if unknown
+  using literal_resolver = std::function<std::shared_ptr<fun_literal>(const symbol&)>;
+
+  //infers a type for every param and local, flow insensitive. params are integers, a local
+  //is whatever all of its vars agree on. nullptr when anything in the body can't be proven
+  //to be an integer or a boolean, or reads a name that isn't a param or a local
+  std::shared_ptr<int_function> specialize_function(const fun_literal& literal, const literal_resolver& resolve);
+
+  //the call through literal's specialized body, nullptr when it has to run as written.
+  //arguments that aren't all integers just skip it, giving up marks it as not to be used again
+  std::shared_ptr<object> run_specialized(fun_literal& literal, const std::shared_ptr<environment>& env, const std::vector<std::shared_ptr<object>>& args);
+}
@@ -1,24 +1,90 @@
 #include "token.hpp"
-#include <unordered_map>
+#include <algorithm>
+#include <array>
+#include <cstdint>
 #include <string_view>
 
 namespace my_ns
 {
   using namespace std::string_view_literals;
 
-  static std::unordered_map<std::string_view, token_type> s_keywords = {
-    { "fun"sv, token_type::fun },
-    { "var"sv, token_type::var },
-    { "if"sv, token_type::_if },
-    { "else"sv, token_type::_else },
-    { "true"sv, token_type::_true },
-    { "false"sv, token_type::_false },
-    { "ret"sv, token_type::ret }
-  };
-
-  token_type lookup_identifier(const std::string& id)
+  namespace
   {
-    auto it = s_keywords.find(id);
-    return it != s_keywords.end() ? it->second : token_type::identifire;
+    struct keyword
+    {
+      std::string_view text;
+      token_type type;
+    };
+
+    constexpr keyword s_keywords[] = {
+      { "fun"sv, token_type::fun },
+      { "var"sv, token_type::var },
+      { "if"sv, token_type::_if },
+      { "else"sv, token_type::_else },
+      { "true"sv, token_type::_true },
+      { "false"sv, token_type::_false },
+      { "ret"sv, token_type::ret },
+      { "import"sv, token_type::_import },
+      { "while"sv, token_type::_while },
+      { "for"sv, token_type::_for },
+      { "in"sv, token_type::_in }
+    };
+
+    //perfect hash over the keywords, the seed is searched at compile time so every
+    //keyword lands in its own slot and a lookup is one hash and one compare
+    constexpr size_t table_size = 32;
+
+    constexpr uint32_t keyword_hash(std::string_view str, uint32_t seed)
+    {
+      auto first = static_cast<uint8_t>(str.front());
+      auto last = static_cast<uint8_t>(str.back());
+      uint32_t h = (first * seed) ^ (last * (seed >> 7 | 1)) ^ static_cast<uint32_t>(str.size() * 0x9e37u);
+      return (h ^ (h >> 11)) % table_size;
+    }
+
+    constexpr uint32_t find_seed()
+    {
+      for(uint32_t seed = 1; seed < 1'000'000; ++seed)
+      {
+        std::array<bool, table_size> used{};
+        bool ok = true;
+        for(const auto& kw : s_keywords)
+        {
+          auto h = keyword_hash(kw.text, seed);
+          if(used[h])
+          {
+            ok = false;
+            break;
+          }
+          used[h] = true;
+        }
+        if(ok)
+          return seed;
+      }
+      return 0;
+    }
+
+    constexpr uint32_t s_seed = find_seed();
+    static_assert(s_seed != 0, "no perfect hash seed for the keyword set");
+
+    constexpr size_t s_min_len = [] { size_t m = SIZE_MAX; for(const auto& kw : s_keywords) m = std::min(m, kw.text.size()); return m; }();
+    constexpr size_t s_max_len = [] { size_t m = 0; for(const auto& kw : s_keywords) m = std::max(m, kw.text.size()); return m; }();
+
+    constexpr auto s_table = [] {
+      std::array<keyword, table_size> table{};
+      for(auto& slot : table)
+        slot = { ""sv, token_type::identifire };
+      for(const auto& kw : s_keywords)
+        table[keyword_hash(kw.text, s_seed)] = kw;
+      return table;
+    }();
+  }
+
+  token_type lookup_identifier(std::string_view id)
+  {
+    if(id.size() < s_min_len || id.size() > s_max_len)
+      return token_type::identifire;
+    const auto& slot = s_table[keyword_hash(id, s_seed)];
+    return slot.text == id ? slot.type : token_type::identifire;
   }
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <cstdint>
 #include <string>
 #include <string_view>
 
@@ -6,35 +8,34 @@
 
 namespace my_ns
 {
-  enum class token_type
+  enum class token_type : uint8_t
   {
-    illegal, eof, identifire, integer, string,
+    illegal, eof, identifire, integer, floating, string,
     assign, plus, minus, astrisk, slash,
     comma, semicolon, colon, bang,
     equal, not_equal, less, greater,
     l_paren, r_paren, l_brace, r_brace, l_bracket, r_bracket,
-    fun, var, _if, _else, _true, _false, ret
+    fun, var, _if, _else, _true, _false, ret, _import, _while, _for, _in
   };
 
+  constexpr size_t token_type_count = static_cast<size_t>(token_type::_in) + 1;
+
+  //literal is a view into the lexer input, the source must outlive every token and
+  //every AST node made from it
   struct token
   {
     token() = default;
-    token(token_type tp, char ch)
-      : type(tp)
-    {
-      literal = { ch };
-    }
-
-    token(token_type tp, const std::string& str)
-      : type(tp), literal(str)
+    token(token_type tp, std::string_view str, size_t off = 0)
+      : type(tp), literal(str), offset(off)
     {
     }
 
-    token_type type;
-    std::string literal;
+    token_type type = token_type::illegal;
+    std::string_view literal;
+    size_t offset = 0; //byte offset of the literal in the source
   };
 
-  token_type lookup_identifier(const std::string& id);
+  token_type lookup_identifier(std::string_view id);
 
   constexpr std::string_view token_type_to_string(const token_type t)
   {
@@ -45,6 +46,7 @@ namespace my_ns
       case token_type::eof:        return "eof"sv;
       case token_type::identifire: return "identifire"sv;
       case token_type::integer:    return "integer"sv;
+      case token_type::floating:   return "floating"sv;
       case token_type::string:     return "string"sv;
       case token_type::assign:     return "assign"sv;
       case token_type::plus:       return "plus"sv;
@@ -72,6 +74,10 @@ namespace my_ns
       case token_type::_true:      return "true"sv;
       case token_type::_false:     return "false"sv;
       case token_type::ret:        return "ret"sv;
+      case token_type::_import:    return "import"sv;
+      case token_type::_while:     return "while"sv;
+      case token_type::_for:       return "for"sv;
+      case token_type::_in:        return "in"sv;
     }
     return "unknown"sv;
   }
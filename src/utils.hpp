@@ -1,26 +1,69 @@
 #pragma once
 
 #include <cstddef>
+#include <cstdint>
+#include <cstring>
 #include <string>
+#include <string_view>
 
 namespace my_ns::utils
 {
   using hash_type = size_t;
-  inline constexpr hash_type fnv1a_hash(const char* str, size_t hash = 14695981039346656037ULL)
+
+  //compile time hash, keep it for constexpr tables. use fast_hash at runtime
+  inline constexpr hash_type fnv1a_hash(const std::string_view str, size_t hash = 14695981039346656037ULL)
   {
-    return (*str == 0) ? hash : fnv1a_hash(str + 1, (hash ^ static_cast<size_t>(*str)) * 1099511628211ULL);
+    for(auto ch : str)
+      hash = (hash ^ static_cast<size_t>(ch)) * 1099511628211ULL;
+    return hash;
   }
 
-  inline constexpr hash_type fnv1a_hash(const std::string_view str, size_t hash = 14695981039346656037ULL)
+  inline constexpr hash_type fnv1a_hash(const char* str, size_t hash = 14695981039346656037ULL)
   {
-    return fnv1a_hash(str, hash);
+    return fnv1a_hash(std::string_view(str), hash);
   }
 
   inline constexpr hash_type fnv1a_hash(const std::string& str, size_t hash = 14695981039346656037ULL)
   {
-    return fnv1a_hash(str.c_str(), hash);
+    return fnv1a_hash(std::string_view(str), hash);
+  }
+
+  inline constexpr uint64_t hash_mix(uint64_t h)
+  {
+    //murmur3 finalizer
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
   }
 
+  //word at a time hash, reads 8 bytes per step instead of one
+  inline hash_type fast_hash(const std::string_view str)
+  {
+    constexpr uint64_t mul = 0x9e3779b97f4a7c15ULL;
+    const char* data = str.data();
+    size_t len = str.size();
+    uint64_t h = len * mul;
+
+    while(len >= 8)
+    {
+      uint64_t word;
+      std::memcpy(&word, data, 8);
+      h = (h ^ hash_mix(word)) * mul;
+      data += 8;
+      len -= 8;
+    }
+
+    if(len)
+    {
+      uint64_t word = 0;
+      std::memcpy(&word, data, len);
+      h = (h ^ hash_mix(word)) * mul;
+    }
+    return static_cast<hash_type>(hash_mix(h));
+  }
 
   inline constexpr hash_type hash_combine(hash_type lhs, hash_type rhs)
   {
@@ -1,18 +1,35 @@
 #include <gtest/gtest.h>
 #include "evaluator.hpp"
+#include "optimizer.hpp"
 #include "parser.hpp"
 #include "lexer.hpp"
+#include "fork_join.hpp"
+#include "memo.hpp"
 
 namespace my_ns {
 
-std::shared_ptr<object> test_eval(const std::string& input) {
+std::shared_ptr<object> test_eval(const std::string& input, bool lazy = false) {
     lexer l(input);
-    parser p(&l);
+    parser p(&l, lazy);
     auto prog = p.parse_program();
     auto env = std::make_shared<environment>();
     return eval(prog, env);
 }
 
+//the tree's tokens point into input, it has to outlive them
+std::shared_ptr<program> test_parse_optimized(const std::string& input) {
+    lexer l(input);
+    parser p(&l);
+    auto prog = p.parse_program();
+    get_optimizer().optimize(prog);
+    return prog;
+}
+
+std::pair<std::shared_ptr<object>, std::shared_ptr<environment>> test_eval_optimized(const std::string& input, std::shared_ptr<environment> env = std::make_shared<environment>()) {
+    auto res = eval(test_parse_optimized(input), env);
+    return {res, env};
+}
+
 TEST(EvaluatorTest, TestIntegerExpression) {
     struct TestCase {
         std::string input;
@@ -55,6 +72,33 @@ TEST(EvaluatorTest, TestBooleanExpression) {
     }
 }
 
+TEST(EvaluatorTest, TestOperatorDispatch) {
+    struct TestCase {
+        std::string input;
+        std::string expected;
+    };
+    std::vector<TestCase> tests = {
+        {"7 - 2 * 3", "1"},
+        {"7 / 2", "3"},
+        {"3 != 4", "true"},
+        {"3 > 4", "false"},
+        {"true != false", "true"},
+        {"true < false", "null"},
+        {"!5", "true"},
+        {"!0", "false"},
+        {"!\"s\"", "false"},
+        {"\"a\" + \"b\"", "ab"},
+        {"\"a\" - \"b\"", "error: unknown operator: - 2 2"},
+        {"1 + true", "error: type mismatch: 1 + 5"},
+        {"-true", "error: unknown operator: - 5"},
+    };
+
+    for (const auto& test : tests) {
+        auto result = test_eval(test.input);
+        EXPECT_EQ(result->inspect(), test.expected) << "Input: " << test.input;
+    }
+}
+
 TEST(EvaluatorTest, TestIfElse) {
     struct TestCase {
         std::string input;
@@ -88,7 +132,37 @@ TEST(EvaluatorTest, TestBuiltins) {
     std::vector<TestCase> tests = {
         {"str_len(\"hello\")", "5"},
         {"len([1, 2, 3])", "3"},
-        {"to_string(42)", "42"}
+        {"to_string(42)", "42"},
+        {"str_len(\"ab\" + \"cd\" + \"e\")", "5"}
+    };
+
+    for (const auto& test : tests) {
+        auto result = test_eval(test.input);
+        EXPECT_EQ(result->inspect(), test.expected) << "Input: " << test.input;
+    }
+}
+
+TEST(EvaluatorTest, TestStringLibrary) {
+    struct TestCase {
+        std::string input;
+        std::string expected;
+    };
+    std::vector<TestCase> tests = {
+        {"substr(\"hello world\", 6)", "world"},
+        {"substr(\"hello world\", 0, 5)", "hello"},
+        {"substr(\"hello\", 10)", ""},
+        {"find(\"hello world\", \"o w\")", "4"},
+        {"find(\"hello world\", \"o\", 5)", "7"},
+        {"find(\"hello\", \"xyz\")", "-1"},
+        {"find(\"aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab\", \"aab\")", "40"},
+        {"len(split(\"a,b,,c\", \",\"))", "4"},
+        {"split(\"a::b::c\", \"::\")[2]", "c"},
+        {"split(\"a,b\", \",\")[0] + split(\"a,b\", \",\")[1]", "ab"},
+        {"starts_with(\"prefix_rest\", \"prefix\")", "true"},
+        {"starts_with(\"pre\", \"prefix\")", "false"},
+        {"trim(\"  padded \")", "padded"},
+        {"str_len(trim(\"   \"))", "0"},
+        {"{\"key\": 1}[substr(\"a key\", 2)]", "1"}
     };
 
     for (const auto& test : tests) {
@@ -97,6 +171,58 @@ TEST(EvaluatorTest, TestBuiltins) {
     }
 }
 
+TEST(EvaluatorTest, TestRecords) {
+    struct TestCase {
+        std::string input;
+        std::string expected;
+    };
+    std::vector<TestCase> tests = {
+        {"var p = {\"x\": 1, \"y\": 2}; p[\"x\"] + p[\"y\"]", "3"},
+        {"var p = {\"x\": 1, \"y\": 2}; p[\"z\"]", "null"},
+        {"var p = {\"x\": 1, \"y\": 2}; var k = \"y\"; p[k]", "2"},
+        {"var p = {\"x\": 1}; p[1]", "null"},
+        {"var mk = fun(a) { {\"v\": a, \"w\": a * 2} }; var get = fun(r) { r[\"w\"] }; get(mk(1)) + get(mk(2)) + get({\"w\": 10})", "16"},
+        {"var get = fun(r) { r[\"w\"] }; get({\"w\": 1, \"a\": 0}) + get({\"b\": 0, \"w\": 2}) + get({1: 5, \"w\": 3})", "6"}
+    };
+
+    for (const auto& test : tests) {
+        auto result = test_eval(test.input);
+        EXPECT_EQ(result->inspect(), test.expected) << "Input: " << test.input;
+    }
+}
+
+TEST(EvaluatorTest, TestSets) {
+    struct TestCase {
+        std::string input;
+        std::string expected;
+    };
+    std::vector<TestCase> tests = {
+        {"len(set([1, 2, 2, 3, 1]))", "3"},
+        {"len(set())", "0"},
+        {"has(set([1, 2, 3]), 2)", "true"},
+        {"has(set([1, 2, 3]), 4)", "false"},
+        {"has(set([\"a\", \"b\"]), \"a\")", "true"},
+        {"has(set([1]), \"1\")", "false"},
+        {"has({\"k\": 1}, \"k\")", "true"},
+        {"var s = set([1]); var t = add(s, 2); len(s) + len(t)", "3"},
+        {"var s = add(add(add(add(set(), 1), 2), 2), 3); var t = add(s, 9); [len(s), len(t), has(s, 9)]", "[3, 4, false, ]"},
+        {"len(union(set([1, 2, 3]), set([3, 4])))", "4"},
+        {"len(intersect(set([1, 2, 3]), set([2, 3, 4])))", "2"},
+        {"has(difference(set([1, 2, 3]), set([2])), 2)", "false"},
+        {"len(difference(set([1, 2, 3]), set([2])))", "2"},
+        {"set([[1]])", "error"}
+    };
+
+    for (const auto& test : tests) {
+        auto result = test_eval(test.input);
+        if (test.expected == "error") {
+            EXPECT_EQ(result->get_type(), object_type::error) << "Input: " << test.input;
+            continue;
+        }
+        EXPECT_EQ(result->inspect(), test.expected) << "Input: " << test.input;
+    }
+}
+
 TEST(EvaluatorTest, TestRecursion) {
     std::string input = "var factorial = fun(x) { if (x == 0) { 1 } else { x * factorial(x - 1) } }; factorial(5);";
     auto result = test_eval(input);
@@ -132,6 +258,8 @@ TEST(EvaluatorTest, TestComplexExpressions) {
         {"if (10 > 1) { if (10 < 20) { 1 } else { 0 } } else { 0 }", "1"},
         {"[1, 2, 3][1];", "2"},
         {"{\"one\": 1, \"two\": 2}[\"one\"];", "1"},
+        {"var a = \"t\" + \"w\"; {\"tw\": 2}[a + \"\"];", "2"},
+        {"\"foo\" + \"bar\" + \"baz\"", "foobarbaz"},
         //error {"var fib = fun(n) { puts(\"fib\"); puts(to_string(n)); if (n <= 1) { n } else { fib(n - 1) + fib(n - 2) } }; fib(5);", "55"}
     };
 
@@ -141,4 +269,437 @@ TEST(EvaluatorTest, TestComplexExpressions) {
     }
 }
 
+TEST(EvaluatorTest, TestLazyFunctionBodies) {
+    std::vector<std::string> inputs = {
+        "var add = fun(x, y) { ret x + y; }; add(2, 3)",
+        "var mk = fun(a) { fun(b) { {\"s\": a + b}[\"s\"] } }; mk(1)(2) * mk(3)(4)",
+        "var fact = fun(n) { if (n < 2) { 1 } else { n * fact(n - 1) } }; fact(10)",
+        "var f = fun() { \"}{\" }; f() + f()",
+    };
+    for (const auto& input : inputs) {
+        auto eager = test_eval(input);
+        auto lazy = test_eval(input, true);
+        EXPECT_EQ(lazy->inspect(), eager->inspect()) << "Input: " << input;
+    }
+
+    //a broken body only matters once it is called
+    auto unused = test_eval("var bad = fun() { var = }; 7", true);
+    EXPECT_EQ(unused->inspect(), "7");
+    auto called = test_eval("var bad = fun() { var = }; bad()", true);
+    EXPECT_EQ(called->get_type(), object_type::error);
+}
+
+TEST(EvaluatorTest, TestOptimizer) {
+    std::vector<std::string> inputs = {
+        "60 * 60 * 24",
+        "-(2 + 3) * !false",
+        "\"foo\" + \"bar\" + \"baz\"",
+        "if (1 < 2) { 10 } else { 20 }",
+        "if (1 > 2) { 10 } else { 20 }",
+        "if (false) { 10 }",
+        "var f = fun(x) { x * (2 + 3) }; f(4) + f(5)",
+        "{\"a\" + \"b\": 1 + 1, \"c\": 3}[\"ab\"]",
+        "[1 + 1, \"x\" + \"y\"][1]",
+        "true + 1",
+        "var g = fun() { 1 / 0 }; 5",
+    };
+    for (const auto& input : inputs) {
+        auto plain = test_eval(input);
+        auto optimized = test_eval_optimized(input).first;
+        EXPECT_EQ(optimized->inspect(), plain->inspect()) << "Input: " << input;
+        EXPECT_EQ(optimized->get_type(), plain->get_type()) << "Input: " << input;
+    }
+
+    //the folded node is what eval sees, literals return the same object every time
+    std::string source = "var secs = 60 * 60 * 24; var name = \"a\"; if (true) { 1 } else { 2 }";
+    auto before = get_optimizer().get_stats();
+    auto prog = test_parse_optimized(source);
+    auto after = get_optimizer().get_stats();
+    EXPECT_EQ(after.folded - before.folded, 2);
+    EXPECT_EQ(after.pruned - before.pruned, 1);
+    EXPECT_EQ(after.removed - before.removed, 4 + 3);
+    EXPECT_EQ(prog->to_string(), "var secs = 86400;var name = a;if true 1 ");
+
+    auto env = std::make_shared<environment>();
+    auto name = std::static_pointer_cast<var>(prog->m_statements[1])->value;
+    EXPECT_EQ(eval(name, env), eval(name, env));
+
+    //a disabled pass leaves the tree alone
+    get_optimizer().set_enabled(false);
+    std::string off_source = "1 + 2";
+    auto off = test_parse_optimized(off_source);
+    get_optimizer().set_enabled(true);
+    EXPECT_EQ(off->to_string(), "(1 + 2)");
+}
+
+TEST(EvaluatorTest, TestInlining) {
+    std::vector<std::string> inputs = {
+        "var sq = fun(x) { x * x }; sq(3) + sq(sq(2))",
+        "var f = fun(a, b) { var t = a * 2; t + b }; var t = 100; f(1, 2) + t",
+        "var sq = fun(x) { x * x }; var g = fun() { sq(4) }; var sq = fun(x) { x + 1 }; g()",
+        "var first = fun(a) { len(a) }; var g = fun(len) { first([1, 2, 3]) }; g(7)",
+        "var first = fun(a) { len(a) }; var len = fun(a) { 99 }; first([1])",
+        "var fact = fun(n) { if (n < 2) { 1 } else { n * fact(n - 1) } }; fact(6)",
+        "var sq = fun(x) { x * x }; var h = fun(sq) { sq(5) }; h(fun(x) { x + 1 })",
+        "var pair = fun(a, b) { [a, b][1] }; var sq = fun(x) { x * x }; pair(sq(2), sq(3))",
+        "var get = fun(m, k) { m[k] }; get({\"a\": 1, \"b\": 2}, \"b\") + get([5, 6], 1)",
+        "var last = fun(x, x) { x }; last(1, 2) + last(3, 4 + 0)",
+    };
+    for (const auto& input : inputs) {
+        auto plain = test_eval(input);
+        auto optimized = test_eval_optimized(input).first;
+        EXPECT_EQ(optimized->inspect(), plain->inspect()) << "Input: " << input;
+    }
+
+    //small bodies without free names are inlined, recursive ones and big ones aren't
+    auto count = [](const std::string& input) {
+        auto before = get_optimizer().get_stats().inlined;
+        test_parse_optimized(input);
+        return get_optimizer().get_stats().inlined - before;
+    };
+    EXPECT_EQ(count("var sq = fun(x) { x * x }; sq(2) + sq(3)"), 2);
+    EXPECT_EQ(count("var fact = fun(n) { if (n < 2) { 1 } else { n * fact(n - 1) } }; fact(6)"), 0);
+    EXPECT_EQ(count("var y = 1; var add = fun(x) { x + y }; add(2)"), 0);
+    EXPECT_EQ(count("var sq = fun(x) { x * x }; sq(2, 3)"), 0);
+
+    get_optimizer().set_inline_budget(2);
+    EXPECT_EQ(count("var sq = fun(x) { x * x }; sq(2)"), 0);
+    get_optimizer().set_inline_budget(32);
+
+    //an inlined body's params and locals stay in its own frame, the scope it ran in only has its own names
+    EXPECT_EQ(count("var f = fun(a, b) { var t = a * 2; t + b }; f(1, 2)"), 1);
+    auto env = test_eval_optimized("var f = fun(a, b) { var t = a * 2; t + b }; var r = f(1, 2) + f(3, 4)").second;
+    EXPECT_EQ((*env->get(intern("r")))->inspect(), "14");
+    EXPECT_EQ(env->get_bindings().size(), 2);
+}
+
+TEST(EvaluatorTest, TestIntrinsics) {
+    //bound only while the count fits, the builtin still reports a wrong one
+    auto before = get_optimizer().get_stats().intrinsics;
+    EXPECT_EQ(test_eval_optimized("str_len(\"abc\") + str_len(trim(\" de \"))").first->inspect(), "5");
+    EXPECT_EQ(get_optimizer().get_stats().intrinsics - before, 3);
+    EXPECT_EQ(test_eval_optimized("str_len(\"a\", \"b\")").first->inspect(), test_eval("str_len(\"a\", \"b\")")->inspect());
+
+    //a param or a var with a builtin's name still wins over the builtin
+    std::vector<std::string> inputs = {
+        "var f = fun(x) { starts_with(x, \"a\") }; var g = fun(starts_with) { f(\"abc\") }; g(1)",
+        "var h = fun(starts_with) { starts_with(1, 2) }; h(fun(a, b) { a + b })",
+        "var r = substr(\"abc\", 1); var substr = fun(a, b) { 42 }; [r, substr(\"x\", 0)]",
+    };
+    for (const auto& input : inputs) {
+        auto plain = test_eval(input);
+        EXPECT_EQ(test_eval_optimized(input).first->inspect(), plain->inspect()) << "Input: " << input;
+    }
+    EXPECT_TRUE(intern("substr").is_shadowed());
+    EXPECT_FALSE(intern("str_len").is_shadowed());
+}
+
+TEST(EvaluatorTest, TestGlobalCache) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"var f = fun(n) { 1 }; var g = fun() { f(0) }; var a = g(); var f = fun(n) { 2 }; [a, g()]", "[1, 2, ]"},
+        {"var cached_x = 1; var f = fun() { cached_x }; var k = fun(cached_x) { f() }; [f(), k(7), f()]", "[1, 1, 1, ]"},
+        {"var count = fun(n, acc) { if (n == 0) { acc } else { count(n - 1, acc + 1) } }; count(500, 0)", "500"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval(input)->inspect(), expected) << "Input: " << input;
+    }
+
+    //a miss is cached too, a name added later still gets found
+    std::string first = "var g = fun() { later_global }; g()";
+    auto prog = test_parse_optimized(first);
+    auto env = std::make_shared<environment>();
+    EXPECT_EQ(eval(prog, env)->get_type(), object_type::error);
+    EXPECT_EQ(test_eval_optimized("var later_global = 5; g()", env).first->inspect(), "5");
+
+    //the same tree run against another global scope resolves there
+    auto other = std::make_shared<environment>();
+    other->set(intern("later_global"), std::make_shared<integer>(9));
+    EXPECT_EQ(eval(prog, other)->inspect(), "9");
+}
+
+TEST(EvaluatorTest, TestLoops) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"var i = 0; var total = 0; while (i < 5) { var total = total + i; var i = i + 1 }; total", "10"},
+        {"var sum = 0; for (x in [1, 2, 3]) { var sum = sum + x * x }; sum", "14"},
+        {"var f = fun(arr) { var acc = 0; for (v in arr) { var acc = acc + v }; acc }; f([4, 5])", "9"},
+        {"var n = 0; for (a in [1, 2]) { for (b in [10, 20]) { var n = n + a * b } }; n", "90"},
+        {"while (false) { 1 }", "null"},
+        {"for (x in []) { 1 }", "null"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval(input)->inspect(), expected) << "Input: " << input;
+    }
+
+    //the loop variable stays in the loop's frame, vars in the body land outside it
+    EXPECT_EQ(test_eval("for (x in [1]) { var seen = x }; seen")->inspect(), "1");
+    EXPECT_EQ(test_eval("for (x in [1]) { 1 }; x")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("for (x in 5) { x }")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("var i = 0; while (i < 3) { var i = i + true }")->get_type(), object_type::error);
+    //while has no frame, a var the body makes is bound in the enclosing scope after the loop
+    EXPECT_EQ(test_eval("var i = 0; while (i < 2) { var last = i; var i = i + 1 }; [i, last]")->inspect(), "[2, 1, ]");
+    EXPECT_EQ(test_eval("var f = fun() { var i = 0; while (i < 1) { var inner = 7; var i = i + 1 }; inner }; f()")->inspect(), "7");
+    EXPECT_EQ(test_eval("var f = fun() { var i = 0; while (i < 1) { var inner = 7; var i = i + 1 }; 0 }; f(); inner")->get_type(), object_type::error);
+
+    //far more iterations than recursion could take without running out of stack
+    EXPECT_EQ(test_eval("var i = 0; while (i < 100000) { var i = i + 1 }; i")->inspect(), "100000");
+    std::vector<std::shared_ptr<object>> elements;
+    for (int64_t i = 0; i < 100000; ++i)
+        elements.push_back(std::make_shared<integer>(i));
+    std::string input = "var total = 0; for (x in big) { var total = total + x }; total";
+    lexer l(input);
+    parser p(&l);
+    auto prog = p.parse_program();
+    auto env = std::make_shared<environment>();
+    env->set(intern("big"), std::make_shared<array>(elements));
+    EXPECT_EQ(eval(prog, env)->inspect(), "4999950000");
+}
+
+TEST(EvaluatorTest, TestFloats) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"1.5 + 2.25", "3.75"},
+        {"1 + 0.5", "1.5"},
+        {"0.5 * 4", "2.0"},
+        {"7 / 2", "3"},
+        {"7 / 2.0", "3.5"},
+        {"-2.5", "-2.5"},
+        {"1.0 / 0", "inf"},
+        {"0.1 + 0.2", "0.30000000000000004"},
+        {"1.5 < 2", "true"},
+        {"2 > 2.5", "false"},
+        {"1 == 1.0", "true"},
+        {"0.5 != 0.5", "false"},
+        {"if (0.0) { 1 } else { 2 }", "2"},
+        {"sum([1, 2, 3])", "6"},
+        {"sum([1, 2.5, 3])", "6.5"},
+        {"sum([])", "0"},
+        {"mean([1, 2, 3, 4])", "2.5"},
+        {"{1.5: \"a\"}[1.5]", "a"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval(input)->inspect(), expected) << "Input: " << input;
+    }
+
+    EXPECT_EQ(test_eval("\"a\" + 1.5")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("mean([])")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("sum([1, \"2\"])")->get_type(), object_type::error);
+
+    //a temporary is overwritten by the next operation, a value something holds never is
+    std::string input = "var x = 0.5; var y = (x * 2.0 + 1.0) * 3.0; var z = -x; [x, y, z, x + x]";
+    EXPECT_EQ(test_eval(input)->inspect(), "[0.5, 6.0, -0.5, 1.0, ]");
+    auto prog = test_parse_optimized(input);
+    EXPECT_EQ(eval(prog, std::make_shared<environment>())->inspect(), "[0.5, 6.0, -0.5, 1.0, ]");
+    EXPECT_EQ(eval(prog, std::make_shared<environment>())->inspect(), "[0.5, 6.0, -0.5, 1.0, ]");
+}
+
+TEST(EvaluatorTest, TestIntegerOverflow) {
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"9223372036854775807 + 1", "9223372036854775808"},
+        {"-9223372036854775807 - 2", "-9223372036854775809"},
+        {"9223372036854775807 + 1 - 1", "9223372036854775807"},
+        {"4294967296 * 4294967296", "18446744073709551616"},
+        {"(-9223372036854775807 - 1) / -1", "9223372036854775808"},
+        {"-(-9223372036854775807 - 1)", "9223372036854775808"},
+        {"(9223372036854775807 + 1) / 2", "4611686018427387904"},
+        {"9223372036854775807 + 1 > 9223372036854775807", "true"},
+        {"9223372036854775807 * 2 == 9223372036854775807 + 9223372036854775807", "true"},
+        {"(9223372036854775807 + 1) * 0.5", "4611686018427387904.0"},
+        {"sum([9223372036854775807, 9223372036854775807, 2])", "18446744073709551616"},
+        {"sum([9223372036854775807, 1, -2])", "9223372036854775806"},
+        {"var f = fun(n) { if (n < 2) { 1 } else { n * f(n - 1) } }; f(30)", "265252859812191058636308480000000"},
+        {"{9223372036854775807 + 1: \"a\"}[9223372036854775807 + 1]", "a"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval(input)->inspect(), expected) << "Input: " << input;
+    }
+    EXPECT_EQ(test_eval("9223372036854775807 + 1 - 1")->get_type(), object_type::integer);
+    EXPECT_EQ(test_eval("1 / 0")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("(9223372036854775807 + 1) / 0")->get_type(), object_type::error);
+}
+
+TEST(EvaluatorTest, TestSpecialization) {
+    auto literal_of = [](const std::shared_ptr<environment>& env, const std::string& name) {
+        return std::static_pointer_cast<fun>(*env->get(intern(name)))->literal;
+    };
+
+    //the specialized code gives what the generic one would, or gives up and lets it run
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(20)", "6765"},
+        {"var f = fun(x) { var y = x * x; y + 0 }; [f(4000000000), f(3)]", "[16000000000000000000, 9, ]"},
+        {"var f = fun(x) { var y = x * x; y + 0 }; [f(3), f(1.5)]", "[9, 2.25, ]"},
+        {"var g = fun(x) { x + 1 }; var h = fun(x) { g(x) * 2 }; var a = h(1); var g = fun(x) { x + 10 }; [a, h(1)]", "[4, 22, ]"},
+        {"var sum_to = fun(n) { var i = 0; var s = 0; while (i < n) { var i = i + 1; var s = s + i; }; s }; sum_to(100)", "5050"},
+        {"var even = fun(n) { if (n < 1) { true } else { !even(n - 1) } }; [even(10), even(7)]", "[true, false, ]"},
+        {"var count = fun(n) { if (n == 0) { 0 } else { 1 + count(n - 1) } }; count(3000)", "3000"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval_optimized(input).first->inspect(), expected) << "Input: " << input;
+    }
+
+    auto [res, env] = test_eval_optimized("var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(10)");
+    EXPECT_NE(literal_of(env, "fib")->specialized, nullptr);
+    std::tie(res, env) = test_eval_optimized("var q = fun(a, b) { a / b }; q(7, 0)");
+    EXPECT_EQ(res->get_type(), object_type::error);
+    EXPECT_EQ(literal_of(env, "q")->specialized, nullptr);
+
+    //anything that isn't provably an integer or a boolean keeps the generic path
+    std::tie(res, env) = test_eval_optimized("var y = 1; var f = fun(x) { x + y }; var s = fun(x) { [x] }; [f(1), s(2)]");
+    EXPECT_EQ(res->inspect(), "[2, [2, ], ]");
+    EXPECT_TRUE(literal_of(env, "f")->specialize_checked);
+    EXPECT_EQ(literal_of(env, "f")->specialized, nullptr);
+    EXPECT_EQ(literal_of(env, "s")->specialized, nullptr);
+}
+
+TEST(EvaluatorTest, TestMemoization) {
+    //results and stats of an explicit cache, errors and unhashable arguments aren't kept
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"var fib = memo(fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }); fib(90)", "2880067194370816120"},
+        {"var fib = memo(fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }); fib(30); var s = memo_stats(fib); [s[\"misses\"], s[\"hits\"]]", "[31, 28, ]"},
+        {"var sq = memo(fun(x) { x * x }, 2); sq(1); sq(2); sq(3); sq(1); var s = memo_stats(sq); [s[\"evictions\"], s[\"size\"], s[\"misses\"]]", "[2, 2, 4, ]"},
+        {"var sq = memo(fun(x) { x * x }, 2); sq(1); sq(2); sq(1); sq(3); sq(1); memo_stats(sq)[\"hits\"]", "2"},
+        {"var first = memo(fun(a) { a[0] }); first([4, 5]); first([4, 5]); var s = memo_stats(first); [first([6]), s[\"skipped\"]]", "[6, 2, ]"},
+        {"var l = memo(str_len); [l(\"ab\"), l(\"ab\"), memo_stats(l)[\"hits\"]]", "[2, 2, 1, ]"},
+    };
+    for (const auto& [input, expected] : tests) {
+        EXPECT_EQ(test_eval_optimized(input).first->inspect(), expected) << "Input: " << input;
+    }
+    auto env = test_eval_optimized("var inv = memo(fun(x) { 10 / x }); inv(5)").second;
+    for (int i = 0; i < 2; ++i) {
+        EXPECT_EQ(test_eval_optimized("inv(0)", env).first->get_type(), object_type::error);
+    }
+    const auto& cache = *std::static_pointer_cast<memoized>(*env->get(intern("inv")))->cache;
+    EXPECT_EQ(cache.get_stats().misses, 3);
+    EXPECT_EQ(cache.size(), 1);
+    EXPECT_EQ(test_eval("memo(1)")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("memo(fun(x) { x }, 0)")->get_type(), object_type::error);
+    EXPECT_EQ(test_eval("memo_stats(fun(x) { x })")->get_type(), object_type::error);
+
+    //pure only when nothing but the arguments can change what comes back
+    auto pure = [&](const std::string& input, const std::string& name) {
+        auto env = test_eval_optimized(input).second;
+        return get_optimizer().is_pure(std::static_pointer_cast<fun>(*env->get(intern(name)))->literal);
+    };
+    EXPECT_TRUE(pure("var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };", "fib"));
+    EXPECT_TRUE(pure("var sq = fun(x) { x * x }; var h = fun(a, b) { var s = sq(a); s + len([b]) };", "h"));
+    EXPECT_TRUE(pure("var f = fun(n) { var i = 0; while (i < n) { var i = i + 1 }; i };", "f"));
+    EXPECT_FALSE(pure("var f = fun(x) { puts(to_string(x)); x };", "f"));
+    EXPECT_FALSE(pure("var log = fun(x) { puts(x) }; var f = fun(x) { log(\"a\"); x };", "f"));
+    EXPECT_FALSE(pure("var y = 1; var f = fun(x) { x + y };", "f"));
+    EXPECT_FALSE(pure("var f = fun(g, x) { g(x) };", "f"));
+    EXPECT_FALSE(pure("var f = fun(x) { if (x) { var t = 1 }; t };", "f"));
+    EXPECT_FALSE(pure("var f = fun(x) { var r = t; var t = 1; r };", "f"));
+    EXPECT_FALSE(pure("var f = fun(x) { fun(y) { x + y } };", "f"));
+
+    //counted as pure once, however many times it's checked and with or without a cache
+    auto sq = std::static_pointer_cast<fun>(*test_eval_optimized("var sq = fun(x) { x * x };").second->get(intern("sq")))->literal;
+    auto before = get_optimizer().get_stats();
+    EXPECT_TRUE(get_optimizer().is_pure(sq));
+    EXPECT_TRUE(get_optimizer().is_pure(sq));
+    EXPECT_EQ(get_optimizer().get_stats().pure - before.pure, 1);
+    EXPECT_EQ(get_optimizer().get_stats().memoized, before.memoized);
+
+    //automatic memoization keeps results only while the names they came through hold the same
+    get_optimizer().set_auto_memo(true);
+    auto [res, fib_env] = test_eval_optimized("var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(80)");
+    EXPECT_EQ(res->inspect(), "23416728348467685");
+    const auto& table = std::static_pointer_cast<fun>(*fib_env->get(intern("fib")))->literal->memo;
+    ASSERT_NE(table, nullptr);
+    EXPECT_EQ(table->cache.get_stats().misses, 81);
+    EXPECT_EQ(test_eval_optimized("var g = fun(x) { x + 1 }; var f = fun(x) { g(x) * 2 }; var a = f(1); var g = fun(x) { x + 10 }; [a, f(1), f(1)]").first->inspect(), "[4, 22, 22, ]");
+    get_optimizer().set_auto_memo(false);
+}
+
+TEST(EvaluatorTest, TestForkJoin) {
+    //pure calls side by side run as forks, what comes out is what running them in order gives
+    std::vector<std::string> programs = {
+        "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } }; fib(20)",
+        "var fib = fun(n) { if (n < 2) { n * 1.0 } else { fib(n - 1) + fib(n - 2) } }; fib(18)",
+        "var tree = fun(d) { if (d == 0) { [d] } else { [tree(d - 1), tree(d - 1)] } }; var size = fun(t) { if (len(t) == 1) { 1 } else { size(t[0]) + size(t[1]) } }; size(tree(9))",
+        "var rec = fun(n) { if (n < 2) { {\"v\": n} } else { {\"v\": rec(n - 1)[\"v\"] + rec(n - 2)[\"v\"]} } }; rec(14)",
+        "var s = fun(n) { if (n < 1) { \"ab\" } else { s(n - 1) + s(n - 1) } }; var h = fun(n) { len(set([s(n), s(n - 1)])) }; [str_len(s(10)), h(8) + h(9)]",
+        "var sq = fun(x) { x * x }; var f = fun(n) { [sq(n), sq(n + 1), n, sq(n + 2)] }; f(3)",
+        "var bad = fun(x) { -\"s\" }; var ok = fun(x) { x }; [ok(1) + bad(2), bad(3) + bad(4)]",
+    };
+    auto& pool = get_fork_join_pool();
+    auto threads = pool.size();
+    for (const auto& input : programs) {
+        pool.resize(1);
+        auto expected = test_eval_optimized(input).first->inspect();
+        pool.resize(4);
+        EXPECT_EQ(test_eval_optimized(input).first->inspect(), expected) << "Input: " << input;
+    }
+
+    //only pure functions are forked, calls to anything else run in order. without automatic
+    //memoization a forkable function is still counted as pure, once
+    pool.resize(4);
+    auto before = get_optimizer().get_stats();
+    auto [res, env] = test_eval_optimized("var f = fun(n) { if (n < 2) { n } else { f(n - 1) + f(n - 2) } }; var y = 1; var g = fun(x) { x + y }; [f(5) + f(6), g(1) + g(2)]");
+    EXPECT_EQ(res->inspect(), "[13, 5, ]");
+    EXPECT_NE(std::static_pointer_cast<fun>(*env->get(intern("f")))->literal->fork, nullptr);
+    EXPECT_EQ(std::static_pointer_cast<fun>(*env->get(intern("g")))->literal->fork, nullptr);
+    auto after = get_optimizer().get_stats();
+    EXPECT_EQ(after.forkable - before.forkable, 1);
+    EXPECT_EQ(after.pure - before.pure, 1);
+    EXPECT_EQ(after.memoized, before.memoized);
+
+    std::vector<size_t> seen(1000);
+    pool.for_range(0, seen.size(), 7, [&](size_t begin, size_t end) {
+        for (auto i = begin; i < end; ++i)
+            ++seen[i];
+    });
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), seen.size());
+    EXPECT_THROW(pool.invoke([] {}, [] { throw std::runtime_error("task"); }), std::runtime_error);
+    pool.resize(threads);
+}
+
+TEST(EvaluatorTest, TestParallelBuiltins) {
+    //a pure function is spread over the pool, anything else runs in order, both give the same
+    std::string functions = "var sq = fun(x) { x * x }; var add = fun(a, b) { a + b }; var odd = fun(x) { x - (x / 2) * 2 == 1 }; var y = 1; ";
+    std::vector<std::pair<std::string, std::string>> tests = {
+        {"map([1, 2, 3, 4, 5], sq)", "[1, 4, 9, 16, 25, ]"},
+        {"filter([1, 2, 3, 4, 5], odd)", "[1, 3, 5, ]"},
+        {"reduce([1, 2, 3, 4], add, 10)", "20"},
+        {"reduce([\"a\", \"b\", \"c\"], add)", "abc"},
+        {"map([\"ab\", \"c\", \"\"], str_len)", "[2, 1, 0, ]"},
+        {"map([1, 2, 3], fun(x) { x + y })", "[2, 3, 4, ]"},
+        {"map([[1, 2], [3], []], fun(a) { reduce(map(a, sq), add, 0) })", "[5, 9, 0, ]"},
+        {"for_each([1, 2], sq)", "null"},
+        {"map([], sq)", "[]"},
+    };
+    auto& pool = get_fork_join_pool();
+    auto threads = pool.size();
+    for (const auto& [input, expected] : tests) {
+        pool.resize(1);
+        EXPECT_EQ(test_eval_optimized(functions + input).first->inspect(), expected) << "Input: " << input;
+        pool.resize(4);
+        EXPECT_EQ(test_eval_optimized(functions + input).first->inspect(), expected) << "Input: " << input;
+    }
+
+    //the error that comes out is the first one in the array, whether a builtin or a fun gave it
+    std::vector<std::string> failing = {
+        "var big = map([1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16], fun(x) { x }); map(big, fun(x) { if (x == 5) { -true } else { if (x > 9) { -\"s\" } else { x } } })",
+        "map([\"a\", \"bc\", 1, \"d\", [2], \"e\", true, \"f\"], str_len)",
+        "map([4, 3, 2, 1, 0, -1, true, \"s\"], fun(x) { if (x < 2) { -[x] } else { 10 / x } })",
+    };
+    for (const auto& input : failing) {
+        pool.resize(1);
+        auto in_order = test_eval_optimized(input).first;
+        pool.resize(4);
+        auto spread = test_eval_optimized(input).first;
+        EXPECT_EQ(in_order->get_type(), object_type::error) << "Input: " << input;
+        EXPECT_EQ(spread->inspect(), in_order->inspect()) << "Input: " << input;
+    }
+    pool.resize(threads);
+
+    for (const auto& input : {"map(1, sq)", "map([1], 1)", "reduce([], add)", "filter([1])"}) {
+        EXPECT_EQ(test_eval_optimized(functions + input).first->get_type(), object_type::error) << "Input: " << input;
+    }
+
+    //a function map calls is followed like a callee, one that's given in a param could be anything
+    auto [res, env] = test_eval_optimized(functions + "var all = fun(a) { map(a, sq) }; var any = fun(a, f) { map(a, f) }; [all([2]), any([3], sq)]");
+    EXPECT_EQ(res->inspect(), "[[4, ], [9, ], ]");
+    std::vector<memo_dependency> dependencies;
+    EXPECT_TRUE(get_optimizer().is_pure(std::static_pointer_cast<fun>(*env->get(intern("all")))->literal, &dependencies));
+    EXPECT_FALSE(get_optimizer().is_pure(std::static_pointer_cast<fun>(*env->get(intern("any")))->literal, &dependencies));
+}
+
 }  // namespace my_ns
@@ -81,4 +81,75 @@ TEST(LexerTest, TestEqualityOperators) {
     }
 }
 
+TEST(LexerTest, TestTokensViewSource) {
+    std::string input = "var name = \"text\";";
+    lexer l(input);
+    std::vector<size_t> offsets = {0, 4, 9, 11, 17, 18};
+
+    for (auto offset : offsets) {
+        token tok = l.next_token();
+        EXPECT_EQ(tok.offset, offset) << "literal: " << tok.literal;
+        if (tok.type != token_type::eof && tok.type != token_type::string) {
+            EXPECT_EQ(tok.literal.data(), input.data() + offset) << "token should point into the source";
+        }
+    }
+}
+
+TEST(LexerTest, TestKeywordLookup) {
+    EXPECT_EQ(lookup_identifier("fun"), token_type::fun);
+    EXPECT_EQ(lookup_identifier("var"), token_type::var);
+    EXPECT_EQ(lookup_identifier("if"), token_type::_if);
+    EXPECT_EQ(lookup_identifier("else"), token_type::_else);
+    EXPECT_EQ(lookup_identifier("true"), token_type::_true);
+    EXPECT_EQ(lookup_identifier("false"), token_type::_false);
+    EXPECT_EQ(lookup_identifier("ret"), token_type::ret);
+    EXPECT_EQ(lookup_identifier("while"), token_type::_while);
+    EXPECT_EQ(lookup_identifier("for"), token_type::_for);
+    EXPECT_EQ(lookup_identifier("in"), token_type::_in);
+
+    for (auto id : {"fu", "funn", "vat", "iff", "elsa", "tru", "falsy", "re", "x", "returned", "if_", "i", "fore", "whilst", "int"}) {
+        EXPECT_EQ(lookup_identifier(id), token_type::identifire) << id;
+    }
+}
+
+TEST(LexerTest, TestDecimalLiterals) {
+    std::string input = "3.25 10 0.5 7. x";
+    lexer l(input);
+    std::vector<token> expected = {
+        {token_type::floating, "3.25"},
+        {token_type::integer, "10"},
+        {token_type::floating, "0.5"},
+        {token_type::integer, "7"},
+        {token_type::illegal, "."},
+        {token_type::identifire, "x"},
+        {token_type::eof, ""}
+    };
+
+    for (const auto& exp : expected) {
+        token tok = l.next_token();
+        EXPECT_EQ(tok.type, exp.type) << "Token type mismatch for literal: " << exp.literal;
+        EXPECT_EQ(tok.literal, exp.literal) << "Token literal mismatch for type: " << token_type_to_string(exp.type);
+    }
+}
+
+TEST(LexerTest, TestLongRuns) {
+    std::string ident(70, 'a');
+    ident += "_Z9";
+    std::string number(45, '7');
+    std::string text(100, 'x');
+    std::string input = std::string(40, ' ') + "\t\n\r " + ident + std::string(33, '\n') + number + " \"" + text + "\"" + std::string(17, ' ');
+    lexer l(input);
+
+    token tok = l.next_token();
+    EXPECT_EQ(tok.type, token_type::identifire);
+    EXPECT_EQ(tok.literal, ident);
+    tok = l.next_token();
+    EXPECT_EQ(tok.type, token_type::integer);
+    EXPECT_EQ(tok.literal, number);
+    tok = l.next_token();
+    EXPECT_EQ(tok.type, token_type::string);
+    EXPECT_EQ(tok.literal, text);
+    EXPECT_EQ(l.next_token().type, token_type::eof);
+}
+
 }  // namespace my_ns
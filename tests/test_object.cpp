@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include "object.hpp"
 
+#include <algorithm>
+
 namespace my_ns {
 
 TEST(ObjectTest, TestInteger) {
@@ -43,4 +45,119 @@ TEST(ObjectTest, TestEnvironment) {
     EXPECT_EQ(std::static_pointer_cast<integer>(retrieved.value())->get_value(), 10);
 }
 
+TEST(ObjectTest, TestStringHash) {
+    auto a = std::make_shared<string>(std::string(100, 'a'));
+    auto b = std::make_shared<string>(intern(std::string(100, 'a')));
+    auto c = std::make_shared<string>("b");
+    EXPECT_EQ(a->hash(), b->hash());
+    EXPECT_EQ(a->hash(), a->hash());
+    EXPECT_FALSE(a->hash() == c->hash());
+    EXPECT_FALSE(std::make_shared<string>("1")->hash() == std::make_shared<integer>(1)->hash());
+}
+
+TEST(ObjectTest, TestIntern) {
+    auto a = intern("identifier");
+    auto b = intern(std::string("identifier"));
+    EXPECT_EQ(a, b);
+    EXPECT_EQ(a.str(), "identifier");
+    EXPECT_EQ(a.buffer().get(), b.buffer().get());
+    EXPECT_FALSE(find_interned("never_interned_anywhere").has_value());
+}
+
+TEST(ObjectTest, TestRopeConcat) {
+    auto s = std::make_shared<string>("");
+    std::string expected;
+    for (int i = 0; i < 10000; ++i) {
+        auto piece = std::to_string(i);
+        s = string::concat(s, std::make_shared<string>(piece));
+        expected += piece;
+    }
+    EXPECT_EQ(s->size(), expected.size());
+    EXPECT_LT(s->depth(), 64u) << "rope should stay balanced";
+    EXPECT_EQ(s->hash(), std::make_shared<string>(expected)->hash());
+    EXPECT_EQ(s->get_value(), expected);
+    EXPECT_TRUE(s->is_flat());
+}
+
+TEST(ObjectTest, TestShape) {
+    std::vector<symbol> keys = {intern("x"), intern("y")};
+    auto sh = shape::get(keys);
+    EXPECT_EQ(sh, shape::get(keys)) << "same key set should share a shape";
+    EXPECT_EQ(sh->find(intern("y")), 1u);
+    EXPECT_EQ(sh->find(intern("z")), shape::no_slot);
+
+    auto rec = std::make_shared<map>(sh, std::vector<std::shared_ptr<object>>{std::make_shared<integer>(1), std::make_shared<integer>(2)});
+    auto key = std::make_shared<string>("y");
+    auto it = rec->get_map().find(key->hash());
+    ASSERT_NE(it, rec->get_map().end());
+    EXPECT_EQ(it->second.value->inspect(), "2");
+}
+
+TEST(ObjectTest, TestBignum) {
+    bignum max = std::numeric_limits<int64_t>::max();
+    bignum min = std::numeric_limits<int64_t>::min();
+    EXPECT_EQ((max + 1).to_string(), "9223372036854775808");
+    EXPECT_EQ(min.to_string(), "-9223372036854775808");
+    EXPECT_TRUE(min.fits_int64());
+    EXPECT_EQ(min.to_int64(), std::numeric_limits<int64_t>::min());
+    EXPECT_FALSE((-min).fits_int64());
+    EXPECT_EQ((max + 1) - 1, max);
+    EXPECT_TRUE(min < max && -max > min);
+    EXPECT_EQ((max * max).to_string(), "85070591730234615847396907784232501249");
+    EXPECT_EQ((max * max / max), max);
+    EXPECT_EQ((bignum(-7) / bignum(2)).to_int64(), -3);
+    EXPECT_EQ(bignum(5) - bignum(5), bignum());
+
+    //big enough to go through karatsuba and the multi limb division
+    bignum a = 3;
+    bignum b = 7;
+    for (int i = 0; i < 11; ++i) {
+        a = a * a;
+        b = b * b + 1;
+    }
+    ASSERT_GT(a.get_limbs().size(), 64u);
+    EXPECT_EQ(a * b, b * a);
+    EXPECT_EQ((a + 1) * (a + 1), a * a + a + a + 1);
+    EXPECT_EQ((a * b + a - 1) / a, b);
+    EXPECT_EQ((a * b) / b, a);
+
+    auto big = std::make_shared<big_integer>(max + 1);
+    EXPECT_EQ(big->get_type(), object_type::big_integer);
+    EXPECT_EQ(big->inspect(), "9223372036854775808");
+    EXPECT_EQ(big->hash(), std::make_shared<big_integer>(max + 1)->hash());
+}
+
+TEST(ObjectTest, TestHashTrie) {
+    hash_trie<int, int> trie;
+    for (int i = 0; i < 5000; ++i)
+        EXPECT_TRUE(trie.try_emplace(i, i * 2));
+    EXPECT_FALSE(trie.try_emplace(7, 0));
+    EXPECT_EQ(trie.size(), 5000u);
+    EXPECT_EQ(*trie.find(7), 14);
+    EXPECT_EQ(trie.find(5000), nullptr);
+
+    //a copy that's added to leaves the original as it was
+    auto copy = trie;
+    copy.try_emplace(5000, 1);
+    EXPECT_TRUE(copy.contains(5000));
+    EXPECT_FALSE(trie.contains(5000));
+    EXPECT_EQ(trie.size(), 5000u);
+
+    std::vector<int> seen(5001);
+    for (const auto& [key, value] : copy)
+        ++seen[key];
+    EXPECT_EQ(std::count(seen.begin(), seen.end(), 1), 5001);
+
+    //keys whose whole hash is the same still stay apart
+    struct same_hash {
+        size_t operator()(int) const { return 42; }
+    };
+    hash_trie<int, int, same_hash> colliding;
+    for (int i = 0; i < 10; ++i)
+        colliding.try_emplace(i, i);
+    EXPECT_EQ(colliding.size(), 10u);
+    EXPECT_EQ(*colliding.find(9), 9);
+    EXPECT_EQ(std::distance(colliding.begin(), colliding.end()), 10);
+}
+
 }  // namespace my_ns
@@ -2,6 +2,7 @@
 #include "parser.hpp"
 #include "lexer.hpp"
 #include "ast.hpp"
+#include "flat_parser.hpp"
 
 namespace my_ns {
 
@@ -58,6 +59,7 @@ TEST(ParserTest, TestInfixExpression) {
     auto _infix = std::dynamic_pointer_cast<infix>(expr_stmt->_expression);
     ASSERT_NE(_infix, nullptr);
     EXPECT_EQ(_infix->_operator, "+");
+    EXPECT_EQ(_infix->op, operator_type::plus);
 
     auto left = std::dynamic_pointer_cast<integer_literal>(_infix->left);
     ASSERT_NE(left, nullptr);
@@ -110,4 +112,127 @@ TEST(ParserTest, TestFunctionLiteral) {
     ASSERT_EQ(fun_lit->body->statements.size(), 1);
 }
 
+TEST(ParserTest, TestFlatMatchesTree) {
+    std::vector<std::string> inputs = {
+        "var x = 5; ret x * (2 + -y) / 3;",
+        "if (a < b) { a } else { !b }",
+        "var add = fun(x, y) { ret x + y; }; add(1, add(2, 3));",
+        "[1, \"two\", fun() { 3 }][0]",
+        "var m = {\"k\": [1, 2]}; m[\"k\"][1]",
+        "f(a)(b)[c] == g() != true",
+        "\"\"; 'single'",
+        "var m = import \"lib/m.lea\"; m[\"f\"](1)",
+        "while (i < 10) { var i = i + 1 }; for (x in [1, 2]) { puts(x) }",
+        "var r = 1.5 * x - 0.25 / 2",
+    };
+    for(const auto& input : inputs)
+    {
+        lexer tree_lexer(input);
+        parser tree_parser(&tree_lexer);
+        auto tree = tree_parser.parse_program();
+
+        lexer flat_lexer(input);
+        flat_parser fp(&flat_lexer, input);
+        auto flat = fp.parse_program();
+        ASSERT_TRUE(fp.get_errors().empty()) << input;
+
+        auto rebuilt = flat::to_tree(flat);
+        ASSERT_EQ(rebuilt->m_statements.size(), tree->m_statements.size()) << input;
+        EXPECT_EQ(rebuilt->to_string(), tree->to_string()) << input;
+    }
+}
+
+TEST(ParserTest, TestFlatLayout) {
+    std::string input = "var x = 1 + 22; 'str'";
+    lexer l(input);
+    flat_parser p(&l, input);
+    auto ast = p.parse_program();
+    ASSERT_TRUE(p.get_errors().empty());
+
+    auto stmts = ast.list(ast.a(ast.get_root()));
+    ASSERT_EQ(stmts.size(), 2);
+
+    auto var_stmt = stmts[0];
+    ASSERT_EQ(ast.kind(var_stmt), node_type::var);
+    EXPECT_EQ(ast.text(ast.a(var_stmt)), "x");
+
+    auto sum = ast.b(var_stmt);
+    ASSERT_EQ(ast.kind(sum), node_type::infix);
+    EXPECT_EQ(ast.tok_type(sum), token_type::plus);
+    EXPECT_EQ(ast.integer(ast.a(sum)), 1);
+    EXPECT_EQ(ast.integer(ast.b(sum)), 22);
+
+    //the string token still points at its quote
+    auto str = ast.a(stmts[1]);
+    EXPECT_EQ(ast.text(str), "str");
+    EXPECT_EQ(ast.get_token(str).offset, input.find('\''));
+}
+
+TEST(ParserTest, TestFlatErrors) {
+    std::vector<std::string> inputs = { "var = 5;", "if (x { 1 }", "{\"a\" 1}", "99999999999999999999" };
+    for(const auto& input : inputs)
+    {
+        lexer tree_lexer(input);
+        parser tree_parser(&tree_lexer);
+        tree_parser.parse_program();
+
+        lexer flat_lexer(input);
+        flat_parser fp(&flat_lexer, input);
+        fp.parse_program();
+        EXPECT_FALSE(fp.get_errors().empty()) << input;
+        EXPECT_EQ(fp.get_errors(), tree_parser.get_errors()) << input;
+    }
+}
+
+TEST(ParserTest, TestLazyFunBodies) {
+    std::string input = "var f = fun(x) { if (x) { { \"a\": \"}\" } } }; f(1)";
+    lexer l(input);
+    parser p(&l, true);
+    auto prog = p.parse_program();
+
+    ASSERT_EQ(p.get_errors().size(), 0);
+    ASSERT_EQ(prog->m_statements.size(), 2);
+    auto var_stmt = std::dynamic_pointer_cast<var>(prog->m_statements[0]);
+    auto fun_lit = std::dynamic_pointer_cast<fun_literal>(var_stmt->value);
+    ASSERT_NE(fun_lit, nullptr);
+    ASSERT_EQ(fun_lit->parameters.size(), 1);
+    EXPECT_EQ(fun_lit->body, nullptr);
+    EXPECT_EQ(fun_lit->body_source, "{ if (x) { { \"a\": \"}\" } } }");
+    EXPECT_EQ(fun_lit->source, "fun(x) { if (x) { { \"a\": \"}\" } } }");
+
+    parser::errors errs;
+    auto body = parser::parse_fun_body(fun_lit->body_source, errs);
+    ASSERT_NE(body, nullptr);
+    EXPECT_TRUE(errs.empty());
+    EXPECT_EQ(body->statements.size(), 1);
+
+    std::string unterminated_input = "fun() { 1";
+    lexer unterminated_lexer(unterminated_input);
+    parser unterminated(&unterminated_lexer, true);
+    unterminated.parse_program();
+    EXPECT_FALSE(unterminated.get_errors().empty());
+}
+
+TEST(ParserTest, TestFlatSerialize) {
+    std::string input = "var f = fun(a, b) { if (a < b) { [a, {\"b\": b}] } else { -a } }; f(1, 2)";
+    lexer l(input);
+    flat_parser p(&l, input);
+    auto ast = p.parse_program();
+    ASSERT_TRUE(p.get_errors().empty());
+
+    std::string bytes;
+    ast.serialize(bytes);
+    auto loaded = flat::ast::deserialize(bytes, input);
+    ASSERT_TRUE(loaded.has_value());
+    EXPECT_EQ(flat::to_tree(*loaded)->to_string(), flat::to_tree(ast)->to_string());
+
+    auto var_stmt = std::static_pointer_cast<var>(flat::to_tree(*loaded)->m_statements[0]);
+    auto fun_lit = std::static_pointer_cast<fun_literal>(var_stmt->value);
+    EXPECT_EQ(fun_lit->source, "fun(a, b) { if (a < b) { [a, {\"b\": b}] } else { -a } }");
+
+    //truncated pools and text spans past the source are refused
+    EXPECT_FALSE(flat::ast::deserialize(std::string_view(bytes).substr(0, bytes.size() - 8), input).has_value());
+    EXPECT_FALSE(flat::ast::deserialize(bytes, std::string_view(input).substr(0, 10)).has_value());
+}
+
 }  // namespace my_ns
@@ -0,0 +1,256 @@
+#include <gtest/gtest.h>
+#include "evaluator.hpp"
+#include "leac.hpp"
+#include "module.hpp"
+#include "runner.hpp"
+#include "snapshot.hpp"
+
+#include <filesystem>
+#include <fstream>
+
+namespace my_ns {
+
+static std::filesystem::path write_script(const std::string& name, const std::string& text) {
+    auto path = std::filesystem::temp_directory_path() / name;
+    std::ofstream(path, std::ios::binary) << text;
+    return path;
+}
+
+static std::string run_captured(const std::filesystem::path& path, const runner_options& options) {
+    testing::internal::CaptureStdout();
+    auto ret = start_runner(path, options);
+    std::fflush(stdout);
+    auto out = testing::internal::GetCapturedStdout();
+    EXPECT_TRUE(ret.has_value()) << path;
+    return out;
+}
+
+TEST(RunnerTest, TestStreamMatchesWholeFile) {
+    std::string script;
+    for (int i = 0; i < 40; ++i) {
+        auto n = std::to_string(i);
+        script += "var item_" + n + " = {\"name\": \"item " + n + "\", \"values\": [" + n + ", " + n + " * 2]};\n";
+        script += "var twice_" + n + " = fun(x) { x * 2 + item_" + n + "[\"values\"][1] };\n";
+        script += "puts(to_string(twice_" + n + "(" + n + ")) + \" \" + item_" + n + "[\"name\"])\n";
+    }
+    script += "var total = twice_3(1) + twice_39(2)\n";
+    script += "puts(to_string(total));";
+    auto path = write_script("lea_stream_test.lea", script);
+
+    auto whole = run_captured(path, {});
+    ASSERT_FALSE(whole.empty());
+
+    //tiny chunks put a window edge inside tokens, strings and fun bodies
+    for (size_t chunk : {1, 7, 64, 4096}) {
+        runner_options options;
+        options.stream = true;
+        options.stream_chunk = chunk;
+        EXPECT_EQ(run_captured(path, options), whole) << "chunk: " << chunk;
+
+        options.lazy_fun_bodies = true;
+        EXPECT_EQ(run_captured(path, options), whole) << "lazy chunk: " << chunk;
+    }
+    std::filesystem::remove(path);
+    std::filesystem::remove(leac::cache_path(path));
+}
+
+TEST(RunnerTest, TestStreamParseError) {
+    auto path = write_script("lea_stream_error.lea", "puts(\"ran\");\nvar = 3;\nputs(\"not ran\");\n");
+    runner_options options;
+    options.stream = true;
+    options.stream_chunk = 5;
+
+    testing::internal::CaptureStdout();
+    auto ret = start_runner(path, options);
+    std::fflush(stdout);
+    auto out = testing::internal::GetCapturedStdout();
+
+    ASSERT_FALSE(ret.has_value());
+    EXPECT_EQ(ret.error().errors[0].first, runner_error::type::parse_error);
+    EXPECT_EQ(out, "ran\n"); //statements before the error already ran
+    std::filesystem::remove(path);
+}
+
+TEST(RunnerTest, TestCache) {
+    std::string script =
+        "var add = fun(a, b) { a + b };\n"
+        "var inner = fun(x) { fun(y) { add(x, y) * 2 } };\n"
+        "puts(to_string(inner(3)(4)) + \" \" + {\"k\": \"v\"}[\"k\"]);\n";
+    auto path = write_script("lea_cache_test.lea", script);
+    auto cache = leac::cache_path(path);
+    std::filesystem::remove(cache);
+
+    auto first = run_captured(path, {});
+    EXPECT_EQ(first, "14 v\n");
+    ASSERT_TRUE(std::filesystem::exists(cache));
+    auto cache_time = std::filesystem::last_write_time(cache);
+
+    //a good cache is used as is
+    EXPECT_EQ(run_captured(path, {}), first);
+    EXPECT_EQ(std::filesystem::last_write_time(cache), cache_time);
+
+    //every byte of a damaged cache is caught, the run parses and rewrites it
+    auto size = std::filesystem::file_size(cache);
+    for (size_t at = 0; at < size; at += 7) {
+        std::fstream f(cache, std::ios::in | std::ios::out | std::ios::binary);
+        f.seekg(at);
+        char ch = 0;
+        f.get(ch);
+        f.seekp(at);
+        f.put(static_cast<char>(ch ^ 0x5a));
+        f.close();
+        EXPECT_EQ(run_captured(path, {}), first) << "flipped byte " << at;
+    }
+
+    std::filesystem::resize_file(cache, size / 2);
+    EXPECT_EQ(run_captured(path, {}), first);
+    EXPECT_EQ(std::filesystem::file_size(cache), size);
+
+    //a changed source never runs the old program
+    write_script("lea_cache_test.lea", "puts(\"changed\");");
+    EXPECT_EQ(run_captured(path, {}), "changed\n");
+
+    runner_options no_cache;
+    no_cache.use_cache = false;
+    std::filesystem::remove(cache);
+    EXPECT_EQ(run_captured(path, no_cache), "changed\n");
+    EXPECT_FALSE(std::filesystem::exists(cache));
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(cache);
+}
+
+TEST(RunnerTest, TestImport) {
+    auto dir = std::filesystem::temp_directory_path() / "lea_import_test";
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir / "mods");
+
+    //every module pulls in the same dependency, it has to run once
+    std::ofstream(dir / "mods" / "shared.lea") << "var base = 100;\nputs(\"shared\");\n";
+    std::string script;
+    for (int i = 0; i < 20; ++i) {
+        auto n = std::to_string(i);
+        std::ofstream(dir / "mods" / ("m" + n + ".lea"))
+            << "var shared = import \"shared.lea\";\n"
+            << "var get = fun() { shared[\"base\"] + " << n << " };\n";
+        script += "var m" + n + " = import \"mods/m" + n + ".lea\";\n";
+    }
+    script += "puts(to_string(m0[\"get\"]() + m19[\"get\"]()));\n";
+    script += "puts(to_string((import \"mods/m19.lea\")[\"get\"]() == m19[\"get\"]()));\n";
+    std::ofstream(dir / "main.lea") << script;
+
+    for (bool cache : {true, false}) {
+        runner_options options;
+        options.use_cache = cache;
+        //the module cache lives as long as the process, the second run imports nothing new
+        auto expected = std::string(cache ? "shared\n" : "") + "219\ntrue\n";
+        EXPECT_EQ(run_captured(dir / "main.lea", options), expected);
+    }
+
+    //the whole graph is found from the roots, files reached twice are parsed once
+    auto& pool = get_fork_join_pool();
+    auto threads = pool.size();
+    pool.resize(4);
+    module_cache modules;
+    modules.prefetch({ dir / "main.lea", dir / "mods" / "m3.lea" });
+    EXPECT_EQ(modules.size(), 22);
+    pool.resize(threads);
+
+    std::ofstream(dir / "self.lea") << "var me = import \"self.lea\";\n";
+    std::ofstream(dir / "broken.lea") << "var = 1;\n";
+    auto self = modules.import(dir / "self.lea");
+    auto broken = modules.import(dir / "broken.lea");
+    auto missing = modules.import(dir / "missing.lea");
+    ASSERT_EQ(self->get_type(), object_type::error);
+    ASSERT_EQ(broken->get_type(), object_type::error);
+    ASSERT_EQ(missing->get_type(), object_type::error);
+    EXPECT_NE(self->inspect().find("import cycle"), std::string::npos);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST(RunnerTest, TestSnapshot) {
+    auto prelude = write_script("lea_snapshot_prelude.lea",
+        "var base = 10;\n"
+        "var table = {\"name\": \"tbl\", \"rows\": [1, 2, 3]};\n"
+        "var mixed = {1: \"one\", \"f\": fun(x) { x + base }};\n"
+        "var make = fun(start) { var held = [fun(n) { start + n }]; var outer = [held]; held };\n"
+        "var held = make(5);\n"
+        "var fib = fun(n) { if (n < 2) { n } else { fib(n - 1) + fib(n - 2) } };\n"
+        "var say = puts;\n"
+        "var huge = 9223372036854775807 * 4;\n");
+    auto main = write_script("lea_snapshot_main.lea",
+        "say(to_string(held[0](1) + mixed[\"f\"](2) + fib(10)) + \" \" + table[\"name\"] + mixed[1] + \" \" + to_string(huge - 1));\n");
+    auto snap_path = std::filesystem::temp_directory_path() / "lea_snapshot_test.leas";
+
+    for (bool stream : {false, true}) {
+        runner_options save;
+        save.stream = stream;
+        save.save_snapshot = snap_path;
+        EXPECT_EQ(run_captured(prelude, save), "");
+
+        runner_options use;
+        use.snapshot = snap_path;
+        EXPECT_EQ(run_captured(main, use), "73 tblone 36893488147419103227\n") << "stream: " << stream;
+    }
+
+    //restores don't share scopes, a host can reset to the snapshot between requests
+    auto snap = snapshot::load(snap_path);
+    ASSERT_TRUE(snap.has_value()) << snap.error();
+    auto first = snap->restore();
+    auto second = snap->restore();
+    first->set("base", std::make_shared<integer>(1000));
+    auto call_f = [](const std::shared_ptr<environment>& env) {
+        auto m = std::static_pointer_cast<map>(*env->get("mixed"));
+        for (const auto& [_, pair] : m->get_map())
+            if (pair.value->get_type() == object_type::fun)
+                return invoke_function(pair.value, { std::make_shared<integer>(1) })->inspect();
+        return std::string();
+    };
+    EXPECT_EQ(call_f(first), "1001");
+    EXPECT_EQ(call_f(second), "11");
+
+    //a damaged file is refused, never half restored
+    auto size = std::filesystem::file_size(snap_path);
+    for (size_t at = 0; at < size; at += 5) {
+        std::fstream file(snap_path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekg(at);
+        char ch = 0;
+        file.get(ch);
+        file.seekp(at);
+        file.put(static_cast<char>(ch ^ 0x5a));
+        file.close();
+        EXPECT_FALSE(snapshot::load(snap_path).has_value()) << "flipped byte " << at;
+
+        file.open(snap_path, std::ios::in | std::ios::out | std::ios::binary);
+        file.seekp(at);
+        file.put(ch);
+    }
+
+    //values that only live mid evaluation can't be saved
+    auto env = std::make_shared<environment>();
+    env->set("err", add_error("boom"));
+    EXPECT_FALSE(snapshot::save(snap_path, env).has_value());
+
+    std::filesystem::remove(prelude);
+    std::filesystem::remove(main);
+    std::filesystem::remove(leac::cache_path(prelude));
+    std::filesystem::remove(leac::cache_path(main));
+    std::filesystem::remove(snap_path);
+}
+
+//recursion as deep as the evaluator has always taken still fits the stack, through an intrinsic and through a bignum
+TEST(RunnerTest, TestDeepRecursion) {
+    auto path = write_script("lea_deep_test.lea",
+        "var p = fun(a, e) { if (e == 0) { 1 } else { len(a) * p(a, e - 1) } };\n"
+        "puts(to_string(p([1], 850)));\n"
+        "var q = fun(a, e) { if (e == 0) { 1 } else { a * q(a, e - 1) } };\n"
+        "puts(to_string(q(2, 850) == q(4, 425)));\n");
+
+    EXPECT_EQ(run_captured(path, {}), "1\ntrue\n");
+
+    std::filesystem::remove(path);
+    std::filesystem::remove(leac::cache_path(path));
+}
+
+}  // namespace my_ns